@@ -25,6 +25,16 @@ struct abiRefT : public abiRefObj {
 
 typedef abiRefT<void> abiRefAny;
 
+// define Callback abi interfaces
+template <typename... Args>
+struct abiCallBackT : public abiRefObj {
+    using CppFunc = std::function<void(Args...)>;
+    virtual void notify(Args... args) = 0;
+    abiCallBackT* refCopy() const { return dynamic_cast<abiCallBackT*>(refCopy_i()); }
+};
+
+class abiDataMapV2;
+
 class abiDataMap {
 public:
     abiDataMap() = default;
@@ -34,19 +44,58 @@ public:
     virtual ErrCode removeBuf_i(const char* key) = 0;
     virtual bool has_i(const char* key) const = 0;
     virtual ErrCode clear_i() = 0;
+    // the extended interface of this map, nullptr if it has none. Queried
+    // instead of a dynamic_cast, whose typeinfo is not shared between
+    // hidden-visibility libraries.
+    virtual abiDataMapV2* v2_i() { return nullptr; }
     DS3D_DISABLE_CLASS_COPY(abiDataMap);
 };
 
-typedef abiRefT<abiDataMap> abiRefDataMap;
+// one entry of a batched lookup. data stays nullptr when code is not kGood
+struct DataKeyQuery {
+    const DataKey* key = nullptr;
+    TIdType tid = 0;
+    const abiRefAny* data = nullptr;
+    ErrCode code = ErrCode::kNotFound;
+};
 
-// define Callback abi interfaces
-template <typename... Args>
-struct abiCallBackT : public abiRefObj {
-    using CppFunc = std::function<void(Args...)>;
-    virtual void notify(Args... args) = 0;
-    abiCallBackT* refCopy() const { return dynamic_cast<abiCallBackT*>(refCopy_i()); }
+// one entry reported by abiDataMapV2::enumerate_i, only valid during the callback
+struct DataMapEntry {
+    const char* key = nullptr;
+    TIdType tid = 0;
+    const abiRefAny* data = nullptr;
 };
 
+typedef abiCallBackT<const DataMapEntry*> abiEnumEntryCB;
+
+// Extended datamap interface. Keys carry a precomputed hash, so lookups skip
+// string hashing. Implementations must also serve the string-keyed abiDataMap
+// interface for custom libs which are unaware of abiDataMapV2.
+class abiDataMapV2 : public abiDataMap {
+public:
+    abiDataMapV2() = default;
+    ~abiDataMapV2() override = default;
+    virtual ErrCode setBufKey_i(const DataKey& key, TIdType tid, abiRefAny* data) = 0;
+    virtual ErrCode getBufKey_i(const DataKey& key, TIdType tid, const abiRefAny*& data) const = 0;
+    virtual ErrCode removeBufKey_i(const DataKey& key) = 0;
+    virtual bool hasKey_i(const DataKey& key) const = 0;
+    // resolve a whole set of keys in one call, missing keys are not an error
+    virtual ErrCode getBufKeys_i(DataKeyQuery* queries, uint32_t num) const = 0;
+    // copy a small trivially copyable value into map-owned storage.
+    // returns ErrCode::kUnsupported if the map can not keep it inline,
+    // callers then fall back to setBufKey_i.
+    virtual ErrCode setValueKey_i(const DataKey& key, TIdType tid, const void* value, uint32_t bytes) = 0;
+    // report every key once, synchronously. The map must not be modified from cb.
+    virtual ErrCode enumerate_i(abiEnumEntryCB* cb) const = 0;
+    // make the map read-only. Afterwards all writes fail with ErrCode::kState
+    // and reads are safe from any number of threads without locking.
+    virtual ErrCode freeze_i() = 0;
+    virtual bool frozen_i() const = 0;
+    abiDataMapV2* v2_i() final { return this; }
+};
+
+typedef abiRefT<abiDataMap> abiRefDataMap;
+
 typedef abiCallBackT<ErrCode, const char*> abiErrorCB;
 typedef abiCallBackT<ErrCode, const abiRefDataMap*> abiOnDataCB;
 
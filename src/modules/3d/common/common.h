@@ -56,37 +56,86 @@ enum class ErrCode : int {
 
 using TIdType = uint64_t;
 
+// forward declarations of the data types carried by the well-known keys below
+struct TimeStamp;
+struct DepthScale;
+struct IntrinsicsParam;
+struct ExtrinsicsParam;
+struct PointQuantParam;
+struct abiFrame;
+struct abi2DFrame;
+
+// compile-time FNV-1a hash of a datamap key name
+constexpr uint64_t
+KeyHash(const char* name)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (; name && *name; ++name) {
+        h = (h ^ static_cast<uint8_t>(*name)) * 1099511628211ull;
+    }
+    return h;
+}
+
+// key name with its precomputed hash, passed through abiDataMapV2
+struct DataKey {
+    const char* name = nullptr;
+    uint64_t hash = 0;
+    constexpr DataKey() = default;
+    constexpr DataKey(const char* n) : name(n), hash(KeyHash(n)) {}
+    constexpr operator const char*() const { return name; }
+};
+
+// typed datamap key, T is the value type stored under this key. The name must
+// have static storage duration (e.g. DS3D_KEY_NAME literals).
+template <typename T>
+struct Key : public DataKey {
+    using type = T;
+    constexpr Key(const char* n) : DataKey(n) {}
+};
+
 // structure TimeStamp
-static constexpr const char* kTimeStamp = DS3D_KEY_NAME("Timestamp");
+static constexpr Key<TimeStamp> kTimeStamp{DS3D_KEY_NAME("Timestamp")};
 // get from Frame2DGuard
-static constexpr const char* kColorFrame = DS3D_KEY_NAME("ColorFrame");
+static constexpr Key<abi2DFrame> kColorFrame{DS3D_KEY_NAME("ColorFrame")};
 // get from Frame2DGuard
-static constexpr const char* kDepthFrame = DS3D_KEY_NAME("DepthFrame");
+static constexpr Key<abi2DFrame> kDepthFrame{DS3D_KEY_NAME("DepthFrame")};
 // structure DepthScale
-static constexpr const char* kDepthScaleUnit = DS3D_KEY_NAME("DepthScaleUnit");
+static constexpr Key<DepthScale> kDepthScaleUnit{DS3D_KEY_NAME("DepthScaleUnit")};
+// get from Frame2DGuard, kDepthFrame converted to fp32 meters, invalid depth is 0
+static constexpr Key<abi2DFrame> kDepthMetersFrame{DS3D_KEY_NAME("DepthMetersFrame")};
+// get from Frame2DGuard, uint8 per depth pixel, 255 valid and 0 invalid
+static constexpr Key<abi2DFrame> kDepthValidMask{DS3D_KEY_NAME("DepthValidMask")};
 // structure IntrinsicsParam
-static constexpr const char* kDepthIntrinsics = DS3D_KEY_NAME("DepthIntrinsics");
+static constexpr Key<IntrinsicsParam> kDepthIntrinsics{DS3D_KEY_NAME("DepthIntrinsics")};
 // structure IntrinsicsParam
-static constexpr const char* kColorIntrinsics = DS3D_KEY_NAME("ColorIntrinsics");
+static constexpr Key<IntrinsicsParam> kColorIntrinsics{DS3D_KEY_NAME("ColorIntrinsics")};
 // structure ExtrinsicsParam
-static constexpr const char* kDepth2ColorExtrinsics = DS3D_KEY_NAME("Depth2ColorExtrinsics");
+static constexpr Key<ExtrinsicsParam> kDepth2ColorExtrinsics{DS3D_KEY_NAME("Depth2ColorExtrinsics")};
 // structure bool
-static constexpr const char* kColorDepthAligned = DS3D_KEY_NAME("ColorDepthAligned");
+static constexpr Key<bool> kColorDepthAligned{DS3D_KEY_NAME("ColorDepthAligned")};
 
 // structure bool
-static constexpr const char* kEOS = DS3D_KEY_NAME("EndOfStream");
+static constexpr Key<bool> kEOS{DS3D_KEY_NAME("EndOfStream")};
 // get from FrameGuard
-static constexpr const char* kPointXYZ = DS3D_KEY_NAME("PointXYZ");
+static constexpr Key<abiFrame> kPointXYZ{DS3D_KEY_NAME("PointXYZ")};
 // get from FrameGuard
-static constexpr const char* kPointCoordUV = DS3D_KEY_NAME("PointColorCoord");
+static constexpr Key<abiFrame> kPointCoordUV{DS3D_KEY_NAME("PointColorCoord")};
+// get from Frame2DGuard, SoA of kPointXYZ: 3 rows X, Y, Z of N floats
+static constexpr Key<abi2DFrame> kPointXYZPlanar{DS3D_KEY_NAME("PointXYZPlanar")};
+// get from FrameGuard, kPointXYZ stored as N x 3 fp16, or N x 3 int16 with kPointQuantParam
+static constexpr Key<abiFrame> kPointXYZCompact{DS3D_KEY_NAME("PointXYZCompact")};
+// structure PointQuantParam
+static constexpr Key<PointQuantParam> kPointQuantParam{DS3D_KEY_NAME("PointQuantParam")};
+// get from FrameGuard, N x 3 fp32 unit normals of kPointXYZ, (0, 0, 0) where unknown
+static constexpr Key<abiFrame> kPointNormal{DS3D_KEY_NAME("PointNormal")};
 // get from FrameGuard
-static constexpr const char* kLidarXYZI = DS3D_KEY_NAME("LidarXYZI");
+static constexpr Key<abiFrame> kLidarXYZI{DS3D_KEY_NAME("LidarXYZI")};
 //get from FrameGuard
-static constexpr const char* kLidarInferenceParas = DS3D_KEY_NAME("LidarInferenceParas");
+static constexpr Key<abiFrame> kLidarInferenceParas{DS3D_KEY_NAME("LidarInferenceParas")};
 //get from FrameGuard
-static constexpr const char* kLidarRefDataMap = DS3D_KEY_NAME("LidarRefDataMap");
+static constexpr Key<abiFrame> kLidarRefDataMap{DS3D_KEY_NAME("LidarRefDataMap")};
 //get from FrameGuard
-static constexpr const char* kLidar3DBboxRawData = DS3D_KEY_NAME("Lidar3DBboxRawData");
+static constexpr Key<abiFrame> kLidar3DBboxRawData{DS3D_KEY_NAME("Lidar3DBboxRawData")};
 // default caps for input and ouptut
 static constexpr const char* kDefaultDs3dCaps = "ds3d/datamap";
 
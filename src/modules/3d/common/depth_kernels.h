@@ -0,0 +1,290 @@
+#ifndef _DS3D_COMMON_DEPTH_KERNELS__H
+#define _DS3D_COMMON_DEPTH_KERNELS__H
+
+#include "3d/common/common.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DS3D_DEPTH_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DS3D_DEPTH_NEON 1
+#endif
+
+/**
+ * @file uint16 depth <-> float meters conversion kernels
+ */
+
+namespace ds3d {
+
+// valid depth range in meters, e.g. min_depth/max_depth of the render config.
+// Raw depth 0 (no data) is always invalid.
+struct DepthRange {
+    float minDepth = 0.0f;
+    float maxDepth = std::numeric_limits<float>::max();
+    // true clamps valid depth into the range, false marks out-of-range depth invalid
+    bool clamp = false;
+};
+
+namespace detail {
+
+// 8 valid bits -> 8 mask bytes of 0 / 255
+inline const std::array<uint64_t, 256>&
+maskBytesLut()
+{
+    static const std::array<uint64_t, 256> lut = []() {
+        std::array<uint64_t, 256> t{};
+        for (uint32_t bits = 0; bits < 256; ++bits) {
+            for (uint32_t b = 0; b < 8; ++b) {
+                t[bits] |= (bits & (1u << b)) ? (0xffull << (b * 8)) : 0;
+            }
+        }
+        return t;
+    }();
+    return lut;
+}
+
+inline void
+depthToMetersScalar(
+    const uint16_t* in, float* out, uint8_t* mask, size_t begin, size_t num, float scale, const DepthRange& r)
+{
+    for (size_t i = begin; i < num; ++i) {
+        float m = static_cast<float>(in[i]) * scale;
+        bool valid = in[i] != 0;
+        if (r.clamp) {
+            m = std::min(std::max(m, r.minDepth), r.maxDepth);
+        } else {
+            valid = valid && m >= r.minDepth && m <= r.maxDepth;
+        }
+        out[i] = valid ? m : 0.0f;
+        if (mask) {
+            mask[i] = valid ? 255 : 0;
+        }
+    }
+}
+
+inline void
+metersToDepthScalar(const float* in, uint16_t* out, size_t begin, size_t num, float invScale)
+{
+    for (size_t i = begin; i < num; ++i) {
+        float d = std::nearbyint(in[i] * invScale);
+        // NaN and negative depth are invalid
+        out[i] = (d > 0.0f) ? static_cast<uint16_t>(std::min(d, 65535.0f)) : 0;
+    }
+}
+
+#if defined(DS3D_DEPTH_X86)
+__attribute__((target("avx2"))) inline size_t
+depthToMetersAVX2(const uint16_t* in, float* out, uint8_t* mask, size_t num, float scale, const DepthRange& r)
+{
+    const __m256 vScale = _mm256_set1_ps(scale);
+    const __m256 lo = _mm256_set1_ps(r.minDepth);
+    const __m256 hi = _mm256_set1_ps(r.maxDepth);
+    const __m256 zero = _mm256_setzero_ps();
+    const auto& lut = maskBytesLut();
+    size_t i = 0;
+    for (const size_t vecNum = num & ~static_cast<size_t>(7); i < vecNum; i += 8) {
+        __m256i d = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        __m256 m = _mm256_mul_ps(_mm256_cvtepi32_ps(d), vScale);
+        __m256 valid = _mm256_cmp_ps(m, zero, _CMP_NEQ_OQ);
+        if (r.clamp) {
+            m = _mm256_min_ps(_mm256_max_ps(m, lo), hi);
+        } else {
+            valid = _mm256_and_ps(
+                valid, _mm256_and_ps(_mm256_cmp_ps(m, lo, _CMP_GE_OQ), _mm256_cmp_ps(m, hi, _CMP_LE_OQ)));
+        }
+        _mm256_storeu_ps(out + i, _mm256_and_ps(m, valid));
+        if (mask) {
+            uint64_t bytes = lut[_mm256_movemask_ps(valid)];
+            memcpy(mask + i, &bytes, sizeof(bytes));
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) inline size_t
+metersToDepthAVX2(const float* in, uint16_t* out, size_t num, float invScale)
+{
+    const __m256 vInv = _mm256_set1_ps(invScale);
+    const __m256 maxF = _mm256_set1_ps(65535.0f);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (const size_t vecNum = num & ~static_cast<size_t>(15); i < vecNum; i += 16) {
+        // saturate in float first, inf and >= 2^31 would convert to INT_MIN.
+        // min_ps returns its 2nd operand for NaN, so NaN stays NaN, converts
+        // to INT_MIN and clamps to 0 with the negative values.
+        __m256i a = _mm256_cvtps_epi32(_mm256_min_ps(maxF, _mm256_mul_ps(_mm256_loadu_ps(in + i), vInv)));
+        __m256i b = _mm256_cvtps_epi32(_mm256_min_ps(maxF, _mm256_mul_ps(_mm256_loadu_ps(in + i + 8), vInv)));
+        a = _mm256_max_epi32(a, zero);
+        b = _mm256_max_epi32(b, zero);
+        // packus works per 128-bit lane, restore the order afterwards
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), p);
+    }
+    return i;
+}
+
+__attribute__((target("avx512f"))) inline size_t
+depthToMetersAVX512(const uint16_t* in, float* out, uint8_t* mask, size_t num, float scale, const DepthRange& r)
+{
+    const __m512 vScale = _mm512_set1_ps(scale);
+    const __m512 lo = _mm512_set1_ps(r.minDepth);
+    const __m512 hi = _mm512_set1_ps(r.maxDepth);
+    const __m512 zero = _mm512_setzero_ps();
+    size_t i = 0;
+    for (const size_t vecNum = num & ~static_cast<size_t>(15); i < vecNum; i += 16) {
+        __m512i d = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)));
+        __m512 m = _mm512_mul_ps(_mm512_cvtepi32_ps(d), vScale);
+        __mmask16 valid = _mm512_cmp_ps_mask(m, zero, _CMP_NEQ_OQ);
+        if (r.clamp) {
+            m = _mm512_min_ps(_mm512_max_ps(m, lo), hi);
+        } else {
+            valid &= _mm512_cmp_ps_mask(m, lo, _CMP_GE_OQ) & _mm512_cmp_ps_mask(m, hi, _CMP_LE_OQ);
+        }
+        _mm512_storeu_ps(out + i, _mm512_maskz_mov_ps(valid, m));
+        if (mask) {
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(mask + i),
+                _mm512_cvtepi32_epi8(_mm512_maskz_set1_epi32(valid, 0xff)));
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx512f"))) inline size_t
+metersToDepthAVX512(const float* in, uint16_t* out, size_t num, float invScale)
+{
+    const __m512 vInv = _mm512_set1_ps(invScale);
+    const __m512 maxF = _mm512_set1_ps(65535.0f);
+    const __m512i zero = _mm512_setzero_si512();
+    size_t i = 0;
+    for (const size_t vecNum = num & ~static_cast<size_t>(15); i < vecNum; i += 16) {
+        // same saturation as metersToDepthAVX2, NaN ends up 0
+        __m512i a = _mm512_cvtps_epi32(_mm512_min_ps(maxF, _mm512_mul_ps(_mm512_loadu_ps(in + i), vInv)));
+        a = _mm512_max_epi32(a, zero);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm512_cvtusepi32_epi16(a));
+    }
+    return i;
+}
+
+enum class DepthIsa : int { kScalar, kAVX2, kAVX512 };
+
+// the x86-64 baseline has neither, pick the widest the CPU supports once
+inline DepthIsa
+depthIsa()
+{
+    static const DepthIsa isa = []() {
+        if (__builtin_cpu_supports("avx512f")) {
+            return DepthIsa::kAVX512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return DepthIsa::kAVX2;
+        }
+        return DepthIsa::kScalar;
+    }();
+    return isa;
+}
+
+#elif defined(DS3D_DEPTH_NEON)
+inline size_t
+depthToMetersNEON(const uint16_t* in, float* out, uint8_t* mask, size_t num, float scale, const DepthRange& r)
+{
+    const float32x4_t lo = vdupq_n_f32(r.minDepth);
+    const float32x4_t hi = vdupq_n_f32(r.maxDepth);
+    size_t i = 0;
+    for (const size_t vecNum = num & ~static_cast<size_t>(7); i < vecNum; i += 8) {
+        uint16x8_t d = vld1q_u16(in + i);
+        uint32x4_t v[2] = {vmovl_u16(vget_low_u16(d)), vmovl_u16(vget_high_u16(d))};
+        uint16x4_t valid16[2];
+        for (int h = 0; h < 2; ++h) {
+            float32x4_t m = vmulq_n_f32(vcvtq_f32_u32(v[h]), scale);
+            uint32x4_t valid = vtstq_u32(v[h], v[h]);  // raw != 0
+            if (r.clamp) {
+                m = vminq_f32(vmaxq_f32(m, lo), hi);
+            } else {
+                valid = vandq_u32(valid, vandq_u32(vcgeq_f32(m, lo), vcleq_f32(m, hi)));
+            }
+            vst1q_f32(out + i + h * 4, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(m), valid)));
+            valid16[h] = vmovn_u32(valid);
+        }
+        if (mask) {
+            vst1_u8(mask + i, vmovn_u16(vcombine_u16(valid16[0], valid16[1])));
+        }
+    }
+    return i;
+}
+
+inline size_t
+metersToDepthNEON(const float* in, uint16_t* out, size_t num, float invScale)
+{
+    size_t i = 0;
+    for (const size_t vecNum = num & ~static_cast<size_t>(7); i < vecNum; i += 8) {
+        // vcvtnq_u32 rounds to nearest, saturates negatives and NaN to 0
+        uint32x4_t a = vcvtnq_u32_f32(vmulq_n_f32(vld1q_f32(in + i), invScale));
+        uint32x4_t b = vcvtnq_u32_f32(vmulq_n_f32(vld1q_f32(in + i + 4), invScale));
+        vst1q_u16(out + i, vcombine_u16(vqmovn_u32(a), vqmovn_u32(b)));
+    }
+    return i;
+}
+#endif
+
+}  // namespace detail
+
+/**
+ * @brief convert num raw depth values to meters, out = in * scale
+ *   (DepthScale::scaleUnit). Invalid depth is written as 0.0f. mask is
+ *   optional and receives 255 for valid and 0 for invalid pixels.
+ *   Uses AVX-512 or AVX2 when the CPU has them, NEON on aarch64.
+ */
+inline void
+DepthToMeters(const uint16_t* in, float* out, uint8_t* mask, size_t num, float scale, const DepthRange& range)
+{
+    size_t i = 0;
+#if defined(DS3D_DEPTH_X86)
+    switch (detail::depthIsa()) {
+    case detail::DepthIsa::kAVX512:
+        i = detail::depthToMetersAVX512(in, out, mask, num, scale, range);
+        break;
+    case detail::DepthIsa::kAVX2:
+        i = detail::depthToMetersAVX2(in, out, mask, num, scale, range);
+        break;
+    default:
+        break;
+    }
+#elif defined(DS3D_DEPTH_NEON)
+    i = detail::depthToMetersNEON(in, out, mask, num, scale, range);
+#endif
+    detail::depthToMetersScalar(in, out, mask, i, num, scale, range);
+}
+
+// convert meters back to raw depth, out = round(in / scale) saturated to
+// uint16, +inf gives 65535. Negative and NaN depth become 0 (invalid).
+inline void
+MetersToDepth(const float* in, uint16_t* out, size_t num, float scale)
+{
+    const float invScale = 1.0f / scale;
+    size_t i = 0;
+#if defined(DS3D_DEPTH_X86)
+    switch (detail::depthIsa()) {
+    case detail::DepthIsa::kAVX512:
+        i = detail::metersToDepthAVX512(in, out, num, invScale);
+        break;
+    case detail::DepthIsa::kAVX2:
+        i = detail::metersToDepthAVX2(in, out, num, invScale);
+        break;
+    default:
+        break;
+    }
+#elif defined(DS3D_DEPTH_NEON)
+    i = detail::metersToDepthNEON(in, out, num, invScale);
+#endif
+    detail::metersToDepthScalar(in, out, i, num, invScale);
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_DEPTH_KERNELS__H
@@ -0,0 +1,225 @@
+#ifndef _DS3D_COMMON_DEPTH_REGISTER__H
+#define _DS3D_COMMON_DEPTH_REGISTER__H
+
+#include "3d/common/common.h"
+#include "3d/common/idatatype.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define DS3D_REGISTER_SSE 1
+#endif
+
+/**
+ * @file depth <-> color registration tables and row kernels
+ */
+
+namespace ds3d {
+
+/**
+ * @brief per depth pixel projection into the color image, built from the
+ *   calibration only. A depth pixel at z meters lands on color pixel
+ *     u = (z * a[i] + ta) / (z * c[i] + tc), v = (z * b[i] + tb) / (z * c[i] + tc)
+ *   where (a, b, c) is the depth ray rotated into the color camera and scaled
+ *   by the color intrinsics, so a frame costs one division per pixel and no
+ *   trigonometry or matrix product. With corners set, the table holds the
+ *   (width + 1) x (height + 1) pixel corners instead of the pixel centers.
+ */
+struct DepthRegistrationLut {
+    IntrinsicsParam depth;
+    IntrinsicsParam color;
+    ExtrinsicsParam depth2color{};
+    bool corners = false;
+    uint32_t cols = 0;  // table entries per row
+    uint32_t rows = 0;
+    std::vector<float> a, b, c;
+    float ta = 0.0f, tb = 0.0f, tc = 0.0f;
+
+    bool matches(const IntrinsicsParam& d, const IntrinsicsParam& col, const ExtrinsicsParam& d2c, bool withCorners) const
+    {
+        return !a.empty() && corners == withCorners && !std::memcmp(&d, &depth, sizeof(d)) &&
+               !std::memcmp(&col, &color, sizeof(col)) && !std::memcmp(&d2c, &depth2color, sizeof(d2c));
+    }
+};
+
+inline bool
+BuildDepthRegistrationLut(
+    const IntrinsicsParam& depth, const IntrinsicsParam& color, const ExtrinsicsParam& d2c, bool corners,
+    DepthRegistrationLut& lut)
+{
+    if (!depth.width || !depth.height || depth.fx == 0.0f || depth.fy == 0.0f || !color.width || !color.height) {
+        return false;
+    }
+    lut.depth = depth;
+    lut.color = color;
+    lut.depth2color = d2c;
+    lut.corners = corners;
+    lut.cols = depth.width + (corners ? 1 : 0);
+    lut.rows = depth.height + (corners ? 1 : 0);
+    size_t num = static_cast<size_t>(lut.cols) * lut.rows;
+    lut.a.resize(num);
+    lut.b.resize(num);
+    lut.c.resize(num);
+    const float shift = corners ? -0.5f : 0.0f;
+    const vec3f* r = d2c.rotation;  // column-major, r[col].data[row]
+    for (uint32_t y = 0; y < lut.rows; ++y) {
+        float ry = (static_cast<float>(y) + shift - depth.centerY) / depth.fy;
+        for (uint32_t x = 0; x < lut.cols; ++x) {
+            float rx = (static_cast<float>(x) + shift - depth.centerX) / depth.fx;
+            float q[3];
+            for (int row = 0; row < 3; ++row) {
+                q[row] = r[0].data[row] * rx + r[1].data[row] * ry + r[2].data[row];
+            }
+            size_t i = static_cast<size_t>(y) * lut.cols + x;
+            lut.a[i] = color.fx * q[0] + color.centerX * q[2];
+            lut.b[i] = color.fy * q[1] + color.centerY * q[2];
+            lut.c[i] = q[2];
+        }
+    }
+    const float* t = d2c.translation.data;
+    lut.ta = color.fx * t[0] + color.centerX * t[2];
+    lut.tb = color.fy * t[1] + color.centerY * t[2];
+    lut.tc = t[2];
+    return true;
+}
+
+/**
+ * @brief color pixel of every depth pixel of a row, as a byte offset into the
+ *   color plane (v * colorPitch + u * colorBpp), -1 for invalid depth, points
+ *   behind the color camera and pixels outside the color image. a, b, c point
+ *   to the table row of the depth row. Branch free so it vectorizes.
+ */
+inline void
+RegisterDepthRow(
+    const uint16_t* depth, uint32_t width, float scale, const float* a, const float* b, const float* c,
+    const DepthRegistrationLut& lut, uint32_t colorPitch, uint32_t colorBpp, int32_t* offset)
+{
+    const float colorW = static_cast<float>(lut.color.width);
+    const float colorH = static_cast<float>(lut.color.height);
+    for (uint32_t x = 0; x < width; ++x) {
+        float z = static_cast<float>(depth[x]) * scale;
+        float w = z * c[x] + lut.tc;
+        float invW = 1.0f / w;
+        // + 0.5 rounds to the nearest pixel, truncation is a floor once known non-negative
+        float u = (z * a[x] + lut.ta) * invW + 0.5f;
+        float v = (z * b[x] + lut.tb) * invW + 0.5f;
+        bool valid = z > 0.0f && w > 0.0f && u >= 0.0f && u < colorW && v >= 0.0f && v < colorH;
+        int32_t ui = valid ? static_cast<int32_t>(u) : 0;
+        int32_t vi = valid ? static_cast<int32_t>(v) : 0;
+        offset[x] = valid ? vi * static_cast<int32_t>(colorPitch) + ui * static_cast<int32_t>(colorBpp) : -1;
+    }
+}
+
+// dst[x] = color pixel at offset[x], zero where offset[x] is -1
+template <uint32_t Bpp>
+inline void
+GatherColorRow(const uint8_t* color, const int32_t* offset, uint32_t width, uint8_t* dst)
+{
+    for (uint32_t x = 0; x < width; ++x) {
+        if (offset[x] >= 0) {
+            std::memcpy(dst + x * Bpp, color + offset[x], Bpp);
+        } else {
+            std::memset(dst + x * Bpp, 0, Bpp);
+        }
+    }
+}
+
+// color pixels [x0, x1] x [y0, y1] covered by one depth pixel, empty (x0 > x1) when it does not land in the color image
+struct ColorRect {
+    int16_t x0, y0, x1, y1;
+};
+
+/**
+ * @brief project the corners of every depth pixel of a row, lut must be
+ *   built with corners. a, b, c point to the table row of the depth row, the
+ *   next table row (a + lut.cols) holds the bottom corners. A depth pixel
+ *   covers the color pixels whose centers lie in the bounding box of its 4
+ *   projected corners (min inclusive, max exclusive), so footprints of
+ *   neighbor pixels tile without gaps even when the rotation shears them.
+ */
+inline void
+ProjectDepthRowRects(
+    const uint16_t* depth, uint32_t width, float scale, const float* a, const float* b, const float* c,
+    const DepthRegistrationLut& lut, ColorRect* rects)
+{
+    // bounds are clamped to [0, size] in float, then ceil(p) = k - trunc(k - p) with k > size
+    const float maxU = static_cast<float>(lut.color.width);
+    const float maxV = static_cast<float>(lut.color.height);
+    const float k = static_cast<float>(std::max(lut.color.width, lut.color.height) + 1);
+    const uint32_t below = lut.cols;  // bottom left corner
+    uint32_t x = 0;
+#if defined(DS3D_REGISTER_SSE)
+    const __m128 vScale = _mm_set1_ps(scale), zero = _mm_setzero_ps(), vk = _mm_set1_ps(k);
+    const __m128 vta = _mm_set1_ps(lut.ta), vtb = _mm_set1_ps(lut.tb), vtc = _mm_set1_ps(lut.tc);
+    const __m128i one = _mm_set1_epi32(1);
+    auto ceilPixel4 = [&](__m128 p, __m128 maxP) {
+        p = _mm_min_ps(_mm_max_ps(p, zero), maxP);
+        return _mm_sub_epi32(_mm_cvttps_epi32(vk), _mm_cvttps_epi32(_mm_sub_ps(vk, p)));
+    };
+    for (; x + 4 <= width; x += 4) {
+        __m128i d = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(depth + x));
+        __m128 z = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(d, _mm_setzero_si128())), vScale);
+        __m128 valid = _mm_cmpgt_ps(z, zero);
+        __m128 uMin = _mm_set1_ps(FLT_MAX), vMin = uMin;
+        __m128 uMax = _mm_set1_ps(-FLT_MAX), vMax = uMax;
+        for (uint32_t i : {x, x + 1, x + below, x + below + 1}) {
+            __m128 w = _mm_add_ps(_mm_mul_ps(z, _mm_loadu_ps(c + i)), vtc);
+            valid = _mm_and_ps(valid, _mm_cmpgt_ps(w, zero));
+            __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), w);
+            __m128 u = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(z, _mm_loadu_ps(a + i)), vta), inv);
+            __m128 v = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(z, _mm_loadu_ps(b + i)), vtb), inv);
+            uMin = _mm_min_ps(uMin, u);
+            uMax = _mm_max_ps(uMax, u);
+            vMin = _mm_min_ps(vMin, v);
+            vMax = _mm_max_ps(vMax, v);
+        }
+        // invalid lanes become the empty rect {1, 0, 0, 0}
+        __m128i mask = _mm_castps_si128(valid);
+        __m128i x0 = _mm_or_si128(_mm_and_si128(mask, ceilPixel4(uMin, _mm_set1_ps(maxU))), _mm_andnot_si128(mask, one));
+        __m128i y0 = _mm_and_si128(mask, ceilPixel4(vMin, _mm_set1_ps(maxV)));
+        __m128i x1 = _mm_and_si128(mask, _mm_sub_epi32(ceilPixel4(uMax, _mm_set1_ps(maxU)), one));
+        __m128i y1 = _mm_and_si128(mask, _mm_sub_epi32(ceilPixel4(vMax, _mm_set1_ps(maxV)), one));
+        __m128i xs = _mm_packs_epi32(x0, x1);  // x0 of 4 pixels, x1 of 4 pixels
+        __m128i ys = _mm_packs_epi32(y0, y1);
+        __m128i lo = _mm_unpacklo_epi16(xs, ys);  // (x0, y0) per pixel
+        __m128i hi = _mm_unpackhi_epi16(xs, ys);  // (x1, y1) per pixel
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rects + x), _mm_unpacklo_epi32(lo, hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rects + x + 2), _mm_unpackhi_epi32(lo, hi));
+    }
+#endif
+    auto ceilPixel = [k](float p, float maxP) {
+        p = std::min(std::max(p, 0.0f), maxP);
+        return static_cast<int32_t>(k) - static_cast<int32_t>(k - p);
+    };
+    for (; x < width; ++x) {
+        ColorRect& rect = rects[x];
+        rect = ColorRect{1, 0, 0, 0};
+        float z = static_cast<float>(depth[x]) * scale;
+        bool valid = z > 0.0f;
+        float uMin = FLT_MAX, uMax = -FLT_MAX, vMin = FLT_MAX, vMax = -FLT_MAX;
+        for (uint32_t i : {x, x + 1, x + below, x + below + 1}) {
+            float w = z * c[i] + lut.tc;
+            valid = valid && w > 0.0f;
+            float inv = 1.0f / w;
+            float u = (z * a[i] + lut.ta) * inv, v = (z * b[i] + lut.tb) * inv;
+            uMin = std::min(uMin, u);
+            uMax = std::max(uMax, u);
+            vMin = std::min(vMin, v);
+            vMax = std::max(vMax, v);
+        }
+        if (valid) {
+            rect.x0 = static_cast<int16_t>(ceilPixel(uMin, maxU));
+            rect.y0 = static_cast<int16_t>(ceilPixel(vMin, maxV));
+            rect.x1 = static_cast<int16_t>(ceilPixel(uMax, maxU) - 1);
+            rect.y1 = static_cast<int16_t>(ceilPixel(vMax, maxV) - 1);
+        }
+    }
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_DEPTH_REGISTER__H
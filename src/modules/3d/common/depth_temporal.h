@@ -0,0 +1,187 @@
+#ifndef _DS3D_COMMON_DEPTH_TEMPORAL__H
+#define _DS3D_COMMON_DEPTH_TEMPORAL__H
+
+#include "3d/common/common.h"
+#include "3d/common/depth_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @file temporal smoothing and hole filling kernels of uint16 depth
+ */
+
+namespace ds3d {
+
+/**
+ * @brief DepthTemporalParams of TemporalDepthRow.
+ *   A valid pixel within delta of the pixel history is blended into it with
+ *   weight alpha, larger changes are taken as they are so edges do not smear.
+ *   A hole (0) is filled with the history if the pixel was valid in at least
+ *   persistence of the last history frames.
+ */
+struct DepthTemporalParams {
+    uint16_t alpha = 102;  // weight of the new frame in 1/256, 256 disables smoothing
+    uint16_t delta = 20;  // in raw depth units, 0 disables smoothing
+    uint8_t persistence = 3;  // 0 disables hole filling
+    uint8_t history = 8;  // frames, 1 to 8
+
+    static uint16_t alphaFromFloat(float a) { return static_cast<uint16_t>(std::lround(std::clamp(a, 0.0f, 1.0f) * 256.0f)); }
+    uint8_t historyMask() const { return static_cast<uint8_t>((1u << std::clamp<uint32_t>(history, 1, 8)) - 1); }
+};
+
+namespace detail {
+
+inline void
+temporalDepthScalar(
+    const uint16_t* in, uint16_t* out, uint16_t* last, uint8_t* hist, size_t begin, size_t num,
+    const DepthTemporalParams& p)
+{
+    const bool smooth = p.delta && p.alpha < 256;
+    const uint8_t histMask = p.historyMask();
+    for (size_t i = begin; i < num; ++i) {
+        uint16_t d = in[i], prev = last[i];
+        bool valid = d != 0;
+        uint8_t h = static_cast<uint8_t>((hist[i] << 1) | (valid ? 1 : 0));
+        hist[i] = h;
+        if (valid) {
+            uint32_t diff = d > prev ? d - prev : prev - d;
+            if (smooth && prev && diff < p.delta) {
+                d = static_cast<uint16_t>((d * p.alpha + prev * (256u - p.alpha) + 128u) >> 8);
+            }
+            out[i] = last[i] = d;
+        } else {
+            bool fill = p.persistence && __builtin_popcount(h & histMask) >= p.persistence;
+            out[i] = fill ? prev : 0;
+        }
+    }
+}
+
+#if defined(DS3D_DEPTH_X86)
+__attribute__((target("avx2"))) inline size_t
+temporalDepthAVX2(
+    const uint16_t* in, uint16_t* out, uint16_t* last, uint8_t* hist, size_t num, const DepthTemporalParams& p)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_cmpeq_epi16(zero, zero);
+    const __m256i smoothOn = (p.delta && p.alpha < 256) ? ones : zero;
+    const __m256i deltaM1 = _mm256_set1_epi16(static_cast<int16_t>(p.delta ? p.delta - 1 : 0));
+    const __m256i alpha = _mm256_set1_epi32(p.alpha);
+    const __m256i beta = _mm256_set1_epi32(256 - p.alpha);
+    const __m256i round = _mm256_set1_epi32(128);
+    const __m128i histMask = _mm_set1_epi8(static_cast<char>(p.historyMask()));
+    const __m128i lowNibble = _mm_set1_epi8(0x0f);
+    const __m128i popLut = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    // persistence 0 compares against 127, which no popcount reaches
+    const __m128i minValid = _mm_set1_epi8(static_cast<char>(p.persistence ? p.persistence - 1 : 127));
+    size_t i = 0;
+    for (const size_t vecNum = num & ~static_cast<size_t>(15); i < vecNum; i += 16) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last + i));
+        __m256i valid = _mm256_xor_si256(_mm256_cmpeq_epi16(d, zero), ones);
+        __m256i prevOk = _mm256_xor_si256(_mm256_cmpeq_epi16(prev, zero), ones);
+
+        // |d - prev| < delta, unsigned
+        __m256i diff = _mm256_sub_epi16(_mm256_max_epu16(d, prev), _mm256_min_epu16(d, prev));
+        __m256i close = _mm256_cmpeq_epi16(_mm256_subs_epu16(diff, deltaM1), zero);
+        __m256i smooth = _mm256_and_si256(_mm256_and_si256(valid, prevOk), _mm256_and_si256(close, smoothOn));
+
+        // (d * alpha + prev * (256 - alpha) + 128) >> 8 in 32 bits
+        __m256i b[2];
+        for (int h = 0; h < 2; ++h) {
+            __m128i dh = h ? _mm256_extracti128_si256(d, 1) : _mm256_castsi256_si128(d);
+            __m128i ph = h ? _mm256_extracti128_si256(prev, 1) : _mm256_castsi256_si128(prev);
+            __m256i s = _mm256_add_epi32(
+                _mm256_mullo_epi32(_mm256_cvtepu16_epi32(dh), alpha), _mm256_mullo_epi32(_mm256_cvtepu16_epi32(ph), beta));
+            b[h] = _mm256_srli_epi32(_mm256_add_epi32(s, round), 8);
+        }
+        // packus works per 128-bit lane, restore the order afterwards
+        __m256i blended = _mm256_permute4x64_epi64(_mm256_packus_epi32(b[0], b[1]), _MM_SHUFFLE(3, 1, 2, 0));
+        __m256i val = _mm256_blendv_epi8(d, blended, smooth);
+
+        // history bits, bit 0 is this frame
+        __m128i valid8 = _mm_packs_epi16(_mm256_castsi256_si128(valid), _mm256_extracti128_si256(valid, 1));
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hist + i));
+        h = _mm_or_si128(_mm_add_epi8(h, h), _mm_and_si128(valid8, _mm_set1_epi8(1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hist + i), h);
+        __m128i hm = _mm_and_si128(h, histMask);
+        __m128i count = _mm_add_epi8(
+            _mm_shuffle_epi8(popLut, _mm_and_si128(hm, lowNibble)),
+            _mm_shuffle_epi8(popLut, _mm_and_si128(_mm_srli_epi16(hm, 4), lowNibble)));
+        __m256i fill = _mm256_cvtepi8_epi16(_mm_cmpgt_epi8(count, minValid));
+        fill = _mm256_andnot_si256(valid, _mm256_and_si256(fill, prevOk));
+
+        __m256i o = _mm256_or_si256(_mm256_and_si256(valid, val), _mm256_and_si256(fill, prev));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), o);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(last + i), _mm256_blendv_epi8(prev, val, valid));
+    }
+    return i;
+}
+
+#elif defined(DS3D_DEPTH_NEON)
+inline size_t
+temporalDepthNEON(
+    const uint16_t* in, uint16_t* out, uint16_t* last, uint8_t* hist, size_t num, const DepthTemporalParams& p)
+{
+    const uint16x8_t smoothOn = vdupq_n_u16((p.delta && p.alpha < 256) ? 0xffff : 0);
+    const uint16x8_t delta = vdupq_n_u16(p.delta);
+    const uint16_t alpha = p.alpha, beta = static_cast<uint16_t>(256 - p.alpha);
+    const uint8x8_t histMask = vdup_n_u8(p.historyMask());
+    // persistence 0 compares against 255, which no popcount reaches
+    const uint8x8_t minValid = vdup_n_u8(p.persistence ? p.persistence : 255);
+    size_t i = 0;
+    for (const size_t vecNum = num & ~static_cast<size_t>(7); i < vecNum; i += 8) {
+        uint16x8_t d = vld1q_u16(in + i);
+        uint16x8_t prev = vld1q_u16(last + i);
+        uint16x8_t valid = vtstq_u16(d, d);
+        uint16x8_t prevOk = vtstq_u16(prev, prev);
+        uint16x8_t close = vcltq_u16(vabdq_u16(d, prev), delta);
+        uint16x8_t smooth = vandq_u16(vandq_u16(valid, prevOk), vandq_u16(close, smoothOn));
+
+        // (d * alpha + prev * (256 - alpha) + 128) >> 8 in 32 bits, vrshrn adds the 128
+        uint32x4_t lo = vmlal_n_u16(vmull_n_u16(vget_low_u16(d), alpha), vget_low_u16(prev), beta);
+        uint32x4_t hi = vmlal_n_u16(vmull_n_u16(vget_high_u16(d), alpha), vget_high_u16(prev), beta);
+        uint16x8_t val = vbslq_u16(smooth, vcombine_u16(vrshrn_n_u32(lo, 8), vrshrn_n_u32(hi, 8)), d);
+
+        // history bits, bit 0 is this frame
+        uint8x8_t h = vld1_u8(hist + i);
+        h = vorr_u8(vshl_n_u8(h, 1), vand_u8(vmovn_u16(valid), vdup_n_u8(1)));
+        vst1_u8(hist + i, h);
+        uint8x8_t fill8 = vcge_u8(vcnt_u8(vand_u8(h, histMask)), minValid);
+        uint16x8_t fill = vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(fill8)));
+        fill = vbicq_u16(vandq_u16(fill, prevOk), valid);
+
+        vst1q_u16(out + i, vorrq_u16(vandq_u16(valid, val), vandq_u16(fill, prev)));
+        vst1q_u16(last + i, vbslq_u16(valid, val, prev));
+    }
+    return i;
+}
+#endif
+
+}  // namespace detail
+
+/**
+ * @brief smooth num depth values against their history and fill holes, see
+ *   DepthTemporalParams. last (the history values, 0 when none) and hist
+ *   (validity bits of the last 8 frames) persist between frames and are
+ *   updated in place, zero them to reset. in and out may be the same.
+ *   Uses AVX2 when the CPU has it, NEON on aarch64.
+ */
+inline void
+TemporalDepthRow(
+    const uint16_t* in, uint16_t* out, uint16_t* last, uint8_t* hist, size_t num, const DepthTemporalParams& params)
+{
+    size_t i = 0;
+#if defined(DS3D_DEPTH_X86)
+    if (detail::depthIsa() != detail::DepthIsa::kScalar) {
+        i = detail::temporalDepthAVX2(in, out, last, hist, num, params);
+    }
+#elif defined(DS3D_DEPTH_NEON)
+    i = detail::temporalDepthNEON(in, out, last, hist, num, params);
+#endif
+    detail::temporalDepthScalar(in, out, last, hist, i, num, params);
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_DEPTH_TEMPORAL__H
@@ -0,0 +1,190 @@
+#ifndef _DS3D_COMMON_DEPTH_UNPROJECT__H
+#define _DS3D_COMMON_DEPTH_UNPROJECT__H
+
+#include "3d/common/common.h"
+#include "3d/common/idatatype.h"
+
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define DS3D_UNPROJECT_SSE 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DS3D_UNPROJECT_NEON 1
+#endif
+
+/**
+ * @file pinhole unprojection of uint16 depth rows to points and color texture coordinates
+ */
+
+namespace ds3d {
+
+/**
+ * @brief rays of a pinhole depth camera. The ray of pixel (x, y) is
+ *   (rayX[x], rayY[y], 1), so a table of width + height floats covers the
+ *   whole frame and stays in L1, unlike a per-pixel table of 2 x width x height.
+ */
+struct DepthRayLut {
+    IntrinsicsParam intrinsics;
+    std::vector<float> rayX;
+    std::vector<float> rayY;
+
+    bool matches(const IntrinsicsParam& p) const
+    {
+        return !rayX.empty() && p.width == intrinsics.width && p.height == intrinsics.height &&
+               p.centerX == intrinsics.centerX && p.centerY == intrinsics.centerY && p.fx == intrinsics.fx &&
+               p.fy == intrinsics.fy;
+    }
+};
+
+inline bool
+BuildDepthRayLut(const IntrinsicsParam& p, DepthRayLut& lut)
+{
+    if (!p.width || !p.height || p.fx == 0.0f || p.fy == 0.0f) {
+        return false;
+    }
+    lut.intrinsics = p;
+    lut.rayX.resize(p.width);
+    lut.rayY.resize(p.height);
+    for (uint32_t x = 0; x < p.width; ++x) {
+        lut.rayX[x] = (static_cast<float>(x) - p.centerX) / p.fx;
+    }
+    for (uint32_t y = 0; y < p.height; ++y) {
+        lut.rayY[y] = (static_cast<float>(y) - p.centerY) / p.fy;
+    }
+    return true;
+}
+
+// depth camera space -> color texture coordinates normalized to [0, 1] by the color size
+struct ColorProjection {
+    float r[3][3];  // row-major rotation
+    float t[3];
+    float fx, fy, cx, cy;  // normalized color intrinsics
+};
+
+inline bool
+MakeColorProjection(const IntrinsicsParam& color, const ExtrinsicsParam& depth2color, ColorProjection& proj)
+{
+    if (!color.width || !color.height) {
+        return false;
+    }
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            proj.r[row][col] = depth2color.rotation[col].data[row];  // column-major
+        }
+        proj.t[row] = depth2color.translation.data[row];
+    }
+    proj.fx = color.fx / static_cast<float>(color.width);
+    proj.fy = color.fy / static_cast<float>(color.height);
+    proj.cx = color.centerX / static_cast<float>(color.width);
+    proj.cy = color.centerY / static_cast<float>(color.height);
+    return true;
+}
+
+/**
+ * @brief unproject one depth row: xyz receives width x 3 floats, point =
+ *   depth * scale * (rayX[x], rayY, 1). Invalid depth (0) gives (0, 0, 0).
+ *   uv, if not null, receives width x 2 texture coordinates of the points
+ *   in the color image, (0, 0) for invalid depth or points behind the color
+ *   camera.
+ */
+inline void
+UnprojectDepthRow(
+    const uint16_t* depth, uint32_t width, float scale, const float* rayX, float rayY, float* xyz, float* uv,
+    const ColorProjection* proj)
+{
+    const float (*r)[3] = proj ? proj->r : nullptr;
+    uint32_t i = 0;
+    const uint32_t vecNum = width & ~3u;  // 4 pixels per step
+#if defined(DS3D_UNPROJECT_SSE)
+    const __m128 vScale = _mm_set1_ps(scale);
+    const __m128 vRayY = _mm_set1_ps(rayY);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i < vecNum; i += 4) {
+        __m128i d = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(depth + i));
+        d = _mm_unpacklo_epi16(d, _mm_setzero_si128());
+        __m128 vz = _mm_mul_ps(_mm_cvtepi32_ps(d), vScale);
+        __m128 vx = _mm_mul_ps(_mm_loadu_ps(rayX + i), vz);
+        __m128 vy = _mm_mul_ps(vRayY, vz);
+        // interleave as PlanarToPointXYZ
+        __m128 xy = _mm_shuffle_ps(vx, vy, _MM_SHUFFLE(0, 0, 0, 0));
+        __m128 zx = _mm_shuffle_ps(vz, vx, _MM_SHUFFLE(1, 1, 0, 0));
+        __m128 yz = _mm_shuffle_ps(vy, vz, _MM_SHUFFLE(1, 1, 1, 1));
+        float* p = xyz + i * 3;
+        _mm_storeu_ps(p, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+        xy = _mm_shuffle_ps(vx, vy, _MM_SHUFFLE(2, 2, 2, 2));
+        _mm_storeu_ps(p + 4, _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(2, 0, 2, 0)));
+        zx = _mm_shuffle_ps(vz, vx, _MM_SHUFFLE(3, 3, 2, 2));
+        yz = _mm_shuffle_ps(vy, vz, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm_storeu_ps(p + 8, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(2, 0, 2, 0)));
+        if (!uv) {
+            continue;
+        }
+        __m128 c[3];
+        for (int row = 0; row < 3; ++row) {
+            c[row] = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(r[row][0])), _mm_mul_ps(vy, _mm_set1_ps(r[row][1]))),
+                _mm_add_ps(_mm_mul_ps(vz, _mm_set1_ps(r[row][2])), _mm_set1_ps(proj->t[row])));
+        }
+        __m128 valid = _mm_and_ps(_mm_cmpgt_ps(vz, zero), _mm_cmpgt_ps(c[2], zero));
+        __m128 invZ = _mm_div_ps(_mm_set1_ps(1.0f), c[2]);
+        __m128 u = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(c[0], invZ), _mm_set1_ps(proj->fx)), _mm_set1_ps(proj->cx));
+        __m128 v = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(c[1], invZ), _mm_set1_ps(proj->fy)), _mm_set1_ps(proj->cy));
+        u = _mm_and_ps(u, valid);
+        v = _mm_and_ps(v, valid);
+        _mm_storeu_ps(uv + i * 2, _mm_unpacklo_ps(u, v));
+        _mm_storeu_ps(uv + i * 2 + 4, _mm_unpackhi_ps(u, v));
+    }
+#elif defined(DS3D_UNPROJECT_NEON)
+    for (; i < vecNum; i += 4) {
+        float32x4x3_t p;
+        p.val[2] = vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vld1_u16(depth + i))), scale);
+        p.val[0] = vmulq_f32(vld1q_f32(rayX + i), p.val[2]);
+        p.val[1] = vmulq_n_f32(p.val[2], rayY);
+        vst3q_f32(xyz + i * 3, p);
+        if (!uv) {
+            continue;
+        }
+        float32x4_t c[3];
+        for (int row = 0; row < 3; ++row) {
+            c[row] = vmlaq_n_f32(vdupq_n_f32(proj->t[row]), p.val[0], r[row][0]);
+            c[row] = vmlaq_n_f32(c[row], p.val[1], r[row][1]);
+            c[row] = vmlaq_n_f32(c[row], p.val[2], r[row][2]);
+        }
+        uint32x4_t valid = vandq_u32(vcgtq_f32(p.val[2], vdupq_n_f32(0.0f)), vcgtq_f32(c[2], vdupq_n_f32(0.0f)));
+        float32x4_t invZ = vdivq_f32(vdupq_n_f32(1.0f), c[2]);
+        float32x4x2_t o;
+        o.val[0] = vmlaq_n_f32(vdupq_n_f32(proj->cx), vmulq_f32(c[0], invZ), proj->fx);
+        o.val[1] = vmlaq_n_f32(vdupq_n_f32(proj->cy), vmulq_f32(c[1], invZ), proj->fy);
+        o.val[0] = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(o.val[0]), valid));
+        o.val[1] = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(o.val[1]), valid));
+        vst2q_f32(uv + i * 2, o);
+    }
+#endif
+    for (; i < width; ++i) {
+        float z = static_cast<float>(depth[i]) * scale;
+        float* p = xyz + i * 3;
+        p[0] = rayX[i] * z;
+        p[1] = rayY * z;
+        p[2] = z;
+        if (!uv) {
+            continue;
+        }
+        float c[3];
+        for (int row = 0; row < 3; ++row) {
+            c[row] = p[0] * r[row][0] + p[1] * r[row][1] + p[2] * r[row][2] + proj->t[row];
+        }
+        if (z > 0.0f && c[2] > 0.0f) {
+            float invZ = 1.0f / c[2];
+            uv[i * 2] = c[0] * invZ * proj->fx + proj->cx;
+            uv[i * 2 + 1] = c[1] * invZ * proj->fy + proj->cy;
+        } else {
+            uv[i * 2] = uv[i * 2 + 1] = 0.0f;
+        }
+    }
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_DEPTH_UNPROJECT__H
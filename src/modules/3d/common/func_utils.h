@@ -5,6 +5,8 @@
 #include "3d/common/common.h"
 
 #include <algorithm>
+#include <cstdlib>
+#include <numeric>
 
 /**
  * @file common function returns for dataTypes, errorCodes, and misc
@@ -14,6 +16,19 @@ namespace ds3d {
 
 using LockMutex = std::unique_lock<std::mutex>;
 
+// widest vector register of the build target, in bytes
+#if defined(__AVX512F__)
+constexpr uint32_t kSimdBytes = 64;
+#elif defined(__AVX2__) || defined(__AVX__)
+constexpr uint32_t kSimdBytes = 32;
+#else
+constexpr uint32_t kSimdBytes = 16;  // SSE2, NEON
+#endif
+
+// base alignment of frames allocated by ds3d, one cache line and the widest
+// vector register (AVX-512) regardless of the build target
+constexpr uint32_t kFrameAlignment = 64;
+
 inline bool
 isGood(ErrCode c)
 {
@@ -102,6 +117,7 @@ bytesPerPixel(FrameType f)
         DS_ASSERT(sizeof(T) == 1);
         return sizeof(T) * 3;
     case FrameType::kPointXYZ:
+    case FrameType::kPointNormal:
         return sizeof(T) * 3;
     case FrameType::kLidarXYZI:
         return sizeof(T) * 4;
@@ -137,6 +153,82 @@ dataTypeBytes(DataType t)
     }
 }
 
+// payload bytes of a datamap value by typeid, 0 for unknown types.
+// Frames report abiFrame::bytes(), plain structures their size.
+inline size_t
+typeIdBytes(TIdType tid, const void* data)
+{
+    switch (tid) {
+    case abiFrame::__typeid():
+        return data ? static_cast<const abiFrame*>(data)->bytes() : 0;
+#define __DS3D_TYPEID_BYTES(T) \
+    case TpId<T>::__typeid():  \
+        return sizeof(T)
+        __DS3D_TYPEID_BYTES(TimeStamp);
+        __DS3D_TYPEID_BYTES(DepthScale);
+        __DS3D_TYPEID_BYTES(IntrinsicsParam);
+        __DS3D_TYPEID_BYTES(ExtrinsicsParam);
+        __DS3D_TYPEID_BYTES(PointQuantParam);
+        __DS3D_TYPEID_BYTES(Shape);
+        __DS3D_TYPEID_BYTES(bool);
+        __DS3D_TYPEID_BYTES(float);
+        __DS3D_TYPEID_BYTES(double);
+        __DS3D_TYPEID_BYTES(int8_t);
+        __DS3D_TYPEID_BYTES(uint8_t);
+        __DS3D_TYPEID_BYTES(int16_t);
+        __DS3D_TYPEID_BYTES(uint16_t);
+        __DS3D_TYPEID_BYTES(int32_t);
+        __DS3D_TYPEID_BYTES(uint32_t);
+        __DS3D_TYPEID_BYTES(int64_t);
+#undef __DS3D_TYPEID_BYTES
+    default:
+        return 0;
+    }
+}
+
+// round v up to a multiple of align, align must be a power of 2
+constexpr size_t
+alignUp(size_t v, size_t align)
+{
+    return (v + align - 1) & ~(align - 1);
+}
+
+// row pitch of width pixels with the pitch padded to align bytes (power of 2)
+constexpr uint32_t
+alignedPitch(uint32_t width, uint32_t bytesPerPixel, uint32_t align = kFrameAlignment)
+{
+    return static_cast<uint32_t>(alignUp(static_cast<size_t>(width) * bytesPerPixel, align));
+}
+
+/**
+ * @brief tightest row pitch which lets a kernel loading vectorBytes at a time
+ *   run whole vectors over every row, the padding takes the row tail instead
+ *   of a scalar loop. The pitch is also a multiple of bytesPerPixel, so rows
+ *   of e.g. 3-byte RGB pixels pad to lcm(3, vectorBytes).
+ *   e.g. 848 x uint16 depth, 32B vectors -> 1696; 1920 x RGBA, 64B -> 7680
+ */
+inline uint32_t
+simdPitch(uint32_t width, uint32_t bytesPerPixel, uint32_t vectorBytes = kSimdBytes)
+{
+    DS_ASSERT(bytesPerPixel && vectorBytes);
+    uint32_t unit = std::lcm(bytesPerPixel, vectorBytes);
+    uint32_t rowBytes = width * bytesPerPixel;
+    return (rowBytes + unit - 1) / unit * unit;
+}
+
+// aligned CPU allocation for frame buffers, release with AlignedFree
+inline void*
+AlignedAlloc(size_t bytes, size_t align = kFrameAlignment)
+{
+    return std::aligned_alloc(align, alignUp(std::max<size_t>(bytes, 1), align));
+}
+
+inline void
+AlignedFree(void* ptr)
+{
+    std::free(ptr);
+}
+
 inline size_t
 ShapeSize(const Shape& shape)
 {
@@ -0,0 +1,186 @@
+#ifndef _DS3D_COMMON_HALF__H
+#define _DS3D_COMMON_HALF__H
+
+#include "3d/common/common.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DS3D_HALF_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DS3D_HALF_NEON 1
+#endif
+
+/**
+ * @file IEEE 754 binary16 storage type (DataType::kFp16) and float conversions
+ */
+
+namespace ds3d {
+
+namespace detail {
+
+// round to nearest even, overflow to inf, NaN stays NaN
+inline uint16_t
+floatToHalfBits(float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t mant = x & 0x007fffff;
+    int32_t exp = static_cast<int32_t>((x >> 23) & 0xff);
+    if (exp == 0xff) {
+        return static_cast<uint16_t>(sign | 0x7c00 | (mant ? 0x200 | (mant >> 13) : 0));
+    }
+    int32_t e = exp - 127 + 15;
+    if (e >= 0x1f) {
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+    if (e <= 0) {  // subnormal half
+        if (e < -10) {
+            return static_cast<uint16_t>(sign);
+        }
+        mant |= 0x00800000;
+        uint32_t shift = static_cast<uint32_t>(14 - e);
+        uint32_t h = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        h += (rem > halfway || (rem == halfway && (h & 1))) ? 1 : 0;
+        return static_cast<uint16_t>(sign | h);
+    }
+    uint32_t h = (static_cast<uint32_t>(e) << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1fff;
+    h += (rem > 0x1000 || (rem == 0x1000 && (h & 1))) ? 1 : 0;  // a carry rounds up the exponent
+    return static_cast<uint16_t>(sign | h);
+}
+
+inline float
+halfBitsToFloat(uint16_t h)
+{
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t x;
+    if (exp == 0x1f) {
+        x = sign | 0x7f800000 | (mant << 13);
+    } else if (exp) {
+        x = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    } else if (!mant) {
+        x = sign;
+    } else {  // subnormal half, normalize
+        exp = 127 - 15 + 1;
+        while (!(mant & 0x400)) {
+            mant <<= 1;
+            --exp;
+        }
+        x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+#if defined(DS3D_HALF_X86)
+__attribute__((target("avx,f16c"))) inline void
+floatToHalfF16C(const float* in, uint16_t* out, size_t num)
+{
+    size_t i = 0;
+    for (const size_t vecNum = num & ~static_cast<size_t>(7); i < vecNum; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+    }
+    for (; i < num; ++i) {
+        out[i] = floatToHalfBits(in[i]);
+    }
+}
+
+__attribute__((target("avx,f16c"))) inline void
+halfToFloatF16C(const uint16_t* in, float* out, size_t num)
+{
+    size_t i = 0;
+    for (const size_t vecNum = num & ~static_cast<size_t>(7); i < vecNum; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+    }
+    for (; i < num; ++i) {
+        out[i] = halfBitsToFloat(in[i]);
+    }
+}
+
+// F16C is not part of the x86-64 baseline, check the CPU once
+inline bool
+cpuHasF16C()
+{
+#if defined(__F16C__)
+    return true;
+#else
+    static const bool has = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    return has;
+#endif
+}
+#endif
+
+}  // namespace detail
+
+/**
+ * @brief 16-bit float storage. Arithmetic is done in float: convert with
+ *   static_cast<float>(h) / Half(f) per value, or FloatToHalf/HalfToFloat
+ *   for arrays, which use F16C on x86 when the CPU has it and NEON on aarch64.
+ */
+struct Half {
+    uint16_t bits = 0;
+
+    Half() = default;
+    explicit Half(float f) : bits(detail::floatToHalfBits(f)) {}
+    explicit operator float() const { return detail::halfBitsToFloat(bits); }
+    static Half fromBits(uint16_t b)
+    {
+        Half h;
+        h.bits = b;
+        return h;
+    }
+};
+static_assert(sizeof(Half) == 2, "Half must be 16 bits");
+
+inline void
+FloatToHalf(const float* in, Half* out, size_t num)
+{
+    uint16_t* o = reinterpret_cast<uint16_t*>(out);
+    size_t i = 0;
+#if defined(DS3D_HALF_X86)
+    if (detail::cpuHasF16C()) {
+        detail::floatToHalfF16C(in, o, num);
+        return;
+    }
+#elif defined(DS3D_HALF_NEON)
+    for (const size_t vecNum = num & ~static_cast<size_t>(3); i < vecNum; i += 4) {
+        vst1_u16(o + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in + i))));
+    }
+#endif
+    for (; i < num; ++i) {
+        o[i] = detail::floatToHalfBits(in[i]);
+    }
+}
+
+inline void
+HalfToFloat(const Half* in, float* out, size_t num)
+{
+    const uint16_t* h = reinterpret_cast<const uint16_t*>(in);
+    size_t i = 0;
+#if defined(DS3D_HALF_X86)
+    if (detail::cpuHasF16C()) {
+        detail::halfToFloatF16C(h, out, num);
+        return;
+    }
+#elif defined(DS3D_HALF_NEON)
+    for (const size_t vecNum = num & ~static_cast<size_t>(3); i < vecNum; i += 4) {
+        vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(h + i))));
+    }
+#endif
+    for (; i < num; ++i) {
+        out[i] = detail::halfBitsToFloat(h[i]);
+    }
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_HALF__H
@@ -83,6 +83,8 @@ enum class FrameType : int {
     kPointXYZ = 32,
     kPointCoordUV = 33,
     kLidarXYZI = 34,
+    kPointXYZPlanar = 35,  // 3 rows X, Y, Z of N points, see kPointXYZPlanar key
+    kPointNormal = 36,  // N x 3 unit normals, see kPointNormal key
     kCustom = 255,
 };
 
@@ -130,6 +132,13 @@ struct ExtrinsicsParam {
     REGISTER_TYPE_ID(DS3D_TYPEID_EXTRINSIC_PARM)
 };
 
+// int16 point coordinates: value = q * scale + offset, per axis. q = -32768 marks a non-finite point
+struct PointQuantParam {
+    vec3f scale;
+    vec3f offset;
+    REGISTER_TYPE_ID(DS3D_TYPEID_POINT_QUANT_PARM)
+};
+
 }  // namespace ds3d
 
 #endif  // _DS3D_COMMON_IDATATYPE__H
\ No newline at end of file
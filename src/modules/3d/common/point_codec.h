@@ -0,0 +1,291 @@
+#ifndef _DS3D_COMMON_POINT_CODEC__H
+#define _DS3D_COMMON_POINT_CODEC__H
+
+#include "3d/common/common.h"
+#include "3d/common/idatatype.h"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define DS3D_POINT_CODEC_SSE 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DS3D_POINT_CODEC_NEON 1
+#endif
+
+/**
+ * @file int16 quantization of interleaved N x 3 float point clouds
+ */
+
+namespace ds3d {
+
+// int16 code of the points with a non-finite coordinate, on all 3 axes. Finite
+// points are spread over [-32767, 32767], dequantizing the code gives NaN.
+static constexpr int16_t kPointQuantInvalid = std::numeric_limits<int16_t>::min();
+
+namespace detail {
+
+inline bool
+pointFinite(const float* p)
+{
+    return std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2]);
+}
+
+inline void
+pointBoundsScalar(const float* xyz, size_t num, float* mn, float* mx)
+{
+    for (const float* p = xyz; num; --num, p += 3) {
+        if (!pointFinite(p)) {
+            continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+            mn[c] = std::min(mn[c], p[c]);
+            mx[c] = std::max(mx[c], p[c]);
+        }
+    }
+}
+
+inline void
+pointQuantizeScalar(const float* xyz, int16_t* q, size_t num, const float* off, const float* inv)
+{
+    for (const float* p = xyz; num; --num, p += 3, q += 3) {
+        if (!pointFinite(p)) {
+            q[0] = q[1] = q[2] = kPointQuantInvalid;
+            continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+            float s = std::nearbyint((p[c] - off[c]) * inv[c]);
+            q[c] = static_cast<int16_t>(std::min(std::max(s, -32767.0f), 32767.0f));
+        }
+    }
+}
+
+#if defined(DS3D_POINT_CODEC_SSE)
+// all 12 lanes of 4 interleaved points are finite, x - x is 0 for finite x only
+inline bool
+pointsFiniteSSE(__m128 a, __m128 b, __m128 c)
+{
+    const __m128 zero = _mm_setzero_ps();
+    __m128 fin = _mm_and_ps(
+        _mm_cmpeq_ps(_mm_sub_ps(a, a), zero),
+        _mm_and_ps(_mm_cmpeq_ps(_mm_sub_ps(b, b), zero), _mm_cmpeq_ps(_mm_sub_ps(c, c), zero)));
+    return _mm_movemask_ps(fin) == 0xF;
+}
+#elif defined(DS3D_POINT_CODEC_NEON)
+// per point mask of 4 deinterleaved points
+inline uint32x4_t
+pointsFiniteNEON(const float32x4x3_t& v)
+{
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    uint32x4_t fin = vceqq_f32(vsubq_f32(v.val[0], v.val[0]), zero);
+    fin = vandq_u32(fin, vceqq_f32(vsubq_f32(v.val[1], v.val[1]), zero));
+    return vandq_u32(fin, vceqq_f32(vsubq_f32(v.val[2], v.val[2]), zero));
+}
+#endif
+
+}  // namespace detail
+
+// per-axis min/max of the finite N x 3 points, points with a NaN or inf
+// coordinate are skipped. min > max when no point is finite.
+inline void
+PointXYZBounds(const float* xyz, size_t num, vec3f& minV, vec3f& maxV)
+{
+    float mn[3], mx[3];
+    for (int c = 0; c < 3; ++c) {
+        mn[c] = std::numeric_limits<float>::max();
+        mx[c] = std::numeric_limits<float>::lowest();
+    }
+    size_t i = 0;
+    const size_t vecNum = num & ~static_cast<size_t>(3);  // 4 points per step
+#if defined(DS3D_POINT_CODEC_SSE)
+    if (vecNum) {
+        // lanes of the 3 loads: (x y z x), (y z x y), (z x y z)
+        __m128 mn0 = _mm_set1_ps(mn[0]), mn1 = mn0, mn2 = mn0;
+        __m128 mx0 = _mm_set1_ps(mx[0]), mx1 = mx0, mx2 = mx0;
+        for (; i < vecNum; i += 4) {
+            const float* p = xyz + i * 3;
+            __m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+            if (!detail::pointsFiniteSSE(a, b, c)) {
+                detail::pointBoundsScalar(p, 4, mn, mx);
+                continue;
+            }
+            mn0 = _mm_min_ps(mn0, a);
+            mn1 = _mm_min_ps(mn1, b);
+            mn2 = _mm_min_ps(mn2, c);
+            mx0 = _mm_max_ps(mx0, a);
+            mx1 = _mm_max_ps(mx1, b);
+            mx2 = _mm_max_ps(mx2, c);
+        }
+        alignas(16) float l[3][4], h[3][4];
+        _mm_store_ps(l[0], mn0), _mm_store_ps(l[1], mn1), _mm_store_ps(l[2], mn2);
+        _mm_store_ps(h[0], mx0), _mm_store_ps(h[1], mx1), _mm_store_ps(h[2], mx2);
+        for (int v = 0; v < 3; ++v) {
+            for (int lane = 0; lane < 4; ++lane) {
+                int c = (v * 4 + lane) % 3;
+                mn[c] = std::min(mn[c], l[v][lane]);
+                mx[c] = std::max(mx[c], h[v][lane]);
+            }
+        }
+    }
+#elif defined(DS3D_POINT_CODEC_NEON)
+    if (vecNum) {
+        float32x4_t l[3], h[3];
+        const float32x4_t lowest = vdupq_n_f32(mx[0]), highest = vdupq_n_f32(mn[0]);
+        for (int c = 0; c < 3; ++c) {
+            l[c] = highest;
+            h[c] = lowest;
+        }
+        for (; i < vecNum; i += 4) {
+            float32x4x3_t v = vld3q_f32(xyz + i * 3);
+            uint32x4_t fin = detail::pointsFiniteNEON(v);
+            for (int c = 0; c < 3; ++c) {
+                l[c] = vminq_f32(l[c], vbslq_f32(fin, v.val[c], highest));
+                h[c] = vmaxq_f32(h[c], vbslq_f32(fin, v.val[c], lowest));
+            }
+        }
+        for (int c = 0; c < 3; ++c) {
+            mn[c] = vminvq_f32(l[c]);
+            mx[c] = vmaxvq_f32(h[c]);
+        }
+    }
+#endif
+    detail::pointBoundsScalar(xyz + i * 3, num - i, mn, mx);
+    for (int c = 0; c < 3; ++c) {
+        minV.data[c] = mn[c];
+        maxV.data[c] = mx[c];
+    }
+}
+
+// spread [minV, maxV] over [-32767, 32767], the step is (max - min) / 65534 per axis.
+// -32768 is left for kPointQuantInvalid.
+inline PointQuantParam
+PointQuantParamFromBounds(const vec3f& minV, const vec3f& maxV)
+{
+    PointQuantParam param;
+    for (int c = 0; c < 3; ++c) {
+        float range = maxV.data[c] - minV.data[c];
+        if (range > 0.0f && std::isfinite(range)) {
+            param.scale.data[c] = range / 65534.0f;
+            param.offset.data[c] = minV.data[c] + 32767.0f * param.scale.data[c];
+        } else {  // flat axis maps to q = 0, no points at all to the identity
+            param.scale.data[c] = 1.0f;
+            param.offset.data[c] = range == 0.0f ? minV.data[c] : 0.0f;
+        }
+    }
+    return param;
+}
+
+// q = round((v - offset) / scale), saturated to [-32767, 32767]. A point
+// with a non-finite coordinate is kPointQuantInvalid on all 3 axes.
+inline void
+QuantizePointXYZ(const float* xyz, int16_t* q, size_t num, const PointQuantParam& param)
+{
+    float inv[3], off[3];
+    for (int c = 0; c < 3; ++c) {
+        inv[c] = 1.0f / param.scale.data[c];
+        off[c] = param.offset.data[c];
+    }
+    size_t i = 0;
+    const size_t vecNum = num & ~static_cast<size_t>(3);
+#if defined(DS3D_POINT_CODEC_SSE)
+    const __m128 inv0 = _mm_setr_ps(inv[0], inv[1], inv[2], inv[0]);
+    const __m128 inv1 = _mm_setr_ps(inv[1], inv[2], inv[0], inv[1]);
+    const __m128 inv2 = _mm_setr_ps(inv[2], inv[0], inv[1], inv[2]);
+    const __m128 off0 = _mm_setr_ps(off[0], off[1], off[2], off[0]);
+    const __m128 off1 = _mm_setr_ps(off[1], off[2], off[0], off[1]);
+    const __m128 off2 = _mm_setr_ps(off[2], off[0], off[1], off[2]);
+    const __m128 lo = _mm_set1_ps(-32767.0f), hi = _mm_set1_ps(32767.0f);
+    for (; i < vecNum; i += 4) {
+        const float* p = xyz + i * 3;
+        int16_t* o = q + i * 3;
+        __m128 va = _mm_loadu_ps(p), vb = _mm_loadu_ps(p + 4), vc = _mm_loadu_ps(p + 8);
+        if (!detail::pointsFiniteSSE(va, vb, vc)) {
+            detail::pointQuantizeScalar(p, o, 4, off, inv);
+            continue;
+        }
+        __m128i a = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(va, off0), inv0), lo), hi));
+        __m128i b = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(vb, off1), inv1), lo), hi));
+        __m128i c = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(vc, off2), inv2), lo), hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(o), _mm_packs_epi32(a, b));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(o + 8), _mm_packs_epi32(c, c));
+    }
+#elif defined(DS3D_POINT_CODEC_NEON)
+    const float32x4_t lo = vdupq_n_f32(-32767.0f), hi = vdupq_n_f32(32767.0f);
+    const int16x4_t invalid = vdup_n_s16(kPointQuantInvalid);
+    for (; i < vecNum; i += 4) {
+        float32x4x3_t v = vld3q_f32(xyz + i * 3);
+        uint16x4_t fin = vmovn_u32(detail::pointsFiniteNEON(v));
+        int16x4x3_t o;
+        for (int c = 0; c < 3; ++c) {
+            float32x4_t s = vmulq_n_f32(vsubq_f32(v.val[c], vdupq_n_f32(off[c])), inv[c]);
+            s = vminq_f32(vmaxq_f32(s, lo), hi);
+            o.val[c] = vbsl_s16(fin, vmovn_s32(vcvtnq_s32_f32(s)), invalid);
+        }
+        vst3_s16(q + i * 3, o);
+    }
+#endif
+    detail::pointQuantizeScalar(xyz + i * 3, q + i * 3, num - i, off, inv);
+}
+
+// v = q * scale + offset, kPointQuantInvalid decodes to NaN
+inline void
+DequantizePointXYZ(const int16_t* q, float* xyz, size_t num, const PointQuantParam& param)
+{
+    const float* scale = param.scale.data;
+    const float* off = param.offset.data;
+    size_t i = 0;
+    const size_t vecNum = num & ~static_cast<size_t>(3);
+#if defined(DS3D_POINT_CODEC_SSE)
+    const __m128 s0 = _mm_setr_ps(scale[0], scale[1], scale[2], scale[0]);
+    const __m128 s1 = _mm_setr_ps(scale[1], scale[2], scale[0], scale[1]);
+    const __m128 s2 = _mm_setr_ps(scale[2], scale[0], scale[1], scale[2]);
+    const __m128 off0 = _mm_setr_ps(off[0], off[1], off[2], off[0]);
+    const __m128 off1 = _mm_setr_ps(off[1], off[2], off[0], off[1]);
+    const __m128 off2 = _mm_setr_ps(off[2], off[0], off[1], off[2]);
+    const __m128i invalid = _mm_set1_epi32(kPointQuantInvalid);
+    // all bits set is a NaN
+    auto decode = [invalid](__m128i v, __m128 s, __m128 o) {
+        return _mm_or_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(v), s), o), _mm_castsi128_ps(_mm_cmpeq_epi32(v, invalid)));
+    };
+    for (; i < vecNum; i += 4) {
+        const int16_t* in = q + i * 3;
+        __m128i ab = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i cc = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + 8));
+        // sign extend int16 -> int32
+        __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(ab, ab), 16);
+        __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(ab, ab), 16);
+        __m128i c = _mm_srai_epi32(_mm_unpacklo_epi16(cc, cc), 16);
+        float* p = xyz + i * 3;
+        _mm_storeu_ps(p, decode(a, s0, off0));
+        _mm_storeu_ps(p + 4, decode(b, s1, off1));
+        _mm_storeu_ps(p + 8, decode(c, s2, off2));
+    }
+#elif defined(DS3D_POINT_CODEC_NEON)
+    const int32x4_t invalid = vdupq_n_s32(kPointQuantInvalid);
+    for (; i < vecNum; i += 4) {
+        int16x4x3_t v = vld3_s16(q + i * 3);
+        float32x4x3_t o;
+        for (int c = 0; c < 3; ++c) {
+            int32x4_t w = vmovl_s16(v.val[c]);
+            float32x4_t f = vmlaq_n_f32(vdupq_n_f32(off[c]), vcvtq_f32_s32(w), scale[c]);
+            // all bits set is a NaN
+            o.val[c] = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(f), vceqq_s32(w, invalid)));
+        }
+        vst3q_f32(xyz + i * 3, o);
+    }
+#endif
+    for (float* p = xyz + i * 3; i < num; ++i, p += 3) {
+        for (int c = 0; c < 3; ++c) {
+            const int16_t v = q[i * 3 + c];
+            p[c] = v == kPointQuantInvalid ? std::numeric_limits<float>::quiet_NaN()
+                                           : static_cast<float>(v) * scale[c] + off[c];
+        }
+    }
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_POINT_CODEC__H
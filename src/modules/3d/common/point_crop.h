@@ -0,0 +1,277 @@
+#ifndef _DS3D_COMMON_POINT_CROP__H
+#define _DS3D_COMMON_POINT_CROP__H
+
+#include "3d/common/common.h"
+#include "3d/common/depth_kernels.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+/**
+ * @file point classify and stream compaction kernels of the point cloud crop
+ */
+
+namespace ds3d {
+
+// A point is kept when all tests hold:
+//   lo <= p <= hi per axis, minDist2 <= |p|^2 <= maxDist2,
+//   |x| <= z * slopeX + slack and |y| <= z * slopeY + slack.
+// Defaults keep every valid point. minDist2 above 0 and maxDist2 below inf
+// also drop invalid points, (0, 0, 0) or non-finite.
+struct CropBounds {
+    float lo[3] = {-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+                   -std::numeric_limits<float>::infinity()};
+    float hi[3] = {std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(),
+                   std::numeric_limits<float>::infinity()};
+    float minDist2 = std::numeric_limits<float>::denorm_min();
+    float maxDist2 = std::numeric_limits<float>::max();
+    float slopeX = 0.0f;
+    float slopeY = 0.0f;
+    float slack = std::numeric_limits<float>::max();
+};
+
+// points are classified in words of 16, bit i of masks[w] is point w * 16 + i
+constexpr size_t kCropWordPoints = 16;
+
+namespace detail {
+
+inline bool
+cropKeep(const float* p, const CropBounds& b)
+{
+    const float x = p[0], y = p[1], z = p[2];
+    const float d2 = x * x + y * y + z * z;
+    return x >= b.lo[0] && x <= b.hi[0] && y >= b.lo[1] && y <= b.hi[1] && z >= b.lo[2] && z <= b.hi[2] &&
+           d2 >= b.minDist2 && d2 <= b.maxDist2 && std::fabs(x) <= z * b.slopeX + b.slack &&
+           std::fabs(y) <= z * b.slopeY + b.slack;
+}
+
+inline size_t
+cropClassifyScalar(const float* xyz, size_t i, size_t end, const CropBounds& b, uint16_t* masks)
+{
+    size_t kept = 0;
+    for (; i < end; i += kCropWordPoints) {
+        uint32_t word = 0;
+        for (size_t j = i, wordEnd = std::min(end, i + kCropWordPoints); j < wordEnd; ++j) {
+            word |= static_cast<uint32_t>(cropKeep(xyz + j * 3, b)) << (j - i);
+        }
+        masks[i / kCropWordPoints] = static_cast<uint16_t>(word);
+        kept += static_cast<size_t>(__builtin_popcount(word));
+    }
+    return kept;
+}
+
+// copies the kept points of [i, end) to outXYZ and outUV, whole words with a
+// single copy, returns the points written
+inline size_t
+cropCompactScalar(
+    const float* xyz, const float* uv, const uint16_t* masks, size_t i, size_t end, float* outXYZ, float* outUV)
+{
+    size_t n = 0;
+    for (; i < end; i += kCropWordPoints) {
+        uint32_t word = masks[i / kCropWordPoints];
+        if (word == 0xffff && i + kCropWordPoints <= end) {
+            memcpy(outXYZ + n * 3, xyz + i * 3, kCropWordPoints * 3 * sizeof(float));
+            if (uv) {
+                memcpy(outUV + n * 2, uv + i * 2, kCropWordPoints * 2 * sizeof(float));
+            }
+            n += kCropWordPoints;
+            continue;
+        }
+        for (; word; word &= word - 1) {
+            size_t j = i + static_cast<size_t>(__builtin_ctz(word));
+            outXYZ[n * 3] = xyz[j * 3];
+            outXYZ[n * 3 + 1] = xyz[j * 3 + 1];
+            outXYZ[n * 3 + 2] = xyz[j * 3 + 2];
+            if (uv) {
+                outUV[n * 2] = uv[j * 2];
+                outUV[n * 2 + 1] = uv[j * 2 + 1];
+            }
+            ++n;
+        }
+    }
+    return n;
+}
+
+#if defined(DS3D_DEPTH_X86)
+// 8 points per step, xyz is deinterleaved with blends and one permute per axis
+__attribute__((target("avx2"))) inline size_t
+cropClassifyAVX2(const float* xyz, size_t end, const CropBounds& b, uint16_t* masks, size_t& kept)
+{
+    const __m256i idxX = _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5);
+    const __m256i idxY = _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6);
+    const __m256i idxZ = _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7);
+    const __m256 lox = _mm256_set1_ps(b.lo[0]), loy = _mm256_set1_ps(b.lo[1]), loz = _mm256_set1_ps(b.lo[2]);
+    const __m256 hix = _mm256_set1_ps(b.hi[0]), hiy = _mm256_set1_ps(b.hi[1]), hiz = _mm256_set1_ps(b.hi[2]);
+    const __m256 minD2 = _mm256_set1_ps(b.minDist2), maxD2 = _mm256_set1_ps(b.maxDist2);
+    const __m256 slopeX = _mm256_set1_ps(b.slopeX), slopeY = _mm256_set1_ps(b.slopeY);
+    const __m256 slack = _mm256_set1_ps(b.slack);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    auto classify8 = [&](const float* p) __attribute__((target("avx2"))) {
+        __m256 a = _mm256_loadu_ps(p), c = _mm256_loadu_ps(p + 8), d = _mm256_loadu_ps(p + 16);
+        __m256 x = _mm256_permutevar8x32_ps(_mm256_blend_ps(_mm256_blend_ps(a, c, 0x92), d, 0x24), idxX);
+        __m256 y = _mm256_permutevar8x32_ps(_mm256_blend_ps(_mm256_blend_ps(a, c, 0x24), d, 0x49), idxY);
+        __m256 z = _mm256_permutevar8x32_ps(_mm256_blend_ps(_mm256_blend_ps(a, c, 0x49), d, 0x92), idxZ);
+        __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        __m256 m = _mm256_and_ps(_mm256_cmp_ps(x, lox, _CMP_GE_OQ), _mm256_cmp_ps(x, hix, _CMP_LE_OQ));
+        m = _mm256_and_ps(m, _mm256_and_ps(_mm256_cmp_ps(y, loy, _CMP_GE_OQ), _mm256_cmp_ps(y, hiy, _CMP_LE_OQ)));
+        m = _mm256_and_ps(m, _mm256_and_ps(_mm256_cmp_ps(z, loz, _CMP_GE_OQ), _mm256_cmp_ps(z, hiz, _CMP_LE_OQ)));
+        m = _mm256_and_ps(m, _mm256_and_ps(_mm256_cmp_ps(d2, minD2, _CMP_GE_OQ), _mm256_cmp_ps(d2, maxD2, _CMP_LE_OQ)));
+        __m256 limX = _mm256_add_ps(_mm256_mul_ps(z, slopeX), slack);
+        __m256 limY = _mm256_add_ps(_mm256_mul_ps(z, slopeY), slack);
+        m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_and_ps(x, absMask), limX, _CMP_LE_OQ));
+        m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_and_ps(y, absMask), limY, _CMP_LE_OQ));
+        return static_cast<uint32_t>(_mm256_movemask_ps(m));
+    };
+    size_t i = 0;
+    for (const size_t vecNum = end & ~(kCropWordPoints - 1); i < vecNum; i += kCropWordPoints) {
+        uint32_t word = classify8(xyz + i * 3) | (classify8(xyz + i * 3 + 24) << 8);
+        masks[i / kCropWordPoints] = static_cast<uint16_t>(word);
+        kept += static_cast<size_t>(__builtin_popcount(word));
+    }
+    return i;
+}
+
+// one word per step, xyz is deinterleaved with two permutes per axis
+__attribute__((target("avx512f"))) inline size_t
+cropClassifyAVX512(const float* xyz, size_t end, const CropBounds& b, uint16_t* masks, size_t& kept)
+{
+    // axis a of point k is value 3k + a of the 48 loaded, of the first two vectors below 32
+    const __m512i idxX = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 1, 4, 7, 10, 13);
+    const __m512i idxY = _mm512_setr_epi32(1, 4, 7, 10, 13, 16, 19, 22, 25, 28, 31, 2, 5, 8, 11, 14);
+    const __m512i idxZ = _mm512_setr_epi32(2, 5, 8, 11, 14, 17, 20, 23, 26, 29, 0, 3, 6, 9, 12, 15);
+    const __mmask16 thirdX = 0xf800, thirdY = 0xf800, thirdZ = 0xfc00;
+    const __m512 lox = _mm512_set1_ps(b.lo[0]), loy = _mm512_set1_ps(b.lo[1]), loz = _mm512_set1_ps(b.lo[2]);
+    const __m512 hix = _mm512_set1_ps(b.hi[0]), hiy = _mm512_set1_ps(b.hi[1]), hiz = _mm512_set1_ps(b.hi[2]);
+    const __m512 minD2 = _mm512_set1_ps(b.minDist2), maxD2 = _mm512_set1_ps(b.maxDist2);
+    const __m512 slopeX = _mm512_set1_ps(b.slopeX), slopeY = _mm512_set1_ps(b.slopeY);
+    const __m512 slack = _mm512_set1_ps(b.slack);
+    size_t i = 0;
+    for (const size_t vecNum = end & ~(kCropWordPoints - 1); i < vecNum; i += kCropWordPoints) {
+        const float* p = xyz + i * 3;
+        __m512 a = _mm512_loadu_ps(p), c = _mm512_loadu_ps(p + 16), d = _mm512_loadu_ps(p + 32);
+        __m512 x = _mm512_mask_permutexvar_ps(_mm512_permutex2var_ps(a, idxX, c), thirdX, idxX, d);
+        __m512 y = _mm512_mask_permutexvar_ps(_mm512_permutex2var_ps(a, idxY, c), thirdY, idxY, d);
+        __m512 z = _mm512_mask_permutexvar_ps(_mm512_permutex2var_ps(a, idxZ, c), thirdZ, idxZ, d);
+        __m512 d2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y)), _mm512_mul_ps(z, z));
+        __mmask16 m = _mm512_cmp_ps_mask(x, lox, _CMP_GE_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, x, hix, _CMP_LE_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, y, loy, _CMP_GE_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, y, hiy, _CMP_LE_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, z, loz, _CMP_GE_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, z, hiz, _CMP_LE_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, d2, minD2, _CMP_GE_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, d2, maxD2, _CMP_LE_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, _mm512_abs_ps(x), _mm512_add_ps(_mm512_mul_ps(z, slopeX), slack), _CMP_LE_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, _mm512_abs_ps(y), _mm512_add_ps(_mm512_mul_ps(z, slopeY), slack), _CMP_LE_OQ);
+        masks[i / kCropWordPoints] = m;
+        kept += static_cast<size_t>(__builtin_popcount(m));
+    }
+    return i;
+}
+
+// compress within registers and store with a prefix mask, compressing straight to memory is slow on some CPUs
+__attribute__((target("avx512f"))) inline float*
+cropCompress512(float* out, __mmask16 m, __m512 v)
+{
+    uint32_t n = static_cast<uint32_t>(__builtin_popcount(m));
+    _mm512_mask_storeu_ps(out, static_cast<__mmask16>((1u << n) - 1), _mm512_maskz_compress_ps(m, v));
+    return out + n;
+}
+
+// partial words are compressed, the 16 point masks are widened to the 48 xyz and 32 uv values
+__attribute__((target("avx512f,bmi2"))) inline size_t
+cropCompactAVX512(
+    const float* xyz, const float* uv, const uint16_t* masks, size_t end, float* outXYZ, float* outUV, size_t& n)
+{
+    size_t i = 0;
+    float* dst = outXYZ + n * 3;
+    float* dstUV = uv ? outUV + n * 2 : nullptr;
+    for (const size_t vecNum = end & ~(kCropWordPoints - 1); i < vecNum; i += kCropWordPoints) {
+        const uint32_t word = masks[i / kCropWordPoints];
+        if (!word) {
+            continue;
+        }
+        const float* p = xyz + i * 3;
+        if (word == 0xffff) {
+            _mm512_storeu_ps(dst, _mm512_loadu_ps(p));
+            _mm512_storeu_ps(dst + 16, _mm512_loadu_ps(p + 16));
+            _mm512_storeu_ps(dst + 32, _mm512_loadu_ps(p + 32));
+            dst += 48;
+            if (dstUV) {
+                _mm512_storeu_ps(dstUV, _mm512_loadu_ps(uv + i * 2));
+                _mm512_storeu_ps(dstUV + 16, _mm512_loadu_ps(uv + i * 2 + 16));
+                dstUV += 32;
+            }
+            continue;
+        }
+        const uint64_t m3 = _pdep_u64(word, 0x249249249249ull) * 7;
+        dst = cropCompress512(dst, static_cast<__mmask16>(m3), _mm512_loadu_ps(p));
+        dst = cropCompress512(dst, static_cast<__mmask16>(m3 >> 16), _mm512_loadu_ps(p + 16));
+        dst = cropCompress512(dst, static_cast<__mmask16>(m3 >> 32), _mm512_loadu_ps(p + 32));
+        if (dstUV) {
+            const uint32_t m2 = _pdep_u32(word, 0x55555555u) * 3;
+            dstUV = cropCompress512(dstUV, static_cast<__mmask16>(m2), _mm512_loadu_ps(uv + i * 2));
+            dstUV = cropCompress512(dstUV, static_cast<__mmask16>(m2 >> 16), _mm512_loadu_ps(uv + i * 2 + 16));
+        }
+    }
+    n = static_cast<size_t>(dst - outXYZ) / 3;
+    return i;
+}
+#endif
+
+}  // namespace detail
+
+/**
+ * @brief classifies the points [begin, end) of xyz against b, begin a
+ *   multiple of kCropWordPoints. Writes masks[begin / 16] onwards, returns
+ *   the points kept. Uses AVX-512 or AVX2 when the CPU has them.
+ */
+inline size_t
+CropClassify(const float* xyz, size_t begin, size_t end, const CropBounds& b, uint16_t* masks)
+{
+    size_t kept = 0;
+    size_t i = 0;
+#if defined(DS3D_DEPTH_X86)
+    const float* p = xyz + begin * 3;
+    uint16_t* m = masks + begin / kCropWordPoints;
+    switch (detail::depthIsa()) {
+    case detail::DepthIsa::kAVX512:
+        i = detail::cropClassifyAVX512(p, end - begin, b, m, kept);
+        break;
+    case detail::DepthIsa::kAVX2:
+        i = detail::cropClassifyAVX2(p, end - begin, b, m, kept);
+        break;
+    default:
+        break;
+    }
+#endif
+    return kept + detail::cropClassifyScalar(xyz, begin + i, end, b, masks);
+}
+
+/**
+ * @brief copies the points [begin, end) of xyz, and of uv if not null,
+ *   whose masks bit is set to outXYZ and outUV, in order. begin is a
+ *   multiple of kCropWordPoints, returns the points written. Uses AVX-512
+ *   compression when the CPU has it.
+ */
+inline size_t
+CropCompact(
+    const float* xyz, const float* uv, const uint16_t* masks, size_t begin, size_t end, float* outXYZ, float* outUV)
+{
+    size_t n = 0;
+    size_t i = 0;
+#if defined(DS3D_DEPTH_X86)
+    if (detail::depthIsa() == detail::DepthIsa::kAVX512 && __builtin_cpu_supports("bmi2")) {
+        i = detail::cropCompactAVX512(
+            xyz + begin * 3, uv ? uv + begin * 2 : nullptr, masks + begin / kCropWordPoints, end - begin, outXYZ,
+            outUV, n);
+    }
+#endif
+    return n + detail::cropCompactScalar(
+                   xyz, uv, masks, begin + i, end, outXYZ + n * 3, uv ? outUV + n * 2 : nullptr);
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_POINT_CROP__H
@@ -0,0 +1,97 @@
+#ifndef _DS3D_COMMON_POINT_GRID__H
+#define _DS3D_COMMON_POINT_GRID__H
+
+#include "3d/common/common.h"
+#include "3d/common/depth_kernels.h"
+
+/**
+ * @file candidate scan kernels of the uniform grid neighbor queries
+ */
+
+namespace ds3d {
+
+// one neighbor query: the candidates within sqrt(radius2) of p, except candidate self
+struct GridQuery {
+    float p[3] = {0.0f, 0.0f, 0.0f};
+    float radius2 = 0.0f;
+    uint32_t self = 0;
+};
+
+namespace detail {
+
+// about a third of the candidates are hits, collect them without branches
+inline uint32_t
+gridScanScalar(
+    const float* x, const float* y, const float* z, uint32_t j, uint32_t end, const GridQuery& q, uint32_t* hits,
+    float* hitD2, uint32_t n)
+{
+    for (; j < end; ++j) {
+        float ex = x[j] - q.p[0], ey = y[j] - q.p[1], ez = z[j] - q.p[2];
+        float d2 = ex * ex + ey * ey + ez * ez;
+        hits[n] = j;
+        hitD2[n] = d2;
+        n += (d2 <= q.radius2) & (j != q.self);
+    }
+    return n;
+}
+
+#if defined(DS3D_DEPTH_X86)
+// 8 candidates per step, j is advanced past the candidates done
+__attribute__((target("avx2"))) inline uint32_t
+gridScanAVX2(
+    const float* x, const float* y, const float* z, uint32_t& j, uint32_t end, const GridQuery& q, uint32_t* hits,
+    float* hitD2)
+{
+    const __m256 px = _mm256_set1_ps(q.p[0]), py = _mm256_set1_ps(q.p[1]), pz = _mm256_set1_ps(q.p[2]);
+    const __m256 r2 = _mm256_set1_ps(q.radius2);
+    alignas(32) float d2[8];
+    uint32_t n = 0;
+    for (; j + 8 <= end; j += 8) {
+        __m256 ex = _mm256_sub_ps(_mm256_loadu_ps(x + j), px);
+        __m256 ey = _mm256_sub_ps(_mm256_loadu_ps(y + j), py);
+        __m256 ez = _mm256_sub_ps(_mm256_loadu_ps(z + j), pz);
+        __m256 vd2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)), _mm256_mul_ps(ez, ez));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(vd2, r2, _CMP_LE_OQ)));
+        if (q.self - j < 8) {
+            mask &= ~(1u << (q.self - j));
+        }
+        if (!mask) {
+            continue;
+        }
+        _mm256_store_ps(d2, vd2);
+        for (; mask; mask &= mask - 1) {
+            uint32_t b = static_cast<uint32_t>(__builtin_ctz(mask));
+            hits[n] = j + b;
+            hitD2[n] = d2[b];
+            ++n;
+        }
+    }
+    return n;
+}
+#endif
+
+}  // namespace detail
+
+/**
+ * @brief scans the candidates [begin, end) of x, y, z for the hits of q.
+ *   Writes their indices to hits and their squared distances to hitD2, in
+ *   candidate order, returns their number. hits and hitD2 must hold
+ *   end - begin entries. Uses AVX2 when the CPU has it.
+ */
+inline uint32_t
+GridScan(
+    const float* x, const float* y, const float* z, uint32_t begin, uint32_t end, const GridQuery& q, uint32_t* hits,
+    float* hitD2)
+{
+    uint32_t n = 0;
+#if defined(DS3D_DEPTH_X86)
+    if (detail::depthIsa() != detail::DepthIsa::kScalar) {
+        n = detail::gridScanAVX2(x, y, z, begin, end, q, hits, hitD2);
+    }
+#endif
+    return detail::gridScanScalar(x, y, z, begin, end, q, hits, hitD2, n);
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_POINT_GRID__H
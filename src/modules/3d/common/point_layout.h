@@ -0,0 +1,103 @@
+#ifndef _DS3D_COMMON_POINT_LAYOUT__H
+#define _DS3D_COMMON_POINT_LAYOUT__H
+
+#include "3d/common/common.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <immintrin.h>
+#define DS3D_POINT_LAYOUT_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DS3D_POINT_LAYOUT_NEON 1
+#endif
+
+/**
+ * @file transpose kernels between interleaved (AoS, N x 3) and planar (SoA, 3 x N) point clouds
+ */
+
+namespace ds3d {
+
+// xyz: x0 y0 z0 x1 y1 z1 ... -> x: x0 x1 ..., y: y0 y1 ..., z: z0 z1 ...
+inline void
+PointXYZToPlanar(const float* xyz, float* x, float* y, float* z, size_t num)
+{
+    size_t i = 0;
+    const size_t vecNum = num & ~static_cast<size_t>(3);  // 4 points per step
+#if defined(DS3D_POINT_LAYOUT_SSE)
+    // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+    for (; i < vecNum; i += 4) {
+        const float* p = xyz + i * 3;
+        __m128 a = _mm_loadu_ps(p);
+        __m128 b = _mm_loadu_ps(p + 4);
+        __m128 c = _mm_loadu_ps(p + 8);
+        __m128 bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));        // b2 b2 c1 c1
+        __m128 vx = _mm_shuffle_ps(a, bc, _MM_SHUFFLE(2, 0, 3, 0));       // a0 a3 b2 c1
+        __m128 ab = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));        // a1 a1 b0 b0
+        bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));               // b3 b3 c2 c2
+        __m128 vy = _mm_shuffle_ps(ab, bc, _MM_SHUFFLE(2, 0, 2, 0));      // a1 b0 b3 c2
+        ab = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));               // a2 a2 b1 b1
+        __m128 cc = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));        // c0 c0 c3 c3
+        __m128 vz = _mm_shuffle_ps(ab, cc, _MM_SHUFFLE(2, 0, 2, 0));      // a2 b1 c0 c3
+        _mm_storeu_ps(x + i, vx);
+        _mm_storeu_ps(y + i, vy);
+        _mm_storeu_ps(z + i, vz);
+    }
+#elif defined(DS3D_POINT_LAYOUT_NEON)
+    for (; i < vecNum; i += 4) {
+        float32x4x3_t v = vld3q_f32(xyz + i * 3);
+        vst1q_f32(x + i, v.val[0]);
+        vst1q_f32(y + i, v.val[1]);
+        vst1q_f32(z + i, v.val[2]);
+    }
+#endif
+    for (const float* p = xyz + i * 3; i < num; ++i, p += 3) {
+        x[i] = p[0];
+        y[i] = p[1];
+        z[i] = p[2];
+    }
+}
+
+// x, y, z planes -> xyz: x0 y0 z0 x1 y1 z1 ...
+inline void
+PlanarToPointXYZ(const float* x, const float* y, const float* z, float* xyz, size_t num)
+{
+    size_t i = 0;
+    const size_t vecNum = num & ~static_cast<size_t>(3);  // 4 points per step
+#if defined(DS3D_POINT_LAYOUT_SSE)
+    for (; i < vecNum; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 vz = _mm_loadu_ps(z + i);
+        __m128 xy = _mm_shuffle_ps(vx, vy, _MM_SHUFFLE(0, 0, 0, 0));      // x0 x0 y0 y0
+        __m128 zx = _mm_shuffle_ps(vz, vx, _MM_SHUFFLE(1, 1, 0, 0));      // z0 z0 x1 x1
+        __m128 a = _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));       // x0 y0 z0 x1
+        __m128 yz = _mm_shuffle_ps(vy, vz, _MM_SHUFFLE(1, 1, 1, 1));      // y1 y1 z1 z1
+        xy = _mm_shuffle_ps(vx, vy, _MM_SHUFFLE(2, 2, 2, 2));             // x2 x2 y2 y2
+        __m128 b = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(2, 0, 2, 0));       // y1 z1 x2 y2
+        zx = _mm_shuffle_ps(vz, vx, _MM_SHUFFLE(3, 3, 2, 2));             // z2 z2 x3 x3
+        yz = _mm_shuffle_ps(vy, vz, _MM_SHUFFLE(3, 3, 3, 3));             // y3 y3 z3 z3
+        __m128 c = _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(2, 0, 2, 0));       // z2 x3 y3 z3
+        float* p = xyz + i * 3;
+        _mm_storeu_ps(p, a);
+        _mm_storeu_ps(p + 4, b);
+        _mm_storeu_ps(p + 8, c);
+    }
+#elif defined(DS3D_POINT_LAYOUT_NEON)
+    for (; i < vecNum; i += 4) {
+        float32x4x3_t v;
+        v.val[0] = vld1q_f32(x + i);
+        v.val[1] = vld1q_f32(y + i);
+        v.val[2] = vld1q_f32(z + i);
+        vst3q_f32(xyz + i * 3, v);
+    }
+#endif
+    for (float* p = xyz + i * 3; i < num; ++i, p += 3) {
+        p[0] = x[i];
+        p[1] = y[i];
+        p[2] = z[i];
+    }
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_POINT_LAYOUT__H
@@ -0,0 +1,185 @@
+#ifndef _DS3D_COMMON_POINT_NORMALS__H
+#define _DS3D_COMMON_POINT_NORMALS__H
+
+#include "3d/common/common.h"
+#include "3d/common/depth_kernels.h"
+
+#include <cmath>
+
+/**
+ * @file central difference normal kernels of organized (depth image ordered) point clouds
+ */
+
+namespace ds3d {
+
+// organized normal estimation settings, see OrganizedNormalsRow
+struct OrganizedNormalParams {
+    // pixel distance of the central differences, larger smooths more noise and loses more edge pixels
+    uint32_t step = 2;
+    // largest depth change per pixel between the two points of a difference, relative to the
+    // center depth. Larger changes are depth edges and give no normal.
+    float maxDepthChange = 0.05f;
+};
+
+namespace detail {
+
+inline void
+normalsRowScalar(
+    const float* x, const float* y, const float* z, size_t i, size_t end, size_t step, size_t stride, float maxChange,
+    float* nx, float* ny, float* nz)
+{
+    const size_t v = step * stride;
+    for (; i < end; ++i) {
+        const float zc = z[i], zl = z[i - step], zr = z[i + step], zu = z[i - v], zd = z[i + v];
+        const float limit = maxChange * zc;
+        const float ax = x[i + step] - x[i - step], ay = y[i + step] - y[i - step], az = zr - zl;
+        const float bx = x[i + v] - x[i - v], by = y[i + v] - y[i - v], bz = zd - zu;
+        // vertical x horizontal faces the camera on a surface facing it, flip it otherwise
+        const float cx = by * az - bz * ay, cy = bz * ax - bx * az, cz = bx * ay - by * ax;
+        const float dot = cx * x[i] + cy * y[i] + cz * zc;
+        const float len2 = cx * cx + cy * cy + cz * cz;
+        const bool valid = zc > 0.0f && zl > 0.0f && zr > 0.0f && zu > 0.0f && zd > 0.0f &&
+                           std::fabs(az) <= limit && std::fabs(bz) <= limit && len2 > 0.0f &&
+                           len2 <= std::numeric_limits<float>::max();
+        const float inv = (dot > 0.0f ? -1.0f : 1.0f) / std::sqrt(len2);
+        nx[i] = valid ? cx * inv : 0.0f;
+        ny[i] = valid ? cy * inv : 0.0f;
+        nz[i] = valid ? cz * inv : 0.0f;
+    }
+}
+
+#if defined(DS3D_DEPTH_X86)
+__attribute__((target("avx2"))) inline size_t
+normalsRowAVX2(
+    const float* x, const float* y, const float* z, size_t i, size_t end, size_t step, size_t stride, float maxChange,
+    float* nx, float* ny, float* nz)
+{
+    const size_t v = step * stride;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 vChange = _mm256_set1_ps(maxChange);
+    const __m256 maxLen2 = _mm256_set1_ps(std::numeric_limits<float>::max());
+    for (; i + 8 <= end; i += 8) {
+        const __m256 zc = _mm256_loadu_ps(z + i);
+        const __m256 zl = _mm256_loadu_ps(z + i - step), zr = _mm256_loadu_ps(z + i + step);
+        const __m256 zu = _mm256_loadu_ps(z + i - v), zd = _mm256_loadu_ps(z + i + v);
+        const __m256 limit = _mm256_mul_ps(vChange, zc);
+        const __m256 ax = _mm256_sub_ps(_mm256_loadu_ps(x + i + step), _mm256_loadu_ps(x + i - step));
+        const __m256 ay = _mm256_sub_ps(_mm256_loadu_ps(y + i + step), _mm256_loadu_ps(y + i - step));
+        const __m256 az = _mm256_sub_ps(zr, zl);
+        const __m256 bx = _mm256_sub_ps(_mm256_loadu_ps(x + i + v), _mm256_loadu_ps(x + i - v));
+        const __m256 by = _mm256_sub_ps(_mm256_loadu_ps(y + i + v), _mm256_loadu_ps(y + i - v));
+        const __m256 bz = _mm256_sub_ps(zd, zu);
+        const __m256 cx = _mm256_sub_ps(_mm256_mul_ps(by, az), _mm256_mul_ps(bz, ay));
+        const __m256 cy = _mm256_sub_ps(_mm256_mul_ps(bz, ax), _mm256_mul_ps(bx, az));
+        const __m256 cz = _mm256_sub_ps(_mm256_mul_ps(bx, ay), _mm256_mul_ps(by, ax));
+        const __m256 dot = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(cx, _mm256_loadu_ps(x + i)), _mm256_mul_ps(cy, _mm256_loadu_ps(y + i))),
+            _mm256_mul_ps(cz, zc));
+        const __m256 len2 =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz));
+        __m256 valid = _mm256_and_ps(_mm256_cmp_ps(zc, zero, _CMP_GT_OQ), _mm256_cmp_ps(zl, zero, _CMP_GT_OQ));
+        valid = _mm256_and_ps(
+            valid, _mm256_and_ps(_mm256_cmp_ps(zr, zero, _CMP_GT_OQ), _mm256_cmp_ps(zu, zero, _CMP_GT_OQ)));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(zd, zero, _CMP_GT_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(_mm256_andnot_ps(signBit, az), limit, _CMP_LE_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(_mm256_andnot_ps(signBit, bz), limit, _CMP_LE_OQ));
+        valid = _mm256_and_ps(
+            valid, _mm256_and_ps(_mm256_cmp_ps(len2, zero, _CMP_GT_OQ), _mm256_cmp_ps(len2, maxLen2, _CMP_LE_OQ)));
+        const __m256 sign = _mm256_or_ps(one, _mm256_and_ps(_mm256_cmp_ps(dot, zero, _CMP_GT_OQ), signBit));
+        const __m256 inv = _mm256_and_ps(_mm256_div_ps(sign, _mm256_sqrt_ps(len2)), valid);
+        _mm256_storeu_ps(nx + i, _mm256_and_ps(_mm256_mul_ps(cx, inv), valid));
+        _mm256_storeu_ps(ny + i, _mm256_and_ps(_mm256_mul_ps(cy, inv), valid));
+        _mm256_storeu_ps(nz + i, _mm256_and_ps(_mm256_mul_ps(cz, inv), valid));
+    }
+    return i;
+}
+
+__attribute__((target("avx512f"))) inline size_t
+normalsRowAVX512(
+    const float* x, const float* y, const float* z, size_t i, size_t end, size_t step, size_t stride, float maxChange,
+    float* nx, float* ny, float* nz)
+{
+    const size_t v = step * stride;
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 vChange = _mm512_set1_ps(maxChange);
+    const __m512 maxLen2 = _mm512_set1_ps(std::numeric_limits<float>::max());
+    for (; i + 16 <= end; i += 16) {
+        const __m512 zc = _mm512_loadu_ps(z + i);
+        const __m512 zl = _mm512_loadu_ps(z + i - step), zr = _mm512_loadu_ps(z + i + step);
+        const __m512 zu = _mm512_loadu_ps(z + i - v), zd = _mm512_loadu_ps(z + i + v);
+        const __m512 limit = _mm512_mul_ps(vChange, zc);
+        const __m512 ax = _mm512_sub_ps(_mm512_loadu_ps(x + i + step), _mm512_loadu_ps(x + i - step));
+        const __m512 ay = _mm512_sub_ps(_mm512_loadu_ps(y + i + step), _mm512_loadu_ps(y + i - step));
+        const __m512 az = _mm512_sub_ps(zr, zl);
+        const __m512 bx = _mm512_sub_ps(_mm512_loadu_ps(x + i + v), _mm512_loadu_ps(x + i - v));
+        const __m512 by = _mm512_sub_ps(_mm512_loadu_ps(y + i + v), _mm512_loadu_ps(y + i - v));
+        const __m512 bz = _mm512_sub_ps(zd, zu);
+        const __m512 cx = _mm512_sub_ps(_mm512_mul_ps(by, az), _mm512_mul_ps(bz, ay));
+        const __m512 cy = _mm512_sub_ps(_mm512_mul_ps(bz, ax), _mm512_mul_ps(bx, az));
+        const __m512 cz = _mm512_sub_ps(_mm512_mul_ps(bx, ay), _mm512_mul_ps(by, ax));
+        const __m512 dot = _mm512_add_ps(
+            _mm512_add_ps(_mm512_mul_ps(cx, _mm512_loadu_ps(x + i)), _mm512_mul_ps(cy, _mm512_loadu_ps(y + i))),
+            _mm512_mul_ps(cz, zc));
+        const __m512 len2 =
+            _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(cx, cx), _mm512_mul_ps(cy, cy)), _mm512_mul_ps(cz, cz));
+        __mmask16 valid = _mm512_cmp_ps_mask(zc, zero, _CMP_GT_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, zl, zero, _CMP_GT_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, zr, zero, _CMP_GT_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, zu, zero, _CMP_GT_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, zd, zero, _CMP_GT_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, _mm512_abs_ps(az), limit, _CMP_LE_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, _mm512_abs_ps(bz), limit, _CMP_LE_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, len2, zero, _CMP_GT_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, len2, maxLen2, _CMP_LE_OQ);
+        const __m512 sign = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(dot, zero, _CMP_GT_OQ), one, _mm512_set1_ps(-1.0f));
+        const __m512 inv = _mm512_maskz_div_ps(valid, sign, _mm512_sqrt_ps(len2));
+        _mm512_storeu_ps(nx + i, _mm512_maskz_mul_ps(valid, cx, inv));
+        _mm512_storeu_ps(ny + i, _mm512_maskz_mul_ps(valid, cy, inv));
+        _mm512_storeu_ps(nz + i, _mm512_maskz_mul_ps(valid, cz, inv));
+    }
+    return i;
+}
+#endif
+
+}  // namespace detail
+
+/**
+ * @brief normals of columns [begin, end) of one row of a planar organized
+ *   cloud. x, y, z point to the row, stride is the image width, the rows
+ *   step above and below and the columns step left and right must exist.
+ *   A normal is the cross product of the vertical and horizontal central
+ *   differences, unit length and facing the camera (the origin). It is
+ *   (0, 0, 0) when a point of the differences is invalid (z <= 0, NaN) or
+ *   they cross a depth edge. Writes nx, ny, nz at the same columns.
+ *   Uses AVX-512 or AVX2 when the CPU has them.
+ */
+inline void
+OrganizedNormalsRow(
+    const float* x, const float* y, const float* z, size_t begin, size_t end, size_t stride,
+    const OrganizedNormalParams& params, float* nx, float* ny, float* nz)
+{
+    const size_t step = params.step;
+    // differences span 2 * step pixels
+    const float maxChange = params.maxDepthChange * static_cast<float>(2 * step);
+    size_t i = begin;
+#if defined(DS3D_DEPTH_X86)
+    switch (detail::depthIsa()) {
+    case detail::DepthIsa::kAVX512:
+        i = detail::normalsRowAVX512(x, y, z, i, end, step, stride, maxChange, nx, ny, nz);
+        break;
+    case detail::DepthIsa::kAVX2:
+        i = detail::normalsRowAVX2(x, y, z, i, end, step, stride, maxChange, nx, ny, nz);
+        break;
+    default:
+        break;
+    }
+#endif
+    detail::normalsRowScalar(x, y, z, i, end, step, stride, maxChange, nx, ny, nz);
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_POINT_NORMALS__H
@@ -0,0 +1,170 @@
+#ifndef _DS3D_COMMON_POINT_WINDOW__H
+#define _DS3D_COMMON_POINT_WINDOW__H
+
+#include "3d/common/common.h"
+#include "3d/common/depth_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * @file pixel window neighbor kernels of organized point clouds
+ */
+
+namespace ds3d {
+
+/**
+ * @brief neighbors of the pixels of one row of padded planar x, y, z rows.
+ *   Window pixel o of planar index i is i + offsets[o], the padding and
+ *   invalid points are at infinity, so they are never within radius.
+ */
+struct WindowQuery {
+    const float* x = nullptr;
+    const float* y = nullptr;
+    const float* z = nullptr;
+    const ptrdiff_t* offsets = nullptr;
+    uint32_t numOffsets = 0;
+    float radius2 = 0.0f;
+};
+
+namespace detail {
+
+// the k smallest distances are kept sorted with a min/max network, without branches
+inline void
+windowMeanDistanceScalar(const WindowQuery& q, size_t i, size_t end, uint32_t k, float radius, float* score)
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    float best[64];
+    for (; i < end; ++i, ++score) {
+        std::fill(best, best + k, inf);
+        for (uint32_t o = 0; o < q.numOffsets; ++o) {
+            const size_t j = i + q.offsets[o];
+            float ex = q.x[j] - q.x[i], ey = q.y[j] - q.y[i], ez = q.z[j] - q.z[i];
+            float d2 = ex * ex + ey * ey + ez * ez;
+            d2 = d2 <= q.radius2 ? d2 : inf;
+            for (uint32_t s = k - 1; s > 0; --s) {
+                best[s] = std::min(best[s], std::max(best[s - 1], d2));
+            }
+            best[0] = std::min(best[0], d2);
+        }
+        float sum = 0.0f;
+        for (uint32_t s = 0; s < k; ++s) {
+            sum += best[s] != inf ? std::sqrt(best[s]) : radius;
+        }
+        *score = sum / static_cast<float>(k);
+    }
+}
+
+inline void
+windowNeighborsScalar(const WindowQuery& q, size_t i, size_t end, uint32_t* count)
+{
+    for (; i < end; ++i, ++count) {
+        uint32_t n = 0;
+        for (uint32_t o = 0; o < q.numOffsets; ++o) {
+            const size_t j = i + q.offsets[o];
+            float ex = q.x[j] - q.x[i], ey = q.y[j] - q.y[i], ez = q.z[j] - q.z[i];
+            n += (ex * ex + ey * ey + ez * ez) <= q.radius2;
+        }
+        *count = n;
+    }
+}
+
+#if defined(DS3D_DEPTH_X86)
+__attribute__((target("avx2"))) inline __m256
+windowD2AVX2(const WindowQuery& q, size_t i, ptrdiff_t offset, __m256 px, __m256 py, __m256 pz)
+{
+    __m256 ex = _mm256_sub_ps(_mm256_loadu_ps(q.x + i + offset), px);
+    __m256 ey = _mm256_sub_ps(_mm256_loadu_ps(q.y + i + offset), py);
+    __m256 ez = _mm256_sub_ps(_mm256_loadu_ps(q.z + i + offset), pz);
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)), _mm256_mul_ps(ez, ez));
+}
+
+// 8 pixels per step, returns the first pixel not done
+__attribute__((target("avx2"))) inline size_t
+windowMeanDistanceAVX2(const WindowQuery& q, size_t i, size_t end, uint32_t k, float radius, float* score)
+{
+    const __m256 inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    const __m256 r2 = _mm256_set1_ps(q.radius2), r = _mm256_set1_ps(radius);
+    const __m256 invK = _mm256_set1_ps(1.0f / static_cast<float>(k));
+    __m256 best[64];
+    for (; i + 8 <= end; i += 8, score += 8) {
+        const __m256 px = _mm256_loadu_ps(q.x + i), py = _mm256_loadu_ps(q.y + i), pz = _mm256_loadu_ps(q.z + i);
+        for (uint32_t s = 0; s < k; ++s) {
+            best[s] = inf;
+        }
+        for (uint32_t o = 0; o < q.numOffsets; ++o) {
+            __m256 d2 = windowD2AVX2(q, i, q.offsets[o], px, py, pz);
+            // NaN of invalid pixels also fails the compare
+            d2 = _mm256_blendv_ps(inf, d2, _mm256_cmp_ps(d2, r2, _CMP_LE_OQ));
+            for (uint32_t s = k - 1; s > 0; --s) {
+                best[s] = _mm256_min_ps(best[s], _mm256_max_ps(best[s - 1], d2));
+            }
+            best[0] = _mm256_min_ps(best[0], d2);
+        }
+        __m256 sum = _mm256_setzero_ps();
+        for (uint32_t s = 0; s < k; ++s) {
+            __m256 found = _mm256_cmp_ps(best[s], inf, _CMP_NEQ_OQ);
+            sum = _mm256_add_ps(sum, _mm256_blendv_ps(r, _mm256_sqrt_ps(best[s]), found));
+        }
+        _mm256_storeu_ps(score, _mm256_mul_ps(sum, invK));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) inline size_t
+windowNeighborsAVX2(const WindowQuery& q, size_t i, size_t end, uint32_t* count)
+{
+    const __m256 r2 = _mm256_set1_ps(q.radius2);
+    for (; i + 8 <= end; i += 8, count += 8) {
+        const __m256 px = _mm256_loadu_ps(q.x + i), py = _mm256_loadu_ps(q.y + i), pz = _mm256_loadu_ps(q.z + i);
+        __m256i n = _mm256_setzero_si256();
+        for (uint32_t o = 0; o < q.numOffsets; ++o) {
+            __m256 d2 = windowD2AVX2(q, i, q.offsets[o], px, py, pz);
+            // the all ones mask is -1
+            n = _mm256_sub_epi32(n, _mm256_castps_si256(_mm256_cmp_ps(d2, r2, _CMP_LE_OQ)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(count), n);
+    }
+    return i;
+}
+#endif
+
+}  // namespace detail
+
+/**
+ * @brief mean distance of the pixels [begin, end) of q to their k nearest
+ *   window points within radius, the missing ones counted at radius, into
+ *   score[0, end - begin). k must not exceed 64. Uses AVX2 when the CPU has it.
+ */
+inline void
+WindowMeanDistance(const WindowQuery& q, size_t begin, size_t end, uint32_t k, float radius, float* score)
+{
+    size_t i = begin;
+#if defined(DS3D_DEPTH_X86)
+    if (detail::depthIsa() != detail::DepthIsa::kScalar) {
+        i = detail::windowMeanDistanceAVX2(q, begin, end, k, radius, score);
+    }
+#endif
+    detail::windowMeanDistanceScalar(q, i, end, k, radius, score + (i - begin));
+}
+
+/**
+ * @brief number of window points within radius of the pixels [begin, end)
+ *   of q into count[0, end - begin). Uses AVX2 when the CPU has it.
+ */
+inline void
+WindowNeighbors(const WindowQuery& q, size_t begin, size_t end, uint32_t* count)
+{
+    size_t i = begin;
+#if defined(DS3D_DEPTH_X86)
+    if (detail::depthIsa() != detail::DepthIsa::kScalar) {
+        i = detail::windowNeighborsAVX2(q, begin, end, count);
+    }
+#endif
+    detail::windowNeighborsScalar(q, i, end, count + (i - begin));
+}
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_POINT_WINDOW__H
@@ -4,6 +4,7 @@
 #include "3d/common/common.h"
 #include "3d/common/typeid.h"
 #include "3d/common/idatatype.h"
+#include "3d/common/half.h"
 
 #if ENABLE_HALF
 #include <half.hpp>
@@ -53,6 +54,10 @@ template <>
 struct TpId<int16_t> : __TypeID<DS3D_TYPEID_INT16_T>, __DataTypeVal<DataType::kInt16> {
 };
 
+template <>
+struct TpId<Half> : __TypeID<DS3D_TYPEID_HALF_FLOAT>, __DataTypeVal<DataType::kFp16> {
+};
+
 template <>
 struct TpId<double> : __TypeID<DS3D_TYPEID_DOUBLE>, __DataTypeVal<DataType::kDouble> {
 };
@@ -83,7 +88,7 @@ struct NativeData<DataType::kFp16> {
 #if ENABLE_HALF
     using type = half_float::half;
 #else
-    using type = int16_t;
+    using type = Half;
 #endif
 };
 
@@ -20,6 +20,7 @@
 #define DS3D_TYPEID_DEPTH_SCALE 0x20004
 #define DS3D_TYPEID_INTRINSIC_PARM 0x20005
 #define DS3D_TYPEID_EXTRINSIC_PARM 0x20006
+#define DS3D_TYPEID_POINT_QUANT_PARM 0x20007
 
 
 #endif  // _DS3D_COMMON_TYPE_ID__H
\ No newline at end of file
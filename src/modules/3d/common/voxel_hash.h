@@ -0,0 +1,218 @@
+#ifndef _DS3D_COMMON_VOXEL_HASH__H
+#define _DS3D_COMMON_VOXEL_HASH__H
+
+#include "3d/common/common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * @file open addressing hash of voxel accumulators for voxel grid downsampling
+ */
+
+namespace ds3d {
+
+// voxel coordinates are packed 21 bits per axis with a 2^20 offset, about +-1 km at 1 mm voxels
+constexpr int32_t kVoxelAxisOffset = 1 << 20;
+constexpr uint64_t kVoxelAxisMask = (1ull << 21) - 1;
+constexpr uint64_t kVoxelEmptyKey = ~0ull;
+
+// voxel of point p, false for non-finite points, (0, 0, 0) (invalid depth) and points out of range
+inline bool
+VoxelKey(const float* p, float invVoxel, uint64_t& key)
+{
+    if (p[0] == 0.0f && p[1] == 0.0f && p[2] == 0.0f) {
+        return false;
+    }
+    key = 0;
+    for (int c = 0; c < 3; ++c) {
+        float v = p[c] * invVoxel;
+        // also rejects NaN and inf
+        if (!(v >= -kVoxelAxisOffset && v < kVoxelAxisOffset)) {
+            return false;
+        }
+        int32_t i = static_cast<int32_t>(v);  // floor without a libm call on baseline x86-64
+        i -= (v < static_cast<float>(i)) ? 1 : 0;
+        key |= static_cast<uint64_t>(i + kVoxelAxisOffset) << (c * 21);
+    }
+    return true;
+}
+
+// coarsening steps until every axis is in {-1, 0}, the voxels around the origin never merge
+constexpr uint32_t kVoxelMaxCoarsen = 21;
+
+// key of the voxel twice as large containing this one
+inline uint64_t
+CoarseVoxelKey(uint64_t key)
+{
+    uint64_t coarse = 0;
+    for (int c = 0; c < 3; ++c) {
+        uint64_t v = (key >> (c * 21)) & kVoxelAxisMask;  // ix + offset
+        coarse |= ((v >> 1) + (kVoxelAxisOffset >> 1)) << (c * 21);  // floor(ix / 2) + offset
+    }
+    return coarse;
+}
+
+// independent of the slot hash, so a partition still spreads over its whole table
+inline uint32_t
+VoxelPartition(uint64_t key, uint32_t numPartitions)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return static_cast<uint32_t>(key % numPartitions);
+}
+
+// 32 bytes, two cells per cache line
+struct VoxelCell {
+    uint64_t key = kVoxelEmptyKey;
+    float sum[3] = {0.0f, 0.0f, 0.0f};
+    uint32_t count = 0;
+    float sumUV[2] = {0.0f, 0.0f};
+};
+static_assert(sizeof(VoxelCell) == 32, "VoxelCell must be 32 bytes");
+
+/**
+ * @brief VoxelHash accumulates point sums per voxel key with linear probing
+ *   in a power of 2 table kept at most half full. clear() keeps the table
+ *   storage, so a hash reused frame after frame does not allocate.
+ */
+class VoxelHash {
+public:
+    explicit VoxelHash(size_t expected = 0) { reserve(expected); }
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _cells.size(); }
+
+    void reserve(size_t expected)
+    {
+        size_t cap = 64;
+        while (cap < expected * 2) {
+            cap <<= 1;
+        }
+        if (cap > _cells.size()) {
+            rehash(cap);
+        }
+    }
+
+    void clear()
+    {
+        if (_size) {
+            std::fill(_cells.begin(), _cells.end(), VoxelCell());
+            _size = 0;
+        }
+    }
+
+    VoxelCell& cell(uint64_t key)
+    {
+        if ((_size + 1) * 2 > _cells.size()) {
+            rehash(std::max<size_t>(_cells.size() * 2, 64));
+        }
+        size_t mask = _cells.size() - 1;
+        for (size_t i = slot(key);; i = (i + 1) & mask) {
+            VoxelCell& c = _cells[i];
+            if (c.key == key) {
+                return c;
+            }
+            if (c.key == kVoxelEmptyKey) {
+                c.key = key;
+                ++_size;
+                return c;
+            }
+        }
+    }
+
+    void add(uint64_t key, const float* p, const float* uv)
+    {
+        VoxelCell& c = cell(key);
+        c.sum[0] += p[0];
+        c.sum[1] += p[1];
+        c.sum[2] += p[2];
+        if (uv) {
+            c.sumUV[0] += uv[0];
+            c.sumUV[1] += uv[1];
+        }
+        ++c.count;
+    }
+
+    void merge(const VoxelCell& o) { merge(o.key, o); }
+
+    void merge(uint64_t key, const VoxelCell& o)
+    {
+        VoxelCell& c = cell(key);
+        for (int i = 0; i < 3; ++i) {
+            c.sum[i] += o.sum[i];
+        }
+        c.sumUV[0] += o.sumUV[0];
+        c.sumUV[1] += o.sumUV[1];
+        c.count += o.count;
+    }
+
+    // f(const VoxelCell&) for every occupied voxel, in table order
+    template <typename F>
+    void forEach(F&& f) const
+    {
+        for (const VoxelCell& c : _cells) {
+            if (c.key != kVoxelEmptyKey) {
+                f(c);
+            }
+        }
+    }
+
+    // regroup into voxels of twice the size, sums are exact so no point is revisited
+    void coarsen()
+    {
+        std::vector<VoxelCell> cells;
+        cells.swap(_cells);
+        rehash(cells.size());
+        for (const VoxelCell& c : cells) {
+            if (c.key != kVoxelEmptyKey) {
+                merge(CoarseVoxelKey(c.key), c);
+            }
+        }
+    }
+
+    // keep the maxSize voxels holding the most points
+    void truncate(size_t maxSize)
+    {
+        if (_size <= maxSize) {
+            return;
+        }
+        std::vector<VoxelCell> cells;
+        cells.reserve(_size);
+        forEach([&cells](const VoxelCell& c) { cells.push_back(c); });
+        std::nth_element(cells.begin(), cells.begin() + maxSize, cells.end(), [](const VoxelCell& a, const VoxelCell& b) {
+            return a.count > b.count;
+        });
+        clear();
+        for (size_t i = 0; i < maxSize; ++i) {
+            merge(cells[i]);
+        }
+    }
+
+private:
+    size_t slot(uint64_t key) const { return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> _shift); }
+
+    void rehash(size_t cap)
+    {
+        std::vector<VoxelCell> old;
+        old.swap(_cells);
+        _cells.resize(cap);
+        _shift = 64 - static_cast<uint32_t>(__builtin_ctzll(cap));
+        _size = 0;
+        for (const VoxelCell& c : old) {
+            if (c.key != kVoxelEmptyKey) {
+                merge(c);
+            }
+        }
+    }
+
+    std::vector<VoxelCell> _cells;
+    size_t _size = 0;
+    uint32_t _shift = 64;
+};
+
+}  // namespace ds3d
+
+#endif  // _DS3D_COMMON_VOXEL_HASH__H
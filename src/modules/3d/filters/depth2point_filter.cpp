@@ -0,0 +1,193 @@
+#include "3d/hpp/depth_frame.hpp"
+#include "3d/hpp/frame_pool.hpp"
+#include "3d/hpp/impl_datafilter.hpp"
+#include "3d/hpp/point_frame.hpp"
+
+#include <algorithm>
+
+/**
+ * @file CPU counterpart of libnvds_3d_depth2point_datafilter.so: kDepthFrame -> kPointXYZ and kPointCoordUV
+ *
+ * config_body:
+ *   in_streams: [color, depth] # without color, kPointCoordUV is not generated
+ *   max_points: 407040         # 848*480, depth frames must not have more pixels
+ *   mem_pool_size: 8
+ *   mem_type: cpu              # cpu or pinned output frames
+ *   threads: 0                 # 0 uses the shared ThreadPool, 1 the filter thread only
+ *   depth_scale: 0.001         # to meters, only used when the datamap has no kDepthScaleUnit
+ *   point_layout: xyz          # xyz: kPointXYZ, planar: kPointXYZPlanar, fp16 or int16: kPointXYZCompact
+ *
+ * The cloud is organized: point y * width + x is depth pixel (x, y), invalid depth gives (0, 0, 0).
+ * The planar and compact layouts are read by the CPU filters of this lib and the appsink probe
+ * (GetPointXYZ), other consumers such as point-render need point_layout: xyz.
+ */
+
+namespace ds3d { namespace impl {
+
+class CpuDepth2PointFilter : public BaseImplDataFilter {
+public:
+    CpuDepth2PointFilter() = default;
+    ~CpuDepth2PointFilter() override = default;
+
+protected:
+    ErrCode startImpl(const YAML::Node& body) override
+    {
+        if (body) {
+            if (body["in_streams"]) {
+                auto streams = body["in_streams"].as<std::vector<std::string>>();
+                _colorCoord = std::find(streams.begin(), streams.end(), "color") != streams.end();
+            }
+            _maxPoints = body["max_points"].as<uint32_t>(_maxPoints);
+            _defaultScale = body["depth_scale"].as<float>(_defaultScale);
+            std::string layout = body["point_layout"].as<std::string>("xyz");
+            DS3D_FAILED_RETURN(
+                pointLayoutFromString(layout, _layout), ErrCode::kConfig, "unsupported point_layout: %s",
+                layout.c_str());
+        }
+        return ErrCode::kGood;
+    }
+
+    ErrCode processImpl(const GuardDataMap& input, GuardDataMap& output) override
+    {
+        auto [depth, depthScale, depthIntrinsics, colorIntrinsics, d2cExtrinsics, aligned] = input.fetch(
+            kDepthFrame, kDepthScaleUnit, kDepthIntrinsics, kColorIntrinsics, kDepth2ColorExtrinsics,
+            kColorDepthAligned);
+        if (!depth) {
+            return ErrCode::kGood;  // no depth in this datamap
+        }
+        DS3D_FAILED_RETURN(depthIntrinsics, ErrCode::kParam, "depth2point needs kDepthIntrinsics");
+        float scale = depthScale ? static_cast<float>(depthScale->scaleUnit) : _defaultScale;
+        DS3D_FAILED_RETURN(scale > 0.0f, ErrCode::kConfig, "no kDepthScaleUnit in datamap and no depth_scale");
+        if (!_lut.matches(*depthIntrinsics)) {
+            DS3D_FAILED_RETURN(
+                BuildDepthRayLut(*depthIntrinsics, _lut), ErrCode::kParam, "invalid kDepthIntrinsics");
+        }
+        uint32_t num = depthIntrinsics->width * depthIntrinsics->height;
+        DS3D_FAILED_RETURN(
+            num <= _maxPoints, ErrCode::kOutOfRange, "depth of %u pixels exceeds max_points: %u", num, _maxPoints);
+
+        ColorProjection proj;
+        bool hasProj = false;
+        if (_colorCoord) {
+            if (aligned && *aligned) {
+                // color is registered to depth, project with the depth camera itself
+                ExtrinsicsParam identity{};
+                for (int i = 0; i < 3; ++i) {
+                    identity.rotation[i].data[i] = 1.0f;
+                }
+                hasProj = MakeColorProjection(*depthIntrinsics, identity, proj);
+            } else if (colorIntrinsics && d2cExtrinsics) {
+                hasProj = MakeColorProjection(*colorIntrinsics, *d2cExtrinsics, proj);
+            }
+            DS3D_FAILED_RETURN(
+                hasProj, ErrCode::kParam, "kPointCoordUV needs kColorIntrinsics and kDepth2ColorExtrinsics");
+        }
+
+        const int32_t n = static_cast<int32_t>(num);
+        FrameGuard points = acquireFrame(_pointPool, Shape{2, {n, 3}}, DataType::kFp32, FrameType::kPointXYZ);
+        DS3D_FAILED_RETURN(points, ErrCode::kMem, "point pool exhausted");
+        FrameGuard colorCoord;
+        if (hasProj) {
+            colorCoord = acquireFrame(_uvPool, Shape{2, {n, 2}}, DataType::kFp32, FrameType::kPointCoordUV);
+            DS3D_FAILED_RETURN(colorCoord, ErrCode::kMem, "color coord pool exhausted");
+        }
+        DS3D_ERROR_RETURN(
+            DepthFrameToPoints(
+                depth, scale, _lut, hasProj ? &proj : nullptr, points, hasProj ? &colorCoord : nullptr,
+                threadPool()),
+            "unproject depth failed");
+
+        output = newOutput(input);
+        DS3D_ERROR_RETURN(setPoints(output, points), "set points failed");
+        if (hasProj) {
+            DS3D_ERROR_RETURN(output.setGuardData(kPointCoordUV, colorCoord), "set kPointCoordUV failed");
+        }
+        return ErrCode::kGood;
+    }
+
+    ErrCode stopImpl() override
+    {
+        _pointPool.reset();
+        _uvPool.reset();
+        _planarPool.reset();
+        _compactPool.reset();
+        return ErrCode::kGood;
+    }
+
+private:
+    enum class PointLayout {
+        kXYZ,
+        kPlanar,
+        kFp16,
+        kInt16,
+    };
+
+    static bool pointLayoutFromString(const std::string& str, PointLayout& layout)
+    {
+        if (str == "xyz") {
+            layout = PointLayout::kXYZ;
+        } else if (str == "planar") {
+            layout = PointLayout::kPlanar;
+        } else if (str == "fp16") {
+            layout = PointLayout::kFp16;
+        } else if (str == "int16") {
+            layout = PointLayout::kInt16;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // publish the N x 3 fp32 points in the configured layout, the conversions
+    // write into pooled frames and points goes back to its pool
+    ErrCode setPoints(GuardDataMap& output, const FrameGuard& points)
+    {
+        const int32_t n = points->shape().d[0];
+        switch (_layout) {
+        case PointLayout::kPlanar: {
+            Frame2DGuard planar =
+                acquireFrame(_planarPool, Shape{3, {3, n, 1}}, DataType::kFp32, FrameType::kPointXYZPlanar);
+            DS3D_FAILED_RETURN(planar, ErrCode::kMem, "planar point pool exhausted");
+            DS3D_ERROR_RETURN(ToPointXYZPlanar(points, planar), "transpose points failed");
+            return SetPointXYZPlanar(output, planar);
+        }
+        case PointLayout::kFp16: {
+            FrameGuard half = acquireFrame(_compactPool, Shape{2, {n, 3}}, DataType::kFp16, FrameType::kPointXYZ);
+            DS3D_FAILED_RETURN(half, ErrCode::kMem, "compact point pool exhausted");
+            DS3D_ERROR_RETURN(ToPointXYZHalf(points, half), "convert points to fp16 failed");
+            return SetPointXYZCompact(output, half, nullptr);
+        }
+        case PointLayout::kInt16: {
+            FrameGuard quant = acquireFrame(_compactPool, Shape{2, {n, 3}}, DataType::kInt16, FrameType::kPointXYZ);
+            DS3D_FAILED_RETURN(quant, ErrCode::kMem, "compact point pool exhausted");
+            PointQuantParam param;
+            DS3D_ERROR_RETURN(ToPointXYZQuant(points, quant, param), "quantize points failed");
+            return SetPointXYZCompact(output, quant, &param);
+        }
+        default:
+            return SetPointXYZ(output, points);
+        }
+    }
+
+    bool _colorCoord = true;
+    uint32_t _maxPoints = 1280 * 720;
+    float _defaultScale = 0.0f;
+    PointLayout _layout = PointLayout::kXYZ;
+    DepthRayLut _lut;
+    std::unique_ptr<FramePool> _pointPool;
+    std::unique_ptr<FramePool> _uvPool;
+    std::unique_ptr<Frame2DPool> _planarPool;
+    std::unique_ptr<FramePool> _compactPool;
+};
+
+}}  // namespace ds3d::impl
+
+DS3D_EXTERN_C_BEGIN
+DS3D_EXPORT_API ds3d::abiRefDataFilter* createCpuDepth2PointFilter();
+DS3D_EXTERN_C_END
+
+ds3d::abiRefDataFilter*
+createCpuDepth2PointFilter()
+{
+    return ds3d::NewAbiRef<ds3d::abiDataFilter>(new ds3d::impl::CpuDepth2PointFilter);
+}
@@ -0,0 +1,97 @@
+#include "3d/hpp/depth_frame.hpp"
+#include "3d/hpp/frame_pool.hpp"
+#include "3d/hpp/impl_datafilter.hpp"
+
+/**
+ * @file publishes kDepthFrame in fp32 meters as kDepthMetersFrame
+ *
+ * config_body:
+ *   min_depth: 0.3       # in meters
+ *   max_depth: 2.0       # in meters
+ *   clamp: false         # true clamps depth out of [min_depth, max_depth], false marks it invalid (0)
+ *   valid_mask: false    # also publish kDepthValidMask
+ *   depth_scale: 0.001   # to meters, only used when the datamap has no kDepthScaleUnit
+ *   threads: 0           # 0 uses the shared ThreadPool, 1 the filter thread only
+ *   mem_type: cpu        # cpu or pinned output frames
+ *   mem_pool_size: 4     # output frames in flight
+ */
+
+namespace ds3d { namespace impl {
+
+class DepthMetersFilter : public BaseImplDataFilter {
+public:
+    DepthMetersFilter() : BaseImplDataFilter(4) {}
+    ~DepthMetersFilter() override = default;
+
+protected:
+    ErrCode startImpl(const YAML::Node& body) override
+    {
+        if (body) {
+            _range.minDepth = body["min_depth"].as<float>(_range.minDepth);
+            _range.maxDepth = body["max_depth"].as<float>(_range.maxDepth);
+            _range.clamp = body["clamp"].as<bool>(_range.clamp);
+            _validMask = body["valid_mask"].as<bool>(_validMask);
+            _defaultScale = body["depth_scale"].as<float>(_defaultScale);
+        }
+        DS3D_FAILED_RETURN(
+            _range.minDepth <= _range.maxDepth, ErrCode::kConfig, "min_depth must not exceed max_depth");
+        return ErrCode::kGood;
+    }
+
+    ErrCode processImpl(const GuardDataMap& input, GuardDataMap& output) override
+    {
+        auto [depth, depthScale] = input.fetch(kDepthFrame, kDepthScaleUnit);
+        if (!depth) {
+            return ErrCode::kGood;  // no depth in this datamap
+        }
+        float scale = depthScale ? static_cast<float>(depthScale->scaleUnit) : _defaultScale;
+        DS3D_FAILED_RETURN(scale > 0.0f, ErrCode::kConfig, "no kDepthScaleUnit in datamap and no depth_scale");
+
+        FrameView<const uint16_t> src(depth);
+        DS3D_FAILED_RETURN(src, ErrCode::kParam, "kDepthFrame must be CPU uint16");
+        const Shape shape{3, {static_cast<int32_t>(src.height()), static_cast<int32_t>(src.width()), 1}};
+        Frame2DGuard meters = acquireFrame(_metersPool, shape, DataType::kFp32, FrameType::kDepth);
+        DS3D_FAILED_RETURN(meters, ErrCode::kMem, "depth meters pool exhausted");
+        Frame2DGuard mask;
+        if (_validMask) {
+            mask = acquireFrame(_maskPool, shape, DataType::kUint8, FrameType::kCustom);
+            DS3D_FAILED_RETURN(mask, ErrCode::kMem, "depth mask pool exhausted");
+        }
+        DS3D_ERROR_RETURN(
+            DepthFrameToMeters(depth, scale, _range, meters, _validMask ? &mask : nullptr, threadPool()),
+            "convert depth to meters failed");
+
+        output = newOutput(input);
+        DS3D_ERROR_RETURN(output.setGuardData(kDepthMetersFrame, meters), "set kDepthMetersFrame failed");
+        if (_validMask) {
+            DS3D_ERROR_RETURN(output.setGuardData(kDepthValidMask, mask), "set kDepthValidMask failed");
+        }
+        return ErrCode::kGood;
+    }
+
+    ErrCode stopImpl() override
+    {
+        _metersPool.reset();
+        _maskPool.reset();
+        return ErrCode::kGood;
+    }
+
+private:
+    DepthRange _range;
+    bool _validMask = false;
+    float _defaultScale = 0.0f;
+    std::unique_ptr<Frame2DPool> _metersPool;
+    std::unique_ptr<Frame2DPool> _maskPool;
+};
+
+}}  // namespace ds3d::impl
+
+DS3D_EXTERN_C_BEGIN
+DS3D_EXPORT_API ds3d::abiRefDataFilter* createDepthMetersFilter();
+DS3D_EXTERN_C_END
+
+ds3d::abiRefDataFilter*
+createDepthMetersFilter()
+{
+    return ds3d::NewAbiRef<ds3d::abiDataFilter>(new ds3d::impl::DepthMetersFilter);
+}
@@ -0,0 +1,115 @@
+#include "3d/hpp/depth_registration.hpp"
+#include "3d/hpp/frame_pool.hpp"
+#include "3d/hpp/impl_datafilter.hpp"
+
+/**
+ * @file registers kColorFrame to kDepthFrame, or kDepthFrame to kColorFrame, and sets kColorDepthAligned
+ *
+ * config_body:
+ *   align_to: depth      # depth: color resampled to the depth camera, color: depth resampled to the color camera
+ *   depth_scale: 0.001   # to meters, only used when the datamap has no kDepthScaleUnit
+ *   threads: 0           # 0 uses the shared ThreadPool, 1 the filter thread only
+ *   mem_type: cpu        # cpu or pinned output frames
+ *   mem_pool_size: 4     # output frames in flight
+ *
+ * The resampled stream takes the intrinsics of the other camera and kDepth2ColorExtrinsics becomes identity,
+ * as the RealSense loader does with aligned_image_to_depth. Datamaps already aligned are passed through.
+ */
+
+namespace ds3d { namespace impl {
+
+class DepthRegisterFilter : public BaseImplDataFilter {
+public:
+    DepthRegisterFilter() : BaseImplDataFilter(4) {}
+    ~DepthRegisterFilter() override = default;
+
+protected:
+    ErrCode startImpl(const YAML::Node& body) override
+    {
+        if (body) {
+            std::string alignTo = body["align_to"].as<std::string>("depth");
+            DS3D_FAILED_RETURN(
+                alignTo == "depth" || alignTo == "color", ErrCode::kConfig, "align_to must be depth or color, got: %s",
+                alignTo.c_str());
+            _toColor = alignTo == "color";
+            _defaultScale = body["depth_scale"].as<float>(_defaultScale);
+        }
+        return ErrCode::kGood;
+    }
+
+    ErrCode processImpl(const GuardDataMap& input, GuardDataMap& output) override
+    {
+        auto [depth, color, depthScale, depthIntrinsics, colorIntrinsics, d2cExtrinsics, aligned] = input.fetch(
+            kDepthFrame, kColorFrame, kDepthScaleUnit, kDepthIntrinsics, kColorIntrinsics, kDepth2ColorExtrinsics,
+            kColorDepthAligned);
+        if (!depth || !color || (aligned && *aligned)) {
+            return ErrCode::kGood;  // nothing to register
+        }
+        DS3D_FAILED_RETURN(
+            depthIntrinsics && colorIntrinsics && d2cExtrinsics, ErrCode::kParam,
+            "registration needs kDepthIntrinsics, kColorIntrinsics and kDepth2ColorExtrinsics");
+        float scale = depthScale ? static_cast<float>(depthScale->scaleUnit) : _defaultScale;
+        DS3D_FAILED_RETURN(scale > 0.0f, ErrCode::kConfig, "no kDepthScaleUnit in datamap and no depth_scale");
+        DS3D_FAILED_RETURN(
+            _registration.update(*depthIntrinsics, *colorIntrinsics, *d2cExtrinsics, _toColor), ErrCode::kParam,
+            "invalid depth/color calibration");
+
+        ExtrinsicsParam identity{};
+        for (int i = 0; i < 3; ++i) {
+            identity.rotation[i].data[i] = 1.0f;
+        }
+        output = newOutput(input);
+        if (_toColor) {
+            Frame2DGuard alignedDepth = acquireAligned(depth, *colorIntrinsics);
+            DS3D_FAILED_RETURN(alignedDepth, ErrCode::kMem, "aligned depth pool exhausted");
+            DS3D_ERROR_RETURN(
+                _registration.depthToColor(depth, scale, alignedDepth, threadPool()), "register depth to color failed");
+            DS3D_ERROR_RETURN(output.setGuardData(kDepthFrame, alignedDepth), "set kDepthFrame failed");
+            DS3D_ERROR_RETURN(output.setData(kDepthIntrinsics, *colorIntrinsics), "set kDepthIntrinsics failed");
+        } else {
+            Frame2DGuard alignedColor = acquireAligned(color, *depthIntrinsics);
+            DS3D_FAILED_RETURN(alignedColor, ErrCode::kMem, "aligned color pool exhausted");
+            DS3D_ERROR_RETURN(
+                _registration.colorToDepth(depth, scale, color, alignedColor, threadPool()),
+                "register color to depth failed");
+            DS3D_ERROR_RETURN(output.setGuardData(kColorFrame, alignedColor), "set kColorFrame failed");
+            DS3D_ERROR_RETURN(output.setData(kColorIntrinsics, *depthIntrinsics), "set kColorIntrinsics failed");
+        }
+        DS3D_ERROR_RETURN(output.setData(kDepth2ColorExtrinsics, identity), "set kDepth2ColorExtrinsics failed");
+        DS3D_ERROR_RETURN(output.setData(kColorDepthAligned, true), "set kColorDepthAligned failed");
+        return ErrCode::kGood;
+    }
+
+    ErrCode stopImpl() override
+    {
+        _pool.reset();
+        return ErrCode::kGood;
+    }
+
+private:
+    // output frames: the pixel format of src at the resolution of the target camera
+    Frame2DGuard acquireAligned(const Frame2DGuard& src, const IntrinsicsParam& target)
+    {
+        const Frame2DPlane& plane = src->getPlane(0);
+        int32_t channels = static_cast<int32_t>(plane.bytesPerPixel / dataTypeBytes(src->dataType()));
+        Shape shape{3, {static_cast<int32_t>(target.height), static_cast<int32_t>(target.width), std::max(channels, 1)}};
+        return acquireFrame(_pool, shape, src->dataType(), src->frameType());
+    }
+
+    bool _toColor = false;
+    float _defaultScale = 0.0f;
+    DepthRegistration _registration;
+    std::unique_ptr<Frame2DPool> _pool;
+};
+
+}}  // namespace ds3d::impl
+
+DS3D_EXTERN_C_BEGIN
+DS3D_EXPORT_API ds3d::abiRefDataFilter* createDepthRegisterFilter();
+DS3D_EXTERN_C_END
+
+ds3d::abiRefDataFilter*
+createDepthRegisterFilter()
+{
+    return ds3d::NewAbiRef<ds3d::abiDataFilter>(new ds3d::impl::DepthRegisterFilter);
+}
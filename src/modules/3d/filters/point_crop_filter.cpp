@@ -0,0 +1,110 @@
+#include "3d/hpp/impl_datafilter.hpp"
+#include "3d/hpp/point_crop.hpp"
+#include "3d/hpp/point_frame.hpp"
+
+#include <vector>
+
+/**
+ * @file crops kPointXYZ (and kPointCoordUV, kPointNormal) to a box, a range and a view frustum before the render queue
+ *
+ * config_body, at least one region, enabled regions are intersected:
+ *   box: [-1.0, -1.0, 0.0, 1.0, 1.0, 3.0]  # xmin, ymin, zmin, xmax, ymax, zmax in meters
+ *   range: [0.3, 3.0]                      # min, max distance to the camera in meters
+ *   frustum:                               # camera at the origin looking along +z
+ *     near: 0.01
+ *     far: 10.0
+ *     fov: 40.0                            # vertical, in degrees
+ *     aspect: 1.7778                       # width / height
+ *   threads: 0                             # 0 uses the shared ThreadPool, 1 the filter thread only
+ *
+ * A kPointXYZPlanar or kPointXYZCompact cloud is read through GetPointXYZ. Once points are dropped the
+ * output is kPointXYZ and the other layouts are removed.
+ */
+
+namespace ds3d { namespace impl {
+
+class PointCropFilter : public BaseImplDataFilter {
+public:
+    PointCropFilter() = default;
+    ~PointCropFilter() override = default;
+
+protected:
+    ErrCode startImpl(const YAML::Node& body) override
+    {
+        DS3D_FAILED_RETURN(body, ErrCode::kConfig, "point crop filter needs a config_body");
+        PointCropParams params;
+        if (body["box"]) {
+            auto v = body["box"].as<std::vector<float>>();
+            DS3D_FAILED_RETURN(
+                v.size() == 6, ErrCode::kConfig, "box must be [xmin, ymin, zmin, xmax, ymax, zmax]");
+            std::copy(v.begin(), v.begin() + 3, params.boxMin);
+            std::copy(v.begin() + 3, v.end(), params.boxMax);
+            params.box = true;
+        }
+        if (body["range"]) {
+            auto v = body["range"].as<std::vector<float>>();
+            DS3D_FAILED_RETURN(v.size() == 2, ErrCode::kConfig, "range must be [min, max]");
+            params.minRange = v[0];
+            params.maxRange = v[1];
+            params.range = true;
+        }
+        if (const YAML::Node frustum = body["frustum"]) {
+            params.near = frustum["near"].as<float>(params.near);
+            params.far = frustum["far"].as<float>(params.far);
+            params.fov = frustum["fov"].as<float>(params.fov);
+            params.aspect = frustum["aspect"].as<float>(params.aspect);
+            params.frustum = true;
+        }
+        DS3D_FAILED_RETURN(
+            params.box || params.range || params.frustum, ErrCode::kConfig,
+            "point crop filter needs box, range or frustum");
+        _crop = std::make_unique<PointCrop>(params);
+        CropBounds bounds;
+        DS3D_FAILED_RETURN(isGood(_crop->makeBounds(bounds)), ErrCode::kConfig, "invalid crop region");
+        return ErrCode::kGood;
+    }
+
+    ErrCode processImpl(const GuardDataMap& input, GuardDataMap& output) override
+    {
+        FrameGuard points = GetPointXYZ(input);
+        if (!points) {
+            return ErrCode::kGood;  // no points in this datamap
+        }
+        auto [colorCoord, normals] = input.fetch(kPointCoordUV, kPointNormal);
+        FrameGuard outPoints, outCoord, outNormals;
+        DS3D_ERROR_RETURN(_crop->crop(points, colorCoord, outPoints, outCoord, threadPool()), "point crop failed");
+        if (outPoints.ptr() == points.ptr()) {
+            return ErrCode::kGood;  // every point kept, bypass
+        }
+        if (normals) {
+            DS3D_ERROR_RETURN(
+                _crop->compactRows(normals, FrameType::kPointNormal, outNormals, threadPool()),
+                "kPointNormal does not match kPointXYZ, crop normals failed");
+        }
+
+        output = newOutput(input);
+        DS3D_ERROR_RETURN(SetPointXYZ(output, outPoints), "set kPointXYZ failed");
+        if (outCoord) {
+            DS3D_ERROR_RETURN(output.setGuardData(kPointCoordUV, outCoord), "set kPointCoordUV failed");
+        }
+        if (outNormals) {
+            DS3D_ERROR_RETURN(output.setGuardData(kPointNormal, outNormals), "set kPointNormal failed");
+        }
+        return ErrCode::kGood;
+    }
+
+private:
+    std::unique_ptr<PointCrop> _crop;
+};
+
+}}  // namespace ds3d::impl
+
+DS3D_EXTERN_C_BEGIN
+DS3D_EXPORT_API ds3d::abiRefDataFilter* createPointCropFilter();
+DS3D_EXTERN_C_END
+
+ds3d::abiRefDataFilter*
+createPointCropFilter()
+{
+    return ds3d::NewAbiRef<ds3d::abiDataFilter>(new ds3d::impl::PointCropFilter);
+}
@@ -0,0 +1,83 @@
+#include "3d/hpp/frame_pool.hpp"
+#include "3d/hpp/impl_datafilter.hpp"
+#include "3d/hpp/point_frame.hpp"
+#include "3d/hpp/point_normals.hpp"
+
+/**
+ * @file publishes kPointNormal of the organized kPointXYZ of depth2point, from depth pixel neighbors
+ *
+ * config_body:
+ *   step: 2                 # pixel distance of the central differences
+ *   max_depth_change: 0.05  # per pixel, relative to the depth, larger changes are edges without normal
+ *   mem_pool_size: 8
+ *   mem_type: cpu           # cpu or pinned output frames
+ *   threads: 0              # 0 uses the shared ThreadPool, 1 the filter thread only
+ *
+ * kDepthIntrinsics gives the organized width and height, so the filter must follow depth2point
+ * before any filter which drops points.
+ */
+
+namespace ds3d { namespace impl {
+
+class PointNormalFilter : public BaseImplDataFilter {
+public:
+    PointNormalFilter() = default;
+    ~PointNormalFilter() override = default;
+
+protected:
+    ErrCode startImpl(const YAML::Node& body) override
+    {
+        OrganizedNormalParams params;
+        if (body) {
+            params.step = body["step"].as<uint32_t>(params.step);
+            params.maxDepthChange = body["max_depth_change"].as<float>(params.maxDepthChange);
+        }
+        DS3D_FAILED_RETURN(params.step >= 1, ErrCode::kConfig, "step must be at least 1");
+        DS3D_FAILED_RETURN(params.maxDepthChange > 0.0f, ErrCode::kConfig, "max_depth_change must be positive");
+        _normals = std::make_unique<OrganizedNormals>(params);
+        return ErrCode::kGood;
+    }
+
+    ErrCode processImpl(const GuardDataMap& input, GuardDataMap& output) override
+    {
+        FrameGuard points = GetPointXYZ(input);
+        if (!points) {
+            return ErrCode::kGood;  // no points in this datamap
+        }
+        auto [depthIntrinsics] = input.fetch(kDepthIntrinsics);
+        DS3D_FAILED_RETURN(depthIntrinsics, ErrCode::kParam, "point normal needs kDepthIntrinsics");
+        const uint32_t width = depthIntrinsics->width, height = depthIntrinsics->height;
+
+        FrameGuard normals = acquireFrame(
+            _normalPool, Shape{2, {static_cast<int32_t>(width * height), 3}}, DataType::kFp32, FrameType::kPointNormal);
+        DS3D_FAILED_RETURN(normals, ErrCode::kMem, "normal pool exhausted");
+        DS3D_ERROR_RETURN(
+            _normals->estimate(points, width, height, normals, threadPool()), "estimate point normals failed");
+
+        output = newOutput(input);
+        DS3D_ERROR_RETURN(output.setGuardData(kPointNormal, normals), "set kPointNormal failed");
+        return ErrCode::kGood;
+    }
+
+    ErrCode stopImpl() override
+    {
+        _normalPool.reset();
+        return ErrCode::kGood;
+    }
+
+private:
+    std::unique_ptr<OrganizedNormals> _normals;
+    std::unique_ptr<FramePool> _normalPool;
+};
+
+}}  // namespace ds3d::impl
+
+DS3D_EXTERN_C_BEGIN
+DS3D_EXPORT_API ds3d::abiRefDataFilter* createPointNormalFilter();
+DS3D_EXTERN_C_END
+
+ds3d::abiRefDataFilter*
+createPointNormalFilter()
+{
+    return ds3d::NewAbiRef<ds3d::abiDataFilter>(new ds3d::impl::PointNormalFilter);
+}
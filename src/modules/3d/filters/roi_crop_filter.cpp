@@ -0,0 +1,98 @@
+#include "3d/hpp/frame.hpp"
+#include "3d/hpp/impl_datafilter.hpp"
+
+/**
+ * @file crops depth/color frames to a region of interest without copying pixels
+ *
+ * config_body:
+ *   depth_roi: [212, 120, 424, 240] # x, y, width, height in pixels
+ *   color_roi: [480, 270, 960, 540] # optional, same layout
+ */
+
+namespace ds3d { namespace impl {
+
+class RoiCropFilter : public BaseImplDataFilter {
+public:
+    RoiCropFilter() = default;
+    ~RoiCropFilter() override = default;
+
+protected:
+    ErrCode startImpl(const YAML::Node& body) override
+    {
+        DS3D_FAILED_RETURN(body, ErrCode::kConfig, "roi crop filter needs a config_body");
+        DS3D_ERROR_RETURN(parseRoi(body["depth_roi"], _depth), "parse depth_roi failed");
+        DS3D_ERROR_RETURN(parseRoi(body["color_roi"], _color), "parse color_roi failed");
+        DS3D_FAILED_RETURN(
+            _depth.enabled || _color.enabled, ErrCode::kConfig, "roi crop filter needs depth_roi or color_roi");
+        return ErrCode::kGood;
+    }
+
+    ErrCode processImpl(const GuardDataMap& input, GuardDataMap& output) override
+    {
+        output = newOutput(input);
+        if (_depth.enabled) {
+            DS3D_ERROR_RETURN(crop(input, output, kDepthFrame, kDepthIntrinsics, _depth), "crop depth failed");
+        }
+        if (_color.enabled) {
+            DS3D_ERROR_RETURN(crop(input, output, kColorFrame, kColorIntrinsics, _color), "crop color failed");
+        }
+        return ErrCode::kGood;
+    }
+
+private:
+    struct StreamRoi {
+        bool enabled = false;
+        FrameRoi roi;
+    };
+
+    static ErrCode parseRoi(const YAML::Node& node, StreamRoi& stream)
+    {
+        if (!node) {
+            return ErrCode::kGood;
+        }
+        auto v = node.as<std::vector<uint32_t>>();
+        DS3D_FAILED_RETURN(v.size() == 4, ErrCode::kConfig, "roi must be [x, y, width, height]");
+        DS3D_FAILED_RETURN(v[2] && v[3], ErrCode::kConfig, "roi width and height must not be 0");
+        stream.roi = FrameRoi{v[0], v[1], v[2], v[3]};
+        stream.enabled = true;
+        return ErrCode::kGood;
+    }
+
+    // replace the frame by its ROI view, the intrinsics follow the new origin
+    static ErrCode crop(
+        const GuardDataMap& input, GuardDataMap& output, const Key<abi2DFrame>& frameKey,
+        const Key<IntrinsicsParam>& intrinsicsKey, const StreamRoi& stream)
+    {
+        auto [frame, intrinsics] = input.fetch(frameKey, intrinsicsKey);
+        if (!frame) {
+            return ErrCode::kGood;  // stream not in this datamap
+        }
+        Frame2DGuard roiFrame = Roi2DFrame(frame, stream.roi);
+        DS3D_FAILED_RETURN(roiFrame, ErrCode::kConfig, "ROI does not fit frame: %s", frameKey.name);
+        DS3D_ERROR_RETURN(output.setGuardData(frameKey, roiFrame), "set ROI frame: %s failed", frameKey.name);
+        if (intrinsics) {
+            IntrinsicsParam param = *intrinsics;
+            param.centerX -= static_cast<float>(stream.roi.x);
+            param.centerY -= static_cast<float>(stream.roi.y);
+            param.width = stream.roi.width;
+            param.height = stream.roi.height;
+            DS3D_ERROR_RETURN(output.setData(intrinsicsKey, param), "set ROI intrinsics failed");
+        }
+        return ErrCode::kGood;
+    }
+
+    StreamRoi _depth;
+    StreamRoi _color;
+};
+
+}}  // namespace ds3d::impl
+
+DS3D_EXTERN_C_BEGIN
+DS3D_EXPORT_API ds3d::abiRefDataFilter* createRoiCropFilter();
+DS3D_EXTERN_C_END
+
+ds3d::abiRefDataFilter*
+createRoiCropFilter()
+{
+    return ds3d::NewAbiRef<ds3d::abiDataFilter>(new ds3d::impl::RoiCropFilter);
+}
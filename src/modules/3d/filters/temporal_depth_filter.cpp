@@ -0,0 +1,88 @@
+#include "3d/hpp/depth_temporal.hpp"
+#include "3d/hpp/frame_pool.hpp"
+#include "3d/hpp/impl_datafilter.hpp"
+
+/**
+ * @file smooths kDepthFrame over time and fills dropout holes, the output is still a uint16 kDepthFrame
+ *
+ * config_body:
+ *   alpha: 0.4         # weight of the new frame, 1 disables smoothing
+ *   delta: 20          # in raw depth units, larger changes are taken as they are (edges)
+ *   persistence: 3     # fill a hole if the pixel was valid in this many of the last history frames, 0 disables
+ *   history: 8         # frames, 1 to 8
+ *   threads: 0         # 0 uses the shared ThreadPool, 1 the filter thread only
+ *   mem_type: cpu      # cpu or pinned output frames
+ *   mem_pool_size: 4   # output frames in flight
+ */
+
+namespace ds3d { namespace impl {
+
+class TemporalDepthFilter : public BaseImplDataFilter {
+public:
+    TemporalDepthFilter() : BaseImplDataFilter(4) {}
+    ~TemporalDepthFilter() override = default;
+
+protected:
+    ErrCode startImpl(const YAML::Node& body) override
+    {
+        DepthTemporalParams params;
+        if (body) {
+            float alpha = body["alpha"].as<float>(0.4f);
+            DS3D_FAILED_RETURN(alpha > 0.0f && alpha <= 1.0f, ErrCode::kConfig, "alpha must be in (0, 1]");
+            params.alpha = DepthTemporalParams::alphaFromFloat(alpha);
+            params.delta = body["delta"].as<uint16_t>(params.delta);
+            uint32_t history = body["history"].as<uint32_t>(params.history);
+            uint32_t persistence = body["persistence"].as<uint32_t>(params.persistence);
+            DS3D_FAILED_RETURN(history >= 1 && history <= 8, ErrCode::kConfig, "history must be 1 to 8 frames");
+            DS3D_FAILED_RETURN(persistence <= history, ErrCode::kConfig, "persistence must not exceed history");
+            params.history = static_cast<uint8_t>(history);
+            params.persistence = static_cast<uint8_t>(persistence);
+        }
+        _smoother = std::make_unique<TemporalDepthSmoother>(params);
+        return ErrCode::kGood;
+    }
+
+    ErrCode processImpl(const GuardDataMap& input, GuardDataMap& output) override
+    {
+        auto [depth] = input.fetch(kDepthFrame);
+        if (!depth) {
+            return ErrCode::kGood;  // no depth in this datamap
+        }
+        FrameView<const uint16_t> src(depth);
+        DS3D_FAILED_RETURN(src, ErrCode::kParam, "kDepthFrame must be CPU uint16");
+        Frame2DGuard smoothed = acquireFrame(
+            _pool, Shape{3, {static_cast<int32_t>(src.height()), static_cast<int32_t>(src.width()), 1}},
+            DataType::kUint16, FrameType::kDepth);
+        DS3D_FAILED_RETURN(smoothed, ErrCode::kMem, "temporal depth pool exhausted");
+        DS3D_ERROR_RETURN(_smoother->process(depth, smoothed, threadPool()), "temporal depth filter failed");
+
+        output = newOutput(input);
+        DS3D_ERROR_RETURN(output.setGuardData(kDepthFrame, smoothed), "set kDepthFrame failed");
+        return ErrCode::kGood;
+    }
+
+    ErrCode stopImpl() override
+    {
+        _pool.reset();
+        if (_smoother) {
+            _smoother->reset();
+        }
+        return ErrCode::kGood;
+    }
+
+private:
+    std::unique_ptr<TemporalDepthSmoother> _smoother;
+    std::unique_ptr<Frame2DPool> _pool;
+};
+
+}}  // namespace ds3d::impl
+
+DS3D_EXTERN_C_BEGIN
+DS3D_EXPORT_API ds3d::abiRefDataFilter* createTemporalDepthFilter();
+DS3D_EXTERN_C_END
+
+ds3d::abiRefDataFilter*
+createTemporalDepthFilter()
+{
+    return ds3d::NewAbiRef<ds3d::abiDataFilter>(new ds3d::impl::TemporalDepthFilter);
+}
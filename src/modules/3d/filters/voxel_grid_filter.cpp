@@ -0,0 +1,72 @@
+#include "3d/hpp/impl_datafilter.hpp"
+#include "3d/hpp/point_frame.hpp"
+#include "3d/hpp/voxel_grid.hpp"
+
+/**
+ * @file downsamples kPointXYZ (and kPointCoordUV) to one centroid per occupied voxel
+ *
+ * config_body:
+ *   voxel_size: 0.02   # voxel edge in meters
+ *   max_points: 20000  # optional output budget, the voxel size doubles until it fits
+ *   threads: 0         # 0 uses the shared ThreadPool, 1 the filter thread only
+ *
+ * kPointNormal is removed, its rows no longer match the centroids. A kPointXYZPlanar or
+ * kPointXYZCompact cloud is read through GetPointXYZ, the output is kPointXYZ and the other layouts
+ * are removed.
+ */
+
+namespace ds3d { namespace impl {
+
+class VoxelGridFilter : public BaseImplDataFilter {
+public:
+    VoxelGridFilter() = default;
+    ~VoxelGridFilter() override = default;
+
+protected:
+    ErrCode startImpl(const YAML::Node& body) override
+    {
+        DS3D_FAILED_RETURN(body && body["voxel_size"], ErrCode::kConfig, "voxel grid filter needs voxel_size");
+        float voxelSize = body["voxel_size"].as<float>();
+        DS3D_FAILED_RETURN(voxelSize > 0.0f, ErrCode::kConfig, "voxel_size must be positive");
+        uint32_t maxPoints = body["max_points"].as<uint32_t>(0);
+        _grid = std::make_unique<VoxelGrid>(voxelSize, maxPoints);
+        return ErrCode::kGood;
+    }
+
+    ErrCode processImpl(const GuardDataMap& input, GuardDataMap& output) override
+    {
+        FrameGuard points = GetPointXYZ(input);
+        if (!points) {
+            return ErrCode::kGood;  // no points in this datamap
+        }
+        auto [colorCoord] = input.fetch(kPointCoordUV);
+        FrameGuard outPoints, outCoord;
+        DS3D_ERROR_RETURN(
+            _grid->downsample(points, colorCoord, outPoints, outCoord, threadPool()), "voxel grid downsample failed");
+
+        output = newOutput(input);
+        DS3D_ERROR_RETURN(SetPointXYZ(output, outPoints), "set kPointXYZ failed");
+        if (outCoord) {
+            DS3D_ERROR_RETURN(output.setGuardData(kPointCoordUV, outCoord), "set kPointCoordUV failed");
+        }
+        if (input.hasData(kPointNormal)) {
+            DS3D_ERROR_RETURN(output.removeData(kPointNormal), "remove kPointNormal failed");
+        }
+        return ErrCode::kGood;
+    }
+
+private:
+    std::unique_ptr<VoxelGrid> _grid;
+};
+
+}}  // namespace ds3d::impl
+
+DS3D_EXTERN_C_BEGIN
+DS3D_EXPORT_API ds3d::abiRefDataFilter* createVoxelGridFilter();
+DS3D_EXTERN_C_END
+
+ds3d::abiRefDataFilter*
+createVoxelGridFilter()
+{
+    return ds3d::NewAbiRef<ds3d::abiDataFilter>(new ds3d::impl::VoxelGridFilter);
+}
@@ -37,6 +37,9 @@ namespace ds3d {
  *            std::cout << "input data consumed" << std::endl;
  *         });
  *     DS_ASSERT(isGood(c));
+ *     // or register the callbacks once and skip building them per frame
+ *     guardFilter.setProcessCallbacks(onOutput, onConsumed);
+ *     c = guardFilter.process(inputData);
  *     //... wait for all data processed before stop
  *     c = guardFilter.flush();
  *     c = guardFilter.stop(); // invoke abiDataFilter::stop_i(...)
@@ -53,20 +56,52 @@ public:
     }
     ~GuardDataFilter() = default;
 
-    ErrCode process(
-        GuardDataMap datamap, abiOnDataCB::CppFunc outputDataCB,
-        abiOnDataCB::CppFunc inputConsumedCB)
+    // copies share the filter but not the callbacks of setProcessCallbacks,
+    // a copy registers its own
+    GuardDataFilter(const GuardDataFilter& o) : _Base(static_cast<const _Base&>(o)) {}
+    GuardDataFilter& operator=(const GuardDataFilter& o)
+    {
+        _Base::operator=(o);
+        _outputCb.reset();
+        _consumedCb.reset();
+        return *this;
+    }
+
+    // the callbacks are stored as they are, no std::function in between
+    template <typename OutputF, typename ConsumedF>
+    ErrCode process(const GuardDataMap& datamap, OutputF&& outputDataCB, ConsumedF&& inputConsumedCB)
     {
         GuardCB<abiOnDataCB> guardOutputCb;
         GuardCB<abiOnDataCB> guardConsumedCb;
-        guardOutputCb.setFn<ErrCode, const abiRefDataMap*>(std::move(outputDataCB));
-        guardConsumedCb.setFn<ErrCode, const abiRefDataMap*>(std::move(inputConsumedCB));
+        guardOutputCb.setFn<ErrCode, const abiRefDataMap*>(std::forward<OutputF>(outputDataCB));
+        guardConsumedCb.setFn<ErrCode, const abiRefDataMap*>(std::forward<ConsumedF>(inputConsumedCB));
 
         DS_ASSERT(ptr());
         ErrCode code =
             ptr()->process_i(datamap.abiRef(), guardOutputCb.abiRef(), guardConsumedCb.abiRef());
         return code;
     }
+
+    // register long-lived output/consumed callbacks, e.g. before start().
+    // The per-frame context is the datamap passed to each callback.
+    template <typename OutputF, typename ConsumedF>
+    void setProcessCallbacks(OutputF&& outputDataCB, ConsumedF&& inputConsumedCB)
+    {
+        _outputCb.setFn<ErrCode, const abiRefDataMap*>(std::forward<OutputF>(outputDataCB));
+        _consumedCb.setFn<ErrCode, const abiRefDataMap*>(std::forward<ConsumedF>(inputConsumedCB));
+    }
+
+    // process with the callbacks from setProcessCallbacks, they are passed by
+    // reference so nothing is allocated per frame
+    ErrCode process(const GuardDataMap& datamap)
+    {
+        DS_ASSERT(ptr());
+        return ptr()->process_i(datamap.abiRef(), _outputCb.abiRef(), _consumedCb.abiRef());
+    }
+
+private:
+    GuardCB<abiOnDataCB> _outputCb;
+    GuardCB<abiOnDataCB> _consumedCb;
 };
 
 }  // namespace ds3d
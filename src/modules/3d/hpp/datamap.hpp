@@ -4,6 +4,8 @@
 #include "3d/common/func_utils.h"
 #include "obj.hpp"
 
+#include <optional>
+
 /**
  * @file Operates on GuardData to perform key logic.
  * E.g. Appsrc uses GuardDataLoader, nvds3dfilter uses GuardDataFilter, appsink uses GuardDataRender
@@ -11,6 +13,67 @@
 
 namespace ds3d {
 
+// result type of GuardDataMap::fetch for a Key<K>. Plain structures (e.g.
+// IntrinsicsParam) are copied into std::optional<K>, abi objects (e.g. frames)
+// are returned as GuardDataT<K>, which is empty when the key is missing.
+template <typename K>
+using FetchType = std::conditional_t<std::is_trivially_copyable<K>::value, std::optional<K>, GuardDataT<K>>;
+
+// a key defined in common.h with the typeid it is stored with
+struct KnownDataKey {
+    DataKey key;
+    TIdType tid;
+};
+
+template <typename K>
+constexpr KnownDataKey
+knownDataKey(const Key<K>& key)
+{
+    return KnownDataKey{key, TpId<K>::__typeid()};
+}
+
+// datamaps without abiDataMapV2 can not enumerate, they are probed for these keys
+inline const std::vector<KnownDataKey>&
+KnownDataKeys()
+{
+    static const std::vector<KnownDataKey> keys = {
+        knownDataKey(kTimeStamp),           knownDataKey(kColorFrame),
+        knownDataKey(kDepthFrame),          knownDataKey(kDepthScaleUnit),
+        knownDataKey(kDepthIntrinsics),     knownDataKey(kColorIntrinsics),
+        knownDataKey(kDepth2ColorExtrinsics), knownDataKey(kColorDepthAligned),
+        knownDataKey(kEOS),                 knownDataKey(kPointXYZ),
+        knownDataKey(kPointCoordUV),        knownDataKey(kLidarXYZI),
+        knownDataKey(kLidarInferenceParas), knownDataKey(kLidarRefDataMap),
+        knownDataKey(kLidar3DBboxRawData), knownDataKey(kPointXYZPlanar),
+        knownDataKey(kPointXYZCompact),    knownDataKey(kPointQuantParam),
+        knownDataKey(kDepthMetersFrame),   knownDataKey(kDepthValidMask),
+        knownDataKey(kPointNormal),
+    };
+    return keys;
+}
+
+// payload bytes per key of a datamap, see GuardDataMap::memoryReport
+struct DataMapMemoryReport {
+    struct Item {
+        std::string key;
+        TIdType tid = 0;
+        size_t bytes = 0;
+    };
+    std::vector<Item> items;  // largest first
+    size_t totalBytes = 0;
+
+    std::string str() const
+    {
+        std::string s = "datamap total bytes: " + std::to_string(totalBytes);
+        for (const auto& item : items) {
+            char tid[32];
+            snprintf(tid, sizeof(tid), "0x%" PRIx64, item.tid);
+            s += "\n  " + item.key + " (typeid " + tid + "): " + std::to_string(item.bytes);
+        }
+        return s;
+    }
+};
+
 class GuardDataMap : public GuardDataT<abiDataMap> {
     using _Base = GuardDataT<abiDataMap>;
 
@@ -46,7 +109,7 @@ public:
     template <class T>
     inline ErrCode setPtrData(const KeyName& name, UniqPtr<T> value)
     {
-        return this->setPtrData(ShrdPtr<T>(std::move(value)));
+        return this->setPtrData(name, ShrdPtr<T>(std::move(value)));
     }
 
     template <class T>
@@ -71,6 +134,180 @@ public:
         DS_ASSERT(ptr());
         return ptr()->clear_i();
     }
+
+    // typed keys, e.g. kDepthFrame. Lookups use the precomputed key hash when
+    // the datamap implements abiDataMapV2, otherwise fall back to the string ABI
+    // without building a std::string.
+    template <typename K>
+    bool hasData(const Key<K>& key) const
+    {
+        DS_ASSERT(ptr());
+        abiDataMapV2* v2 = mapV2();
+        return v2 ? v2->hasKey_i(key) : ptr()->has_i(key.name);
+    }
+
+    template <typename K, class T, _EnableIfValidIdType<T> = true>
+    inline ErrCode setData(const Key<K>& key, const T& value);  // copy T
+
+    template <typename K, class T>
+    inline ErrCode setGuardData(const Key<K>& key, const GuardDataT<T>& value);
+
+    template <typename K, class T>
+    inline ErrCode setPtrData(const Key<K>& key, ShrdPtr<T> value);
+
+    template <typename K, class T>
+    inline ErrCode getGuardData(const Key<K>& key, GuardDataT<T>& value) const;
+
+    template <typename K, class T, _EnableIfValidIdType<T> = true>
+    inline ErrCode getData(const Key<K>& key, T& value) const;
+
+    template <typename K>
+    inline ErrCode removeData(const Key<K>& key)
+    {
+        DS_ASSERT(ptr());
+        abiDataMapV2* v2 = mapV2();
+        return v2 ? v2->removeBufKey_i(key) : ptr()->removeBuf_i(key.name);
+    }
+
+    /**
+     * @brief resolve a set of typed keys in one pass.
+     *   A missing key (or a typeid mismatch) is a normal result, the matching
+     *   tuple element is left empty.
+     *   For example:
+     *     auto [points, intrinsics] = datamap.fetch(kPointXYZ, kDepthIntrinsics);
+     *     if (points && intrinsics) { ... intrinsics->fx ... }
+     */
+    template <typename... K>
+    std::tuple<FetchType<K>...> fetch(const Key<K>&... keys) const
+    {
+        DataKeyQuery queries[] = {DataKeyQuery{&keys, TpId<K>::__typeid()}...};
+        abiDataMapV2* v2 = mapV2();
+        resolve(v2, queries, sizeof...(K));
+        std::tuple<FetchType<K>...> res;
+        fetchAssignAll(queries, res, std::index_sequence_for<K...>{});
+        return res;
+    }
+
+    /**
+     * @brief visit every key with f(const DataMapEntry&). Maps which do not
+     *   implement abiDataMapV2 are probed for KnownDataKeys() only.
+     *   The datamap must not be modified from f.
+     */
+    template <class F>
+    ErrCode forEach(F&& f) const
+    {
+        DS_ASSERT(ptr());
+        abiDataMapV2* v2 = mapV2();
+        if (v2) {
+            CBObjT<const DataMapEntry*> cb([&f](const DataMapEntry* entry) { f(*entry); });
+            return v2->enumerate_i(&cb);
+        }
+        for (const auto& known : KnownDataKeys()) {
+            const abiRefAny* data = nullptr;
+            if (isGood(ptr()->getBuf_i(known.key.name, known.tid, data))) {
+                DataMapEntry entry{known.key.name, known.tid, data};
+                f(entry);
+            }
+        }
+        return ErrCode::kGood;
+    }
+
+    // payload bytes held by each key, e.g. abiFrame::bytes() for frames
+    DataMapMemoryReport memoryReport() const
+    {
+        DataMapMemoryReport report;
+        forEach([&report](const DataMapEntry& entry) {
+            size_t bytes = typeIdBytes(entry.tid, entry.data ? entry.data->data() : nullptr);
+            report.items.push_back(DataMapMemoryReport::Item{entry.key, entry.tid, bytes});
+            report.totalBytes += bytes;
+        });
+        std::sort(report.items.begin(), report.items.end(), [](const auto& a, const auto& b) {
+            return a.bytes > b.bytes;
+        });
+        return report;
+    }
+
+    // make the datamap read-only and safe for concurrent readers, see abiDataMapV2::freeze_i.
+    // Legacy datamaps can not be frozen, ErrCode::kUnsupported is returned.
+    ErrCode freeze()
+    {
+        DS_ASSERT(ptr());
+        abiDataMapV2* v2 = mapV2();
+        return v2 ? v2->freeze_i() : ErrCode::kUnsupported;
+    }
+    bool frozen() const
+    {
+        abiDataMapV2* v2 = mapV2();
+        return v2 && v2->frozen_i();
+    }
+
+    // return the extended interface if the datamap implements it
+    abiDataMapV2* mapV2() const { return ptr() ? ptr()->v2_i() : nullptr; }
+
+private:
+    // v2 is the cached mapV2(), nullptr selects the string ABI
+    ErrCode setBuf(abiDataMapV2* v2, const DataKey& key, TIdType tid, abiRefAny* data)
+    {
+        DS_ASSERT(ptr());
+        return v2 ? v2->setBufKey_i(key, tid, data) : ptr()->setBuf_i(key.name, tid, data);
+    }
+
+    ErrCode getBuf(const abiDataMapV2* v2, const DataKey& key, TIdType tid, const abiRefAny*& data) const
+    {
+        DS_ASSERT(ptr());
+        return v2 ? v2->getBufKey_i(key, tid, data) : ptr()->getBuf_i(key.name, tid, data);
+    }
+
+    // store trivially copyable values inline in the datamap, no heap allocation.
+    // returns ErrCode::kUnsupported when the caller has to store a heap copy.
+    template <class T>
+    ErrCode setInlineValue(const DataKey& key, const T& value)
+    {
+        using t = std::remove_const_t<std::remove_reference_t<T>>;
+        if constexpr (std::is_trivially_copyable<t>::value) {
+            DS_ASSERT(ptr());
+            abiDataMapV2* v2 = mapV2();
+            if (v2) {
+                return v2->setValueKey_i(key, TpId<t>::__typeid(), &value, sizeof(t));
+            }
+        }
+        return ErrCode::kUnsupported;
+    }
+
+    void resolve(const abiDataMapV2* v2, DataKeyQuery* queries, uint32_t num) const
+    {
+        DS_ASSERT(ptr());
+        if (v2 && isGood(v2->getBufKeys_i(queries, num))) {
+            return;
+        }
+        for (uint32_t i = 0; i < num; ++i) {
+            DataKeyQuery& q = queries[i];
+            q.data = nullptr;
+            q.code = ptr()->getBuf_i(q.key->name, q.tid, q.data);
+        }
+    }
+
+    template <typename K>
+    static void fetchAssign(const DataKeyQuery& q, std::optional<K>& out)
+    {
+        if (isGood(q.code) && q.data && q.data->data()) {
+            out.emplace(*static_cast<const K*>(q.data->data()));
+        }
+    }
+
+    template <typename K>
+    static void fetchAssign(const DataKeyQuery& q, GuardDataT<K>& out)
+    {
+        if (isGood(q.code) && q.data) {
+            out.reset(new abiRefCast<void, K>(const_cast<abiRefAny*>(q.data), false));
+        }
+    }
+
+    template <typename Tuple, size_t... I>
+    static void fetchAssignAll(const DataKeyQuery* queries, Tuple& res, std::index_sequence<I...>)
+    {
+        (fetchAssign(queries[I], std::get<I>(res)), ...);
+    }
 };
 
 template <class T>
@@ -99,12 +336,15 @@ GuardDataMap::setRefData(const GuardDataMap::KeyName& name, const abiRefT<T>& va
     return code;
 }
 
-template <class T, _EnableIfValidIdType<T> = true>
+template <class T, _EnableIfValidIdType<T>>
 ErrCode
 GuardDataMap::setData(const GuardDataMap::KeyName& name, const T& value)
 {
     using t = std::remove_const_t<std::remove_reference_t<T>>;
-    // TIdType tyid = TpId<t>::__typeid();
+    ErrCode code = setInlineValue(DataKey(name.c_str()), value);
+    if (code != ErrCode::kUnsupported) {
+        return code;
+    }
     ShrdPtr<t> data(new t(value));
     return this->setPtrData(name, std::move(data));
 }
@@ -172,7 +412,7 @@ GuardDataMap::getPtrData(const GuardDataMap::KeyName& name, ShrdPtr<T>& value)
     return code;
 }
 
-template <class T, _EnableIfValidIdType<T> = true>
+template <class T, _EnableIfValidIdType<T>>
 ErrCode
 GuardDataMap::getData(const GuardDataMap::KeyName& name, T& value)
 {
@@ -189,6 +429,92 @@ GuardDataMap::getData(const GuardDataMap::KeyName& name, T& value)
     return code;
 }
 
+template <typename K, class T, _EnableIfValidIdType<T>>
+ErrCode
+GuardDataMap::setData(const Key<K>& key, const T& value)
+{
+    using t = std::remove_const_t<std::remove_reference_t<T>>;
+    static_assert(std::is_same<K, t>::value, "value type does not match the key type");
+    ErrCode code = setInlineValue(key, value);
+    if (code != ErrCode::kUnsupported) {
+        return code;
+    }
+    ShrdPtr<t> data(new t(value));
+    return this->setPtrData(key, std::move(data));
+}
+
+template <typename K, class T>
+ErrCode
+GuardDataMap::setGuardData(const Key<K>& key, const GuardDataT<T>& value)
+{
+    static_assert(
+        std::is_base_of<T, K>::value || std::is_base_of<K, T>::value,
+        "guard type does not match the key type");
+    if (!value.abiRef()) {
+        return ErrCode::kNullPtr;
+    }
+    using t = std::remove_const_t<T>;
+    abiDataMapV2* v2 = mapV2();
+    abiRefAny* u = new abiRefCast<T, void>(*value.abiRef());
+    DS_ASSERT(u && u->data());
+    ErrCode code = setBuf(v2, key, TpId<t>::__typeid(), u);
+    if (!isGood(code)) {
+        u->destroy();
+    }
+    return code;
+}
+
+template <typename K, class T>
+ErrCode
+GuardDataMap::setPtrData(const Key<K>& key, ShrdPtr<T> value)
+{
+    using t = std::remove_const_t<T>;
+    abiDataMapV2* v2 = mapV2();
+    abiRefAny* u = PtrToAbiRef<T, void>(std::move(value));
+    DS_ASSERT(u && u->data());
+    ErrCode code = setBuf(v2, key, TpId<t>::__typeid(), u);
+    if (!isGood(code)) {
+        u->destroy();
+    }
+    return code;
+}
+
+template <typename K, class T>
+ErrCode
+GuardDataMap::getGuardData(const Key<K>& key, GuardDataT<T>& guardData) const
+{
+    static_assert(
+        std::is_base_of<T, K>::value || std::is_base_of<K, T>::value,
+        "guard type does not match the key type");
+    using t = std::remove_const_t<T>;
+    const abiRefAny* ud = nullptr;
+    abiDataMapV2* v2 = mapV2();
+    ErrCode code = getBuf(v2, key, TpId<t>::__typeid(), ud);
+    if (!isGood(code)) {
+        guardData.reset();
+        return code;
+    }
+    guardData.reset(new abiRefCast<void, T>(const_cast<abiRefAny*>(ud), false));
+    DS_ASSERT(guardData);
+    return code;
+}
+
+template <typename K, class T, _EnableIfValidIdType<T>>
+ErrCode
+GuardDataMap::getData(const Key<K>& key, T& value) const
+{
+    using t = std::remove_const_t<T>;
+    static_assert(std::is_same<K, t>::value, "value type does not match the key type");
+    const abiRefAny* ud = nullptr;
+    ErrCode code = getBuf(mapV2(), key, TpId<t>::__typeid(), ud);
+    if (!isGood(code)) {
+        return code;
+    }
+    DS_ASSERT(ud && ud->data());
+    value = *(static_cast<T*>(ud->data()));
+    return code;
+}
+
 }  // namespace ds3d
 
 #endif  // _DS3D_COMMON_HPP_DATAMAP_HPP
\ No newline at end of file
@@ -36,6 +36,9 @@ using GuardWindow = GuardDataT<abiWindow>;
  *            GuardDataMap doneData(*d); // check ErrCode and data.
  *         });
  *     DS_ASSERT(isGood(c));
+ *     // or register the done callback once and skip building it per frame
+ *     guardRender.setRenderCallback(onDone);
+ *     c = guardRender.render(data);
  *     c = guardRender.flush(); // flush all data in queue
  *     c = guardRender.stop(); // invoke abiDataRender::stop_i(...)
  *     guardRender.reset(); // destroy abiRefDataRender, when all reference
@@ -51,21 +54,48 @@ public:
     }
     ~GuardDataRender() = default;
 
+    // copies share the render but not the callback of setRenderCallback,
+    // a copy registers its own
+    GuardDataRender(const GuardDataRender& o) : _Base(static_cast<const _Base&>(o)) {}
+    GuardDataRender& operator=(const GuardDataRender& o)
+    {
+        _Base::operator=(o);
+        _doneCb.reset();
+        return *this;
+    }
+
     ErrCode preroll(GuardDataMap datamap)
     {
         DS_ASSERT(ptr());
         return ptr()->preroll_i(datamap.abiRef());
     }
 
-    ErrCode render(GuardDataMap datamap, abiOnDataCB::CppFunc dataDoneCB)
+    // the callback is stored as it is, no std::function in between
+    template <typename DoneF>
+    ErrCode render(const GuardDataMap& datamap, DoneF&& dataDoneCB)
     {
         GuardCB<abiOnDataCB> cb;
-        cb.setFn<ErrCode, const abiRefDataMap*>(std::move(dataDoneCB));
+        cb.setFn<ErrCode, const abiRefDataMap*>(std::forward<DoneF>(dataDoneCB));
         DS_ASSERT(ptr());
         ErrCode code = ptr()->render_i(datamap.abiRef(), cb.abiRef());
         return code;
     }
 
+    // register a long-lived done callback
+    template <typename DoneF>
+    void setRenderCallback(DoneF&& dataDoneCB)
+    {
+        _doneCb.setFn<ErrCode, const abiRefDataMap*>(std::forward<DoneF>(dataDoneCB));
+    }
+
+    // render with the callback from setRenderCallback, it is passed by
+    // reference so nothing is allocated per frame
+    ErrCode render(const GuardDataMap& datamap)
+    {
+        DS_ASSERT(ptr());
+        return ptr()->render_i(datamap.abiRef(), _doneCb.abiRef());
+    }
+
     GuardWindow getWindow() const {
         DS_ASSERT(ptr());
         const abiRefWindow* refWin = ptr()->getWindow_i();
@@ -75,6 +105,9 @@ public:
             return nullptr;
         }
     }
+
+private:
+    GuardCB<abiOnDataCB> _doneCb;
 };
 
 }  // namespace ds3d
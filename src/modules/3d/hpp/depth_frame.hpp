@@ -0,0 +1,134 @@
+#ifndef DS3D_COMMON_HPP_DEPTH_FRAME_HPP
+#define DS3D_COMMON_HPP_DEPTH_FRAME_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/depth_kernels.h"
+#include "3d/common/depth_unproject.h"
+
+#include "frame.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @file frame level depth conversions: uint16 kDepthFrame <-> fp32 kDepthMetersFrame, kDepthFrame -> kPointXYZ
+ */
+
+namespace ds3d {
+
+// rows per ThreadPool tile, 16 rows of 848 uint16 pixels (27 KB) fit in L1, 30 tiles per 848x480 frame
+constexpr uint32_t kDepthTileRows = 16;
+
+/**
+ * @brief convert a uint16 depth frame to fp32 meters (see DepthToMeters).
+ *   meters, and mask if not null, are created as width x height frames when
+ *   empty, otherwise they must be CPU fp32 / uint8 frames of the depth size,
+ *   e.g. from a Frame2DPool. Rows are converted in kDepthTileRows tiles on
+ *   pool, or on the caller thread if pool is null.
+ */
+inline ErrCode
+DepthFrameToMeters(
+    const Frame2DGuard& depth, float scale, const DepthRange& range, Frame2DGuard& meters, Frame2DGuard* mask,
+    ThreadPool* pool = nullptr)
+{
+    FrameView<const uint16_t> src(depth);
+    DS3D_FAILED_RETURN(src, ErrCode::kParam, "depth frame must be CPU uint16");
+    DS3D_FAILED_RETURN(scale > 0.0f, ErrCode::kParam, "depth scale must be positive");
+    uint32_t w = src.width(), h = src.height();
+    if (!meters) {
+        meters = Create2DFrame(w, h, 1, DataType::kFp32, FrameType::kDepth);
+    }
+    FrameView<float> dst(meters);
+    DS3D_FAILED_RETURN(
+        dst && dst.width() == w && dst.height() == h, ErrCode::kParam, "meters frame must be CPU fp32 %ux%u", w, h);
+    FrameView<uint8_t> maskView;
+    if (mask) {
+        if (!*mask) {
+            *mask = Create2DFrame(w, h, 1, DataType::kUint8, FrameType::kCustom);
+        }
+        maskView = FrameView<uint8_t>(*mask);
+        DS3D_FAILED_RETURN(
+            maskView && maskView.width() == w && maskView.height() == h, ErrCode::kParam,
+            "mask frame must be CPU uint8 %ux%u", w, h);
+    }
+    auto convert = [&](size_t y0, size_t y1) {
+        for (size_t y = y0; y < y1; ++y) {
+            uint8_t* m = maskView ? maskView.rowPtr(y) : nullptr;
+            DepthToMeters(src.rowPtr(y), dst.rowPtr(y), m, w, scale, range);
+        }
+    };
+    ThreadPool::parallelFor(pool, h, kDepthTileRows, convert);
+    return ErrCode::kGood;
+}
+
+// fp32 meters back to a uint16 depth frame (see MetersToDepth), depth is created when empty
+inline ErrCode
+MetersFrameToDepth(const Frame2DGuard& meters, float scale, Frame2DGuard& depth, ThreadPool* pool = nullptr)
+{
+    FrameView<const float> src(meters);
+    DS3D_FAILED_RETURN(src, ErrCode::kParam, "meters frame must be CPU fp32");
+    DS3D_FAILED_RETURN(scale > 0.0f, ErrCode::kParam, "depth scale must be positive");
+    uint32_t w = src.width(), h = src.height();
+    if (!depth) {
+        depth = Create2DFrame(w, h, 1, DataType::kUint16, FrameType::kDepth);
+    }
+    FrameView<uint16_t> dst(depth);
+    DS3D_FAILED_RETURN(
+        dst && dst.width() == w && dst.height() == h, ErrCode::kParam, "depth frame must be CPU uint16 %ux%u", w, h);
+    auto convert = [&](size_t y0, size_t y1) {
+        for (size_t y = y0; y < y1; ++y) {
+            MetersToDepth(src.rowPtr(y), dst.rowPtr(y), w, scale);
+        }
+    };
+    ThreadPool::parallelFor(pool, h, kDepthTileRows, convert);
+    return ErrCode::kGood;
+}
+
+/**
+ * @brief unproject a uint16 depth frame into an organized point cloud, point
+ *   y * width + x is pixel (x, y). points (N x 3 fp32, FrameType::kPointXYZ)
+ *   and colorCoord (N x 2 fp32, FrameType::kPointCoordUV) are created when
+ *   empty, otherwise they must hold exactly N = width x height points.
+ *   colorCoord is filled only if proj is set. See UnprojectDepthRow.
+ */
+inline ErrCode
+DepthFrameToPoints(
+    const Frame2DGuard& depth, float scale, const DepthRayLut& lut, const ColorProjection* proj, FrameGuard& points,
+    FrameGuard* colorCoord, ThreadPool* pool = nullptr)
+{
+    FrameView<const uint16_t> src(depth);
+    DS3D_FAILED_RETURN(src, ErrCode::kParam, "depth frame must be CPU uint16");
+    uint32_t w = src.width(), h = src.height();
+    DS3D_FAILED_RETURN(
+        lut.rayX.size() == w && lut.rayY.size() == h, ErrCode::kParam, "depth intrinsics %ux%u do not match depth %ux%u",
+        lut.intrinsics.width, lut.intrinsics.height, w, h);
+    int32_t num = static_cast<int32_t>(w * h);
+    if (!points) {
+        points = CreateFrame(Shape{2, {num, 3}}, DataType::kFp32, FrameType::kPointXYZ);
+    }
+    FrameView<float, 3> xyz(points);
+    DS3D_FAILED_RETURN(xyz && xyz.width() == static_cast<uint32_t>(num), ErrCode::kParam, "points frame must be CPU fp32 %d x 3", num);
+    FrameView<float, 2> uv;
+    if (colorCoord && proj) {
+        if (!*colorCoord) {
+            *colorCoord = CreateFrame(Shape{2, {num, 2}}, DataType::kFp32, FrameType::kPointCoordUV);
+        }
+        uv = FrameView<float, 2>(*colorCoord);
+        DS3D_FAILED_RETURN(
+            uv && uv.width() == static_cast<uint32_t>(num), ErrCode::kParam, "color coord frame must be CPU fp32 %d x 2", num);
+    } else {
+        proj = nullptr;
+    }
+    auto unproject = [&](size_t y0, size_t y1) {
+        for (size_t y = y0; y < y1; ++y) {
+            size_t first = y * w;
+            UnprojectDepthRow(
+                src.rowPtr(y), w, scale, lut.rayX.data(), lut.rayY[y], xyz.rowPtr(0) + first * 3,
+                proj ? uv.rowPtr(0) + first * 2 : nullptr, proj);
+        }
+    };
+    ThreadPool::parallelFor(pool, h, kDepthTileRows, unproject);
+    return ErrCode::kGood;
+}
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_DEPTH_FRAME_HPP
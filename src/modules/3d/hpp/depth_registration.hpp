@@ -0,0 +1,180 @@
+#ifndef DS3D_COMMON_HPP_DEPTH_REGISTRATION_HPP
+#define DS3D_COMMON_HPP_DEPTH_REGISTRATION_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/depth_register.h"
+
+#include "frame.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @file depth/color registration of kDepthFrame and kColorFrame frames
+ */
+
+namespace ds3d {
+
+/**
+ * @brief DepthRegistration resamples color into the depth camera, or depth
+ *   into the color camera. The DepthRegistrationLut is rebuilt only when the
+ *   intrinsics or extrinsics change, a frame is then one projection and
+ *   gather pass. Not thread-safe, use one DepthRegistration per stream.
+ */
+class DepthRegistration {
+public:
+    DepthRegistration() = default;
+
+    // rebuild the table if the calibration changed, false if it is invalid
+    bool update(const IntrinsicsParam& depth, const IntrinsicsParam& color, const ExtrinsicsParam& d2c, bool toColor)
+    {
+        if (_lut.matches(depth, color, d2c, toColor)) {
+            return true;
+        }
+        ++_builds;
+        return BuildDepthRegistrationLut(depth, color, d2c, toColor, _lut);
+    }
+
+    // table builds so far, stays constant while the calibration does
+    uint32_t builds() const { return _builds; }
+
+    /**
+     * @brief color pixel of every depth pixel, nearest neighbor. aligned must
+     *   be a CPU frame of the depth size with the color pixel size, e.g. from a
+     *   Frame2DPool. Pixels without valid depth or outside the color image are
+     *   0. Needs update(..., toColor = false).
+     */
+    ErrCode colorToDepth(
+        const Frame2DGuard& depth, float scale, const Frame2DGuard& color, Frame2DGuard& aligned,
+        ThreadPool* pool = nullptr)
+    {
+        FrameView<const uint16_t> src(depth);
+        DS3D_FAILED_RETURN(src, ErrCode::kParam, "depth frame must be CPU uint16");
+        DS3D_FAILED_RETURN(_lut.cols && !_lut.corners, ErrCode::kParam, "registration table not built for color to depth");
+        uint32_t w = src.width(), h = src.height();
+        DS3D_FAILED_RETURN(
+            w == _lut.cols && h == _lut.rows, ErrCode::kParam, "depth intrinsics %ux%u do not match depth %ux%u",
+            _lut.cols, _lut.rows, w, h);
+        DS3D_FAILED_RETURN(
+            color && aligned && color->planes() == 1 && aligned->planes() == 1, ErrCode::kParam,
+            "registration needs single plane color frames");
+        const Frame2DPlane& cp = color->getPlane(0);
+        const Frame2DPlane& ap = aligned->getPlane(0);
+        DS3D_FAILED_RETURN(
+            cp.width == _lut.color.width && cp.height == _lut.color.height, ErrCode::kParam,
+            "color intrinsics %ux%u do not match color %ux%u", _lut.color.width, _lut.color.height, cp.width, cp.height);
+        DS3D_FAILED_RETURN(
+            ap.width == w && ap.height == h && ap.bytesPerPixel == cp.bytesPerPixel, ErrCode::kParam,
+            "aligned color frame must be %ux%u with %u bytes per pixel", w, h, cp.bytesPerPixel);
+        DS3D_FAILED_RETURN(
+            static_cast<size_t>(cp.pitchInBytes) * cp.height <= static_cast<size_t>(INT32_MAX), ErrCode::kOutOfRange,
+            "color frame too large to register");
+        DS3D_FAILED_RETURN(
+            cp.bytesPerPixel >= 1 && cp.bytesPerPixel <= 4, ErrCode::kUnsupported, "unsupported color bytes per pixel: %u",
+            cp.bytesPerPixel);
+        switch (cp.bytesPerPixel) {
+        case 1:
+            return gather<1>(src, scale, color, aligned, pool);
+        case 2:
+            return gather<2>(src, scale, color, aligned, pool);
+        case 3:
+            return gather<3>(src, scale, color, aligned, pool);
+        default:
+            return gather<4>(src, scale, color, aligned, pool);
+        }
+    }
+
+    /**
+     * @brief depth seen by the color camera. Every depth pixel fills the color
+     *   pixels its footprint covers, the nearest depth wins where footprints
+     *   overlap, color pixels no depth lands on are 0. aligned must be a CPU
+     *   uint16 frame of the color size. Needs update(..., toColor = true).
+     */
+    ErrCode depthToColor(const Frame2DGuard& depth, float scale, Frame2DGuard& aligned, ThreadPool* pool = nullptr)
+    {
+        FrameView<const uint16_t> src(depth);
+        DS3D_FAILED_RETURN(src, ErrCode::kParam, "depth frame must be CPU uint16");
+        DS3D_FAILED_RETURN(_lut.cols && _lut.corners, ErrCode::kParam, "registration table not built for depth to color");
+        uint32_t w = src.width(), h = src.height();
+        DS3D_FAILED_RETURN(
+            w + 1 == _lut.cols && h + 1 == _lut.rows, ErrCode::kParam, "depth intrinsics %ux%u do not match depth %ux%u",
+            _lut.depth.width, _lut.depth.height, w, h);
+        FrameView<uint16_t> dst(aligned);
+        DS3D_FAILED_RETURN(
+            dst && dst.width() == _lut.color.width && dst.height() == _lut.color.height, ErrCode::kParam,
+            "aligned depth frame must be CPU uint16 %ux%u", _lut.color.width, _lut.color.height);
+
+        // project in parallel, footprints of different rows overlap so the scatter runs on this thread
+        _rects.resize(static_cast<size_t>(w) * h);
+        auto project = [&](size_t y0, size_t y1) {
+            for (size_t y = y0; y < y1; ++y) {
+                size_t first = y * _lut.cols;
+                ProjectDepthRowRects(
+                    src.rowPtr(y), w, scale, _lut.a.data() + first, _lut.b.data() + first, _lut.c.data() + first, _lut,
+                    _rects.data() + y * w);
+            }
+        };
+        ThreadPool::parallelFor(pool, h, kDepthRegisterTileRows, project);
+        for (uint32_t y = 0; y < dst.height(); ++y) {
+            std::fill_n(dst.rowPtr(y), dst.width(), uint16_t(0));
+        }
+        for (uint32_t y = 0; y < h; ++y) {
+            const uint16_t* d = src.rowPtr(y);
+            const ColorRect* rects = _rects.data() + static_cast<size_t>(y) * w;
+            for (uint32_t x = 0; x < w; ++x) {
+                const ColorRect& r = rects[x];
+                for (int32_t v = r.y0; v <= r.y1; ++v) {
+                    uint16_t* row = dst.rowPtr(static_cast<uint32_t>(v));
+                    for (int32_t u = r.x0; u <= r.x1; ++u) {
+                        uint16_t old = row[u];
+                        row[u] = (old && old < d[x]) ? old : d[x];
+                    }
+                }
+            }
+        }
+        return ErrCode::kGood;
+    }
+
+private:
+    // rows per ThreadPool tile
+    static constexpr uint32_t kDepthRegisterTileRows = 16;
+
+    template <uint32_t Bpp>
+    ErrCode gather(
+        const FrameView<const uint16_t>& src, float scale, const Frame2DGuard& color, Frame2DGuard& aligned,
+        ThreadPool* pool)
+    {
+        FrameView<const uint8_t, Bpp> colorView(color);
+        FrameView<uint8_t, Bpp> dst(aligned);
+        DS3D_FAILED_RETURN(colorView && dst, ErrCode::kParam, "color frames must be CPU uint8");
+        const uint8_t* colorBase = colorView.rowPtr(0);
+        const uint32_t colorPitch = static_cast<uint32_t>(colorView.pitchInBytes());
+        const uint32_t w = src.width();
+        auto convert = [&](size_t y0, size_t y1) {
+            int32_t offsets[kGatherBlock];
+            for (size_t y = y0; y < y1; ++y) {
+                size_t first = y * _lut.cols;
+                const uint16_t* d = src.rowPtr(y);
+                uint8_t* out = dst.rowPtr(y);
+                for (uint32_t x = 0; x < w; x += kGatherBlock) {
+                    uint32_t n = std::min(kGatherBlock, w - x);
+                    RegisterDepthRow(
+                        d + x, n, scale, _lut.a.data() + first + x, _lut.b.data() + first + x, _lut.c.data() + first + x,
+                        _lut, colorPitch, Bpp, offsets);
+                    GatherColorRow<Bpp>(colorBase, offsets, n, out + x * Bpp);
+                }
+            }
+        };
+        ThreadPool::parallelFor(pool, src.height(), kDepthRegisterTileRows, convert);
+        return ErrCode::kGood;
+    }
+
+    // offsets computed ahead of the gather, on the stack and in L1
+    static constexpr uint32_t kGatherBlock = 256;
+
+    DepthRegistrationLut _lut;
+    std::vector<ColorRect> _rects;
+    uint32_t _builds = 0;
+};
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_DEPTH_REGISTRATION_HPP
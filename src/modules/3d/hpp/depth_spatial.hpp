@@ -0,0 +1,105 @@
+#ifndef DS3D_COMMON_HPP_DEPTH_SPATIAL_HPP
+#define DS3D_COMMON_HPP_DEPTH_SPATIAL_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/depth_spatial.h"
+
+#include "frame.hpp"
+#include "thread_pool.hpp"
+
+#include <vector>
+
+/**
+ * @file edge-preserving spatial smoothing of uint16 kDepthFrame frames
+ */
+
+namespace ds3d {
+
+/**
+ * @brief SpatialDepthSmoother runs the domain transform filter of
+ *   DepthSpatialParams on a float copy of the depth. Every pass walks its
+ *   steps with whole vectors of independent lanes: the vertical passes walk
+ *   rows over strips of kStripCols columns, the horizontal passes transpose
+ *   strips of kStripRows rows into their own tile of a transposed copy
+ *   first, so they walk its rows too instead of a dependent chain along each
+ *   image row.
+ *   An 848x480 frame takes about 0.9 ms on one core with 1 iteration, each
+ *   further iteration adds about 0.4 ms: the passes are bound by the memory
+ *   bandwidth of the float plane (1.6MB), not by the sweeps.
+ *   Not thread-safe, use one SpatialDepthSmoother per stream.
+ */
+class SpatialDepthSmoother {
+public:
+    explicit SpatialDepthSmoother(const DepthSpatialParams& params = DepthSpatialParams()) : _params(params) {}
+
+    const DepthSpatialParams& params() const { return _params; }
+
+    // out must be a CPU uint16 frame of the depth size, e.g. from a Frame2DPool, strips are processed on pool
+    ErrCode process(const Frame2DGuard& depth, Frame2DGuard& out, ThreadPool* pool = nullptr)
+    {
+        FrameView<const uint16_t> src(depth);
+        DS3D_FAILED_RETURN(src, ErrCode::kParam, "depth frame must be CPU uint16");
+        const uint32_t w = src.width(), h = src.height();
+        FrameView<uint16_t> dst(out);
+        DS3D_FAILED_RETURN(
+            dst && dst.width() == w && dst.height() == h, ErrCode::kParam, "output depth frame must be CPU uint16 %ux%u",
+            w, h);
+        const size_t strips = (h + kStripRows - 1) / kStripRows;
+        const size_t tileSize = static_cast<size_t>(w) * kStripRows;
+        // one tile per pool thread, the strips are split evenly between them
+        const size_t slots = pool ? std::min<size_t>(pool->size(), strips) : 1;
+        const size_t grain = (strips + slots - 1) / slots;
+        _plane.resize(static_cast<size_t>(w) * h);
+        _tiles.resize(slots * tileSize);
+        float* plane = _plane.data();
+        const float alpha = _params.alpha, delta = _params.delta;
+
+        ThreadPool::parallelFor(pool, h, kStripRows, [&](size_t y0, size_t y1) {
+            for (size_t y = y0; y < y1; ++y) {
+                DepthToMeters(src.rowPtr(y), plane + y * w, nullptr, w, 1.0f, DepthRange());
+            }
+        });
+        for (uint32_t it = 0; it < _params.iterations && w > 1; ++it) {
+            ThreadPool::parallelFor(pool, strips, grain, [&](size_t s0, size_t s1) {
+                float* tile = _tiles.data() + s0 / grain * tileSize;
+                for (size_t s = s0; s < s1; ++s) {
+                    size_t y0 = s * kStripRows, rows = std::min<size_t>(kStripRows, h - y0);
+                    // lanes past the last row are independent and never copied back
+                    TransposeFloats(plane + y0 * w, w, rows, w, tile, kStripRows);
+                    const ptrdiff_t stride = kStripRows;
+                    DomainTransformSweep(tile, w, stride, kStripRows, alpha, delta);
+                    DomainTransformSweep(tile + (w - 1) * stride, w, -stride, kStripRows, alpha, delta);
+                    TransposeFloats(tile, kStripRows, w, rows, plane + y0 * w, w);
+                }
+            });
+            ThreadPool::parallelFor(pool, (w + kStripCols - 1) / kStripCols, 1, [&](size_t s0, size_t s1) {
+                for (size_t s = s0; s < s1; ++s) {
+                    size_t x0 = s * kStripCols, lanes = std::min<size_t>(kStripCols, w - x0);
+                    const ptrdiff_t stride = w;
+                    DomainTransformSweep(plane + x0, h, stride, lanes, alpha, delta);
+                    DomainTransformSweep(plane + (h - 1) * stride + x0, h, -stride, lanes, alpha, delta);
+                }
+            });
+        }
+        ThreadPool::parallelFor(pool, h, kStripRows, [&](size_t y0, size_t y1) {
+            for (size_t y = y0; y < y1; ++y) {
+                MetersToDepth(plane + y * w, dst.rowPtr(y), w, 1.0f);
+            }
+        });
+        return ErrCode::kGood;
+    }
+
+private:
+    // 64 rows: 4 independent AVX-512 (8 AVX2) vectors per step, a 848 pixel tile (217KB) stays in L2
+    static constexpr uint32_t kStripRows = 64;
+    // 64 columns x 480 rows (120KB) stay in L2 between the down and up sweeps
+    static constexpr uint32_t kStripCols = 64;
+
+    DepthSpatialParams _params;
+    std::vector<float> _plane;
+    std::vector<float> _tiles;
+};
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_DEPTH_SPATIAL_HPP
@@ -0,0 +1,75 @@
+#ifndef DS3D_COMMON_HPP_DEPTH_TEMPORAL_HPP
+#define DS3D_COMMON_HPP_DEPTH_TEMPORAL_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/depth_temporal.h"
+
+#include "frame.hpp"
+#include "thread_pool.hpp"
+
+#include <vector>
+
+/**
+ * @file temporal smoothing and hole filling of uint16 kDepthFrame streams
+ */
+
+namespace ds3d {
+
+/**
+ * @brief TemporalDepthSmoother keeps the per-pixel history of one depth
+ *   stream and applies TemporalDepthRow frame after frame. The history is
+ *   reset when the resolution changes or on reset().
+ *   Not thread-safe, use one TemporalDepthSmoother per stream.
+ */
+class TemporalDepthSmoother {
+public:
+    explicit TemporalDepthSmoother(const DepthTemporalParams& params = DepthTemporalParams()) : _params(params) {}
+
+    const DepthTemporalParams& params() const { return _params; }
+
+    void reset()
+    {
+        std::fill(_last.begin(), _last.end(), uint16_t(0));
+        std::fill(_hist.begin(), _hist.end(), uint8_t(0));
+    }
+
+    // out must be a CPU uint16 frame of the depth size, e.g. from a Frame2DPool, rows are processed in tiles on pool
+    ErrCode process(const Frame2DGuard& depth, Frame2DGuard& out, ThreadPool* pool = nullptr)
+    {
+        FrameView<const uint16_t> src(depth);
+        DS3D_FAILED_RETURN(src, ErrCode::kParam, "depth frame must be CPU uint16");
+        uint32_t w = src.width(), h = src.height();
+        FrameView<uint16_t> dst(out);
+        DS3D_FAILED_RETURN(
+            dst && dst.width() == w && dst.height() == h, ErrCode::kParam, "output depth frame must be CPU uint16 %ux%u",
+            w, h);
+        if (w != _width || h != _height) {
+            _width = w;
+            _height = h;
+            _last.assign(static_cast<size_t>(w) * h, 0);
+            _hist.assign(static_cast<size_t>(w) * h, 0);
+        }
+        auto smooth = [&](size_t y0, size_t y1) {
+            for (size_t y = y0; y < y1; ++y) {
+                size_t first = y * w;
+                TemporalDepthRow(src.rowPtr(y), dst.rowPtr(y), _last.data() + first, _hist.data() + first, w, _params);
+            }
+        };
+        ThreadPool::parallelFor(pool, h, kTemporalTileRows, smooth);
+        return ErrCode::kGood;
+    }
+
+private:
+    // rows per ThreadPool tile, 16 rows of 848 pixels keep depth, history and output in L1/L2
+    static constexpr uint32_t kTemporalTileRows = 16;
+
+    DepthTemporalParams _params;
+    std::vector<uint16_t> _last;
+    std::vector<uint8_t> _hist;
+    uint32_t _width = 0;
+    uint32_t _height = 0;
+};
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_DEPTH_TEMPORAL_HPP
@@ -0,0 +1,422 @@
+#ifndef DS3D_COMMON_HPP_FLAT_DATAMAP_HPP
+#define DS3D_COMMON_HPP_FLAT_DATAMAP_HPP
+
+#include "3d/common/abi_obj.h"
+#include "3d/common/common.h"
+#include "3d/common/func_utils.h"
+
+#include "datamap.hpp"
+#include "obj.hpp"
+
+#include <deque>
+#include <vector>
+
+/**
+ * @file FlatDataMap is an open-addressing abiDataMapV2 implementation backed by an interned key table
+ */
+
+namespace ds3d {
+
+/**
+ * @brief Process-wide table of interned key names. Every distinct name is copied
+ *   once and never freed, so the returned pointer stays valid for any datamap
+ *   regardless of the lifetime of the caller's string (e.g. a custom lib which
+ *   gets unloaded). Lookups of names which are already interned are lock-free.
+ */
+class KeyTable {
+public:
+    static const char* intern(const DataKey& key)
+    {
+        DS_ASSERT(key.name);
+        KeyTable& table = instance();
+        uint32_t idx = static_cast<uint32_t>(key.hash) & kMask;
+        for (uint32_t i = 0; i < kCapacity; ++i, idx = (idx + 1) & kMask) {
+            const char* name = table._names[idx].load(std::memory_order_acquire);
+            if (!name) {
+                return table.insert(key, idx);
+            }
+            if (table._hashes[idx] == key.hash && !strcmp(name, key.name)) {
+                return name;
+            }
+        }
+        return table.insertOverflow(key);
+    }
+
+private:
+    static constexpr uint32_t kCapacity = 4096;
+    static constexpr uint32_t kMask = kCapacity - 1;
+
+    KeyTable() = default;
+    static KeyTable& instance()
+    {
+        static KeyTable table;
+        return table;
+    }
+
+    const char* insert(const DataKey& key, uint32_t idx)
+    {
+        std::unique_lock<std::mutex> locker(_mutex);
+        // another thread might have taken the slot before the lock
+        for (uint32_t i = 0; i < kCapacity; ++i, idx = (idx + 1) & kMask) {
+            const char* name = _names[idx].load(std::memory_order_relaxed);
+            if (!name) {
+                _storage.emplace_back(key.name);
+                _hashes[idx] = key.hash;
+                _names[idx].store(_storage.back().c_str(), std::memory_order_release);
+                return _storage.back().c_str();
+            }
+            if (_hashes[idx] == key.hash && !strcmp(name, key.name)) {
+                return name;
+            }
+        }
+        locker.unlock();
+        return insertOverflow(key);
+    }
+
+    const char* insertOverflow(const DataKey& key)
+    {
+        std::unique_lock<std::mutex> locker(_mutex);
+        for (const auto& name : _overflow) {
+            if (name == key.name) {
+                return name.c_str();
+            }
+        }
+        LOG_WARNING("interned key table is full, key: %s goes to the overflow list", key.name);
+        _overflow.emplace_back(key.name);
+        return _overflow.back().c_str();
+    }
+
+    std::atomic<const char*> _names[kCapacity] = {};
+    uint64_t _hashes[kCapacity] = {0};
+    std::mutex _mutex;
+    // deque never relocates its elements, so the c_str() pointers stay valid
+    std::deque<std::string> _storage;
+    std::deque<std::string> _overflow;
+    DS3D_DISABLE_CLASS_COPY(KeyTable);
+};
+
+/**
+ * @brief FlatDataMap keeps all entries in a single power-of-two array of slots
+ *   with linear probing. A lookup through a typed Key<T> (e.g. kDepthFrame) is
+ *   one hash probe plus a name compare, with no allocation and no string
+ *   hashing. The string-keyed abiDataMap interface is served by hashing the
+ *   name at runtime, so existing custom libs keep working.
+ *   Trivially copyable values up to kInlineValueBytes (DepthScale, IntrinsicsParam,
+ *   ExtrinsicsParam, TimeStamp...) set through setValueKey_i are copied into a
+ *   block pool owned by the map, so they cost no heap allocation per key.
+ *   Same as the default datamap, it is not thread-safe for concurrent writers.
+ *   Once the producer is done it can freeze_i() the map: later writes fail
+ *   with ErrCode::kState and lookups from any thread are wait-free, they only
+ *   read the slot array (see MakeWritableDataMap for late writers).
+ *   In the nvds3dfilter pipeline the frame datamaps come from DeepStream
+ *   (NvDs3D_Find1stDataMap) and are legacy abiDataMap, a FlatDataMap there
+ *   only holds the keys the filters add, as the local layer of OverlayDataMap.
+ *   The inline values cover those keys, not the source ones, and freeze_i()
+ *   fails over them (see OverlayDataMap::freeze_i).
+ *
+ *   For example:
+ *     GuardDataMap datamap = CreateFlatDataMap();
+ *     datamap.setData(kDepthScaleUnit, DepthScale{0.001});
+ *     DepthScale scale;
+ *     datamap.getData(kDepthScaleUnit, scale);
+ */
+class FlatDataMap : public abiDataMapV2 {
+public:
+    static constexpr uint32_t kDefaultCapacity = 32;
+    static constexpr uint32_t kInlineValueBytes = 64;
+    static constexpr uint32_t kInlineValueCount = 16;
+
+    explicit FlatDataMap(uint32_t capacity = kDefaultCapacity) : _values(new InlineValue[kInlineValueCount])
+    {
+        uint32_t cap = kDefaultCapacity;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        _slots.resize(cap);
+    }
+    ~FlatDataMap() override { clearSlots(); }
+
+    // abiDataMap string-keyed interface
+    ErrCode setBuf_i(const char* key, TIdType tid, abiRefAny* data) override
+    {
+        DS3D_FAILED_RETURN(key, ErrCode::kParam, "datamap key must not be null");
+        return setBufKey_i(DataKey(key), tid, data);
+    }
+    ErrCode getBuf_i(const char* key, TIdType tid, const abiRefAny*& data) const override
+    {
+        DS3D_FAILED_RETURN(key, ErrCode::kParam, "datamap key must not be null");
+        return getBufKey_i(DataKey(key), tid, data);
+    }
+    ErrCode removeBuf_i(const char* key) override
+    {
+        DS3D_FAILED_RETURN(key, ErrCode::kParam, "datamap key must not be null");
+        return removeBufKey_i(DataKey(key));
+    }
+    bool has_i(const char* key) const override { return key && hasKey_i(DataKey(key)); }
+
+    ErrCode clear_i() override
+    {
+        DS3D_FAILED_RETURN(!frozen_i(), ErrCode::kState, "datamap is frozen, clear failed");
+        clearSlots();
+        return ErrCode::kGood;
+    }
+
+    // abiDataMapV2 hashed-key interface
+    ErrCode setBufKey_i(const DataKey& key, TIdType tid, abiRefAny* data) override
+    {
+        DS3D_FAILED_RETURN(key.name && data, ErrCode::kParam, "datamap setBuf with null key or data");
+        DS3D_FAILED_RETURN(!frozen_i(), ErrCode::kState, "datamap is frozen, set key: %s failed", key.name);
+        insert(key, tid, data);
+        return ErrCode::kGood;
+    }
+
+    ErrCode setValueKey_i(const DataKey& key, TIdType tid, const void* value, uint32_t bytes) override
+    {
+        DS3D_FAILED_RETURN(key.name && value, ErrCode::kParam, "datamap setValue with null key or value");
+        DS3D_FAILED_RETURN(!frozen_i(), ErrCode::kState, "datamap is frozen, set key: %s failed", key.name);
+        if (bytes > kInlineValueBytes) {
+            return ErrCode::kUnsupported;
+        }
+        uint32_t idx = 0;
+        if (find(key, idx) && isInline(_slots[idx].data)) {
+            // overwrite the existing block in place
+            static_cast<InlineValue*>(_slots[idx].data)->assign(value, bytes);
+            _slots[idx].tid = tid;
+            return ErrCode::kGood;
+        }
+        InlineValue* block = freeValue();
+        if (!block) {
+            return ErrCode::kUnsupported;
+        }
+        block->assign(value, bytes);
+        insert(key, tid, block);
+        return ErrCode::kGood;
+    }
+
+    ErrCode getBufKey_i(const DataKey& key, TIdType tid, const abiRefAny*& data) const override
+    {
+        uint32_t idx = 0;
+        if (!find(key, idx)) {
+            return ErrCode::kNotFound;
+        }
+        const Slot& slot = _slots[idx];
+        if (slot.tid != tid) {
+            LOG_DEBUG("datamap key: %s typeid: 0x%" PRIx64 " mismatch with 0x%" PRIx64, key.name, slot.tid, tid);
+            return ErrCode::kTypeId;
+        }
+        data = slot.data;
+        return ErrCode::kGood;
+    }
+
+    ErrCode removeBufKey_i(const DataKey& key) override
+    {
+        DS3D_FAILED_RETURN(!frozen_i(), ErrCode::kState, "datamap is frozen, remove key: %s failed", key.name);
+        uint32_t idx = 0;
+        if (!find(key, idx)) {
+            return ErrCode::kNotFound;
+        }
+        if (_slots[idx].data) {
+            _slots[idx].data->destroy();
+        }
+        erase(idx);
+        return ErrCode::kGood;
+    }
+
+    bool hasKey_i(const DataKey& key) const override
+    {
+        uint32_t idx = 0;
+        return find(key, idx);
+    }
+
+    ErrCode getBufKeys_i(DataKeyQuery* queries, uint32_t num) const override
+    {
+        DS3D_FAILED_RETURN(queries || !num, ErrCode::kParam, "datamap getBufKeys with null queries");
+        for (uint32_t i = 0; i < num; ++i) {
+            DataKeyQuery& q = queries[i];
+            q.data = nullptr;
+            q.code = getBufKey_i(*q.key, q.tid, q.data);
+        }
+        return ErrCode::kGood;
+    }
+
+    ErrCode freeze_i() override
+    {
+        _frozen.store(true, std::memory_order_release);
+        return ErrCode::kGood;
+    }
+    bool frozen_i() const override { return _frozen.load(std::memory_order_acquire); }
+
+    ErrCode enumerate_i(abiEnumEntryCB* cb) const override
+    {
+        DS3D_FAILED_RETURN(cb, ErrCode::kParam, "datamap enumerate with null callback");
+        for (const Slot& slot : _slots) {
+            if (!slot.name) {
+                continue;
+            }
+            DataMapEntry entry{slot.name, slot.tid, slot.data};
+            cb->notify(&entry);
+        }
+        return ErrCode::kGood;
+    }
+
+    uint32_t size() const { return _size; }
+    uint32_t capacity() const { return static_cast<uint32_t>(_slots.size()); }
+
+private:
+    // inline storage of a small trivially copyable value. The map owns the
+    // block, destroy() only hands it back to the pool. A refCopy detaches a
+    // heap copy so the holder does not depend on the slot being kept.
+    class InlineValue : public abiRefAny {
+    public:
+        void* data() const final { return const_cast<uint8_t*>(_buf); }
+        void destroy() final { _bytes = 0; }
+        abiRefObj* refCopy_i() const final
+        {
+            void* copy = malloc(_bytes);
+            DS_ASSERT(copy);
+            memcpy(copy, _buf, _bytes);
+            return new IntrusiveRefObj<void>(copy, [](void* p) { free(p); });
+        }
+        bool inUse() const { return _bytes; }
+        void assign(const void* value, uint32_t bytes)
+        {
+            DS_ASSERT(bytes && bytes <= kInlineValueBytes);
+            memcpy(_buf, value, bytes);
+            _bytes = bytes;
+        }
+
+    private:
+        alignas(16) uint8_t _buf[kInlineValueBytes];
+        uint32_t _bytes = 0;
+    };
+
+    struct Slot {
+        uint64_t hash = 0;
+        const char* name = nullptr;  // interned, nullptr for empty slots
+        TIdType tid = 0;
+        abiRefAny* data = nullptr;
+    };
+
+    uint32_t mask() const { return static_cast<uint32_t>(_slots.size()) - 1; }
+
+    void clearSlots()
+    {
+        for (auto& slot : _slots) {
+            if (slot.name && slot.data) {
+                slot.data->destroy();
+            }
+            slot = Slot();
+        }
+        _size = 0;
+    }
+
+    bool isInline(const abiRefAny* data) const
+    {
+        // compare addresses, downcasting a value held elsewhere is undefined
+        const uintptr_t p = reinterpret_cast<uintptr_t>(data);
+        const uintptr_t first = reinterpret_cast<uintptr_t>(static_cast<const abiRefAny*>(&_values[0]));
+        const uintptr_t last = reinterpret_cast<uintptr_t>(static_cast<const abiRefAny*>(&_values[kInlineValueCount - 1]));
+        return data && p >= first && p <= last;
+    }
+
+    InlineValue* freeValue()
+    {
+        for (uint32_t i = 0; i < kInlineValueCount; ++i) {
+            if (!_values[i].inUse()) {
+                return &_values[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // replace the data of an existing key or take a new slot, owns data
+    void insert(const DataKey& key, TIdType tid, abiRefAny* data)
+    {
+        uint32_t idx = 0;
+        if (find(key, idx)) {
+            Slot& slot = _slots[idx];
+            if (slot.data) {
+                slot.data->destroy();
+            }
+            slot.tid = tid;
+            slot.data = data;
+            return;
+        }
+        if ((_size + 1) * 4 > _slots.size() * 3) {
+            grow();
+            find(key, idx);
+        }
+        _slots[idx] = Slot{key.hash, KeyTable::intern(key), tid, data};
+        ++_size;
+    }
+
+    // returns true if found. Otherwise idx is the empty slot the key would take.
+    bool find(const DataKey& key, uint32_t& idx) const
+    {
+        const uint32_t m = mask();
+        for (idx = static_cast<uint32_t>(key.hash) & m;; idx = (idx + 1) & m) {
+            const Slot& slot = _slots[idx];
+            if (!slot.name) {
+                return false;
+            }
+            if (slot.hash == key.hash && (slot.name == key.name || !strcmp(slot.name, key.name))) {
+                return true;
+            }
+        }
+    }
+
+    // backward-shift deletion keeps probe chains intact without tombstones
+    void erase(uint32_t hole)
+    {
+        const uint32_t m = mask();
+        for (uint32_t j = (hole + 1) & m; _slots[j].name; j = (j + 1) & m) {
+            uint32_t home = static_cast<uint32_t>(_slots[j].hash) & m;
+            bool movable = (j > hole) ? (home <= hole || home > j) : (home <= hole && home > j);
+            if (movable) {
+                _slots[hole] = _slots[j];
+                hole = j;
+            }
+        }
+        _slots[hole] = Slot();
+        --_size;
+    }
+
+    void grow()
+    {
+        std::vector<Slot> old(_slots.size() * 2);
+        old.swap(_slots);
+        const uint32_t m = mask();
+        for (const Slot& slot : old) {
+            if (!slot.name) {
+                continue;
+            }
+            uint32_t idx = static_cast<uint32_t>(slot.hash) & m;
+            while (_slots[idx].name) {
+                idx = (idx + 1) & m;
+            }
+            _slots[idx] = slot;
+        }
+    }
+
+    std::unique_ptr<InlineValue[]> _values;
+    std::vector<Slot> _slots;
+    uint32_t _size = 0;
+    std::atomic<bool> _frozen{false};
+};
+
+// create a new datamap reference backed by FlatDataMap
+inline abiRefDataMap*
+NewFlatDataMap(uint32_t capacity = FlatDataMap::kDefaultCapacity)
+{
+    return NewAbiRef<abiDataMap>(new FlatDataMap(capacity));
+}
+
+inline GuardDataMap
+CreateFlatDataMap(uint32_t capacity = FlatDataMap::kDefaultCapacity)
+{
+    return GuardDataMap(NewFlatDataMap(capacity), true);
+}
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_FLAT_DATAMAP_HPP
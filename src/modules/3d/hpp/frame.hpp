@@ -5,6 +5,8 @@
 #include "3d/common/func_utils.h"
 #include "obj.hpp"
 
+#include <span>
+
 /**
  * @file sets the frame gaurd for accessing the gstreamer elements frame data (appsrc, nvds3dfilter, appsink)
  */
@@ -13,36 +15,372 @@ namespace ds3d {
 
 
 using FrameGuard = GuardDataT<abiFrame>;
+// abi2DFrame Guard
+using Frame2DGuard = GuardDataT<abi2DFrame>;
 
-#if 0
-// abiFrame Guard
-class FrameGuard : public GuardDataT<abiFrame>
+/**
+ * @brief FrameView<T, Channels> is a typed, non-owning view of a CPU frame.
+ *   DataType, channel count and memory type are checked once at construction,
+ *   then rows are plain std::span<T> that respect pitchInBytes, so inner loops
+ *   over a row are simple enough for the compiler to auto-vectorize.
+ *   2D frames are viewed through one plane; other frames (e.g. N x 3 points)
+ *   are a single row of ShapeSize / Channels pixels. The frame must outlive
+ *   the view. Use a const T for read-only views.
+ *
+ *   For example:
+ *     FrameView<const uint16_t> depth(depthGuard);
+ *     FrameView<float, 3> points(pointGuard);
+ *     if (!depth || !points) { return ErrCode::kParam; }
+ *     for (uint32_t y = 0; y < depth.height(); ++y) {
+ *         std::span<const uint16_t> row = depth.row(y);
+ *         for (size_t x = 0; x < row.size(); ++x) { ... row[x] ... }
+ *     }
+ */
+template <typename T, uint32_t Channels = 1>
+class FrameView
 {
-    using _Base = GuardDataT<abiFrame>;
+    using ElemT = std::remove_const_t<T>;
+    static_assert(Channels > 0, "FrameView needs at least 1 channel");
 
     public:
-        FrameGuard() = default;
-        template <typename... Args>
-        FrameGuard(Args&&... args) : _Base(std::forward<Args>(args)...)
+        static constexpr uint32_t kChannels = Channels;
+
+        FrameView() = default;
+        explicit FrameView(const abiFrame* frame) { init(frame); }
+        explicit FrameView(const abi2DFrame* frame, uint32_t planeIdx = 0) { init(frame, planeIdx); }
+        explicit FrameView(const FrameGuard& frame) : FrameView(frame.ptr()) {}
+        explicit FrameView(const Frame2DGuard& frame, uint32_t planeIdx = 0) : FrameView(frame.ptr(), planeIdx) {}
+        // view of an external buffer, e.g. a scratch tile
+        FrameView(T* base, uint32_t width, uint32_t height, size_t pitchInBytes)
+            : _base(reinterpret_cast<uint8_t*>(const_cast<ElemT*>(base))), _width(width), _height(height),
+              _pitch(pitchInBytes), _status(ErrCode::kGood)
+        {
+            DS_ASSERT(pitchInBytes >= rowBytes());
+        }
+
+        // kGood if the frame matched T/Channels, otherwise the failure reason
+        ErrCode status() const { return _status; }
+        explicit operator bool() const { return isGood(_status); }
+
+        uint32_t width() const { return _width; }  // pixels per row
+        uint32_t height() const { return _height; }
+        size_t pitchInBytes() const { return _pitch; }
+        size_t rowBytes() const { return static_cast<size_t>(_width) * Channels * sizeof(T); }
+        // rows have no padding, the whole frame is one span
+        bool contiguous() const { return _pitch == rowBytes() || _height <= 1; }
+
+        T* rowPtr(uint32_t y) const
+        {
+            DS_ASSERT(y < _height);
+            return reinterpret_cast<T*>(_base + _pitch * y);
+        }
+        // width * Channels elements of row y, interleaved channels
+        std::span<T> row(uint32_t y) const { return std::span<T>(rowPtr(y), static_cast<size_t>(_width) * Channels); }
+        // all elements when contiguous(), an empty span otherwise
+        std::span<T> elements() const
+        {
+            if (!contiguous() || !_base) {
+                return std::span<T>();
+            }
+            return std::span<T>(reinterpret_cast<T*>(_base), static_cast<size_t>(_width) * _height * Channels);
+        }
+        T& at(uint32_t x, uint32_t y, uint32_t c = 0) const
+        {
+            DS_ASSERT(x < _width && c < Channels);
+            return rowPtr(y)[static_cast<size_t>(x) * Channels + c];
+        }
+
+    private:
+        bool checkFrame(const abiFrame* frame)
         {
+            DS3D_FAILED_RETURN(frame, (_status = ErrCode::kNullPtr, false), "FrameView of a null frame");
+            DS3D_FAILED_RETURN(
+                frame->dataType() == TpId<ElemT>::_data_type_value(), (_status = ErrCode::kTypeId, false),
+                "FrameView datatype: %d mismatch with frame datatype: %d",
+                static_cast<int>(TpId<ElemT>::_data_type_value()), static_cast<int>(frame->dataType()));
+            DS3D_FAILED_RETURN(
+                frame->memType() == MemType::kCpu || frame->memType() == MemType::kCpuPinned,
+                (_status = ErrCode::kUnsupported, false), "FrameView only supports CPU frames");
+            return true;
         }
 
-        template <class EleT>
-        EleT& at(size_t idx)
+        void init(const abiFrame* frame)
         {
-            abiFrame* f = this->ptr();
-            DS_ASSERT(this->ptr());
-            DS3D_THROW_ERROR(idx < ShapeSize(f->shape()), ErrCode::kOutOfRange, "idx out of range");
-            uint32_t eleSize = dataTypeBytes(f->dataType());
-            DS_ASSERT(sizeof(EleT) < eleSize);
-            return *static_cast<EleT*>((uint8_t*)f->base() + eleSize * idx);
+            if (!checkFrame(frame)) {
+                return;
+            }
+            const Shape& shape = frame->shape();
+            size_t num = ShapeSize(shape);
+            DS3D_FAILED_RETURN(
+                num % Channels == 0 && (shape.numDims < 2 || Channels == 1 ||
+                                        shape.d[shape.numDims - 1] == static_cast<int32_t>(Channels)),
+                (void)(_status = ErrCode::kParam), "FrameView channels: %u mismatch with frame shape", Channels);
+            DS3D_FAILED_RETURN(
+                num * sizeof(T) <= frame->bytes(), (void)(_status = ErrCode::kOutOfRange),
+                "frame bytes: %zu smaller than its shape", frame->bytes());
+            _base = static_cast<uint8_t*>(frame->base());
+            _width = static_cast<uint32_t>(num / Channels);
+            _height = num ? 1 : 0;
+            _pitch = rowBytes();
+            _status = ErrCode::kGood;
         }
+
+        void init(const abi2DFrame* frame, uint32_t planeIdx)
+        {
+            if (!checkFrame(frame)) {
+                return;
+            }
+            DS3D_FAILED_RETURN(
+                planeIdx < frame->planes(), (void)(_status = ErrCode::kOutOfRange), "plane idx: %u out of range",
+                planeIdx);
+            const Frame2DPlane& plane = frame->getPlane(planeIdx);
+            DS3D_FAILED_RETURN(
+                plane.bytesPerPixel == sizeof(T) * Channels, (void)(_status = ErrCode::kParam),
+                "FrameView pixel size: %zu mismatch with plane bytesPerPixel: %u", sizeof(T) * Channels,
+                plane.bytesPerPixel);
+            // the last row ends at its pixels, not at the pitch, e.g. an ROI touching
+            // the bottom-right corner of its parent frame
+            size_t end = plane.height ? plane.offset + static_cast<size_t>(plane.pitchInBytes) * (plane.height - 1) +
+                                            static_cast<size_t>(plane.width) * plane.bytesPerPixel
+                                      : plane.offset;
+            DS3D_FAILED_RETURN(
+                end <= frame->bytes(), (void)(_status = ErrCode::kOutOfRange), "plane exceeds frame bytes: %zu",
+                frame->bytes());
+            _base = static_cast<uint8_t*>(frame->base()) + plane.offset;
+            _width = plane.width;
+            _height = plane.height;
+            _pitch = plane.pitchInBytes;
+            _status = ErrCode::kGood;
+        }
+
+        uint8_t* _base = nullptr;
+        uint32_t _width = 0;
+        uint32_t _height = 0;
+        size_t _pitch = 0;
+        ErrCode _status = ErrCode::kNullPtr;
 };
-#endif
 
-// abi2DFrame Guard
-using Frame2DGuard = GuardDataT<abi2DFrame>;
+/**
+ * @brief CPU/GPU frame implementation on top of an existing buffer. The
+ *   buffer is released by deleter (if any) when the frame is destroyed.
+ */
+template <class abiFrameT, _EnableIfBaseOf<abiFrame, abiFrameT> = true>
+class FrameBaseImpl : public abiFrameT
+{
+    public:
+        using DeleterF = std::function<void(void*)>;
+        FrameBaseImpl(
+            void* data, size_t bytes, const Shape& shape, DataType dataType, FrameType frameType,
+            MemType memType = MemType::kCpu, int64_t devId = 0, DeleterF deleter = nullptr)
+            : _data(data), _bytes(bytes), _shape(shape), _dataType(dataType), _frameType(frameType),
+              _memType(memType), _devId(devId), _deleter(std::move(deleter))
+        {
+        }
+        ~FrameBaseImpl() override
+        {
+            if (_deleter && _data) {
+                _deleter(_data);
+            }
+        }
+
+        DataType dataType() const final { return _dataType; }
+        FrameType frameType() const final { return _frameType; }
+        MemType memType() const final { return _memType; }
+        int64_t devId() const final { return _devId; }
+        size_t bytes() const final { return _bytes; }
+        const Shape& shape() const final { return _shape; }
+        void* base() const final { return _data; }
+
+    private:
+        void* _data = nullptr;
+        size_t _bytes = 0;
+        Shape _shape;
+        DataType _dataType;
+        FrameType _frameType;
+        MemType _memType;
+        int64_t _devId;
+        DeleterF _deleter;
+};
+
+using FrameImpl = FrameBaseImpl<abiFrame>;
+
+// single plane layout of a {height, width[, channels]} shape. Rows are padded
+// to a multiple of pitchAlign bytes, 1 keeps them tightly packed.
+inline Frame2DPlane
+Frame2DPlaneFromShape(const Shape& shape, DataType dataType, uint32_t pitchAlign = 1)
+{
+    DS_ASSERT(shape.numDims >= 2 && pitchAlign);
+    uint32_t channels = shape.numDims > 2 ? static_cast<uint32_t>(shape.d[2]) : 1;
+    Frame2DPlane plane{};
+    plane.height = static_cast<uint32_t>(shape.d[0]);
+    plane.width = static_cast<uint32_t>(shape.d[1]);
+    plane.bytesPerPixel = dataTypeBytes(dataType) * channels;
+    uint32_t rowBytes = plane.width * plane.bytesPerPixel;
+    plane.pitchInBytes = (rowBytes + pitchAlign - 1) / pitchAlign * pitchAlign;
+    plane.offset = 0;
+    return plane;
+}
+
+class Frame2DImpl : public FrameBaseImpl<abi2DFrame>
+{
+    public:
+        static constexpr uint32_t kMaxPlanes = 4;
+
+        // single plane frame, the plane is derived from shape
+        Frame2DImpl(
+            void* data, size_t bytes, const Shape& shape, DataType dataType, FrameType frameType,
+            MemType memType = MemType::kCpu, int64_t devId = 0, DeleterF deleter = nullptr)
+            : FrameBaseImpl<abi2DFrame>(
+                  data, bytes, shape, dataType, frameType, memType, devId, std::move(deleter))
+        {
+            _planes[0] = Frame2DPlaneFromShape(shape, dataType);
+            _numPlanes = 1;
+        }
+        Frame2DImpl(
+            void* data, size_t bytes, const Shape& shape, DataType dataType, FrameType frameType,
+            const Frame2DPlane* planes, uint32_t numPlanes, MemType memType = MemType::kCpu,
+            int64_t devId = 0, DeleterF deleter = nullptr)
+            : FrameBaseImpl<abi2DFrame>(
+                  data, bytes, shape, dataType, frameType, memType, devId, std::move(deleter))
+        {
+            DS_ASSERT(planes && numPlanes && numPlanes <= kMaxPlanes);
+            _numPlanes = std::min(numPlanes, kMaxPlanes);
+            std::copy(planes, planes + _numPlanes, _planes);
+        }
+
+        uint32_t planes() const final { return _numPlanes; }
+        const Frame2DPlane& getPlane(uint32_t idx) const final
+        {
+            DS3D_THROW_ERROR(idx < _numPlanes, ErrCode::kOutOfRange, "plane idx out of range");
+            return _planes[idx];
+        }
+
+    private:
+        Frame2DPlane _planes[kMaxPlanes] = {};
+        uint32_t _numPlanes = 0;
+};
+
+// wrap an existing buffer into a frame guard, deleter releases data with the last ref
+inline FrameGuard
+WrapFrame(
+    void* data, size_t bytes, const Shape& shape, DataType dataType, FrameType frameType,
+    MemType memType = MemType::kCpu, int64_t devId = 0, FrameImpl::DeleterF deleter = nullptr)
+{
+    return FrameGuard(
+        NewAbiRef<abiFrame>(
+            new FrameImpl(data, bytes, shape, dataType, frameType, memType, devId, std::move(deleter))),
+        true);
+}
+
+inline Frame2DGuard
+Wrap2DFrame(
+    void* data, size_t bytes, const Shape& shape, DataType dataType, FrameType frameType,
+    MemType memType = MemType::kCpu, int64_t devId = 0, Frame2DImpl::DeleterF deleter = nullptr)
+{
+    return Frame2DGuard(
+        NewAbiRef<abi2DFrame>(
+            new Frame2DImpl(data, bytes, shape, dataType, frameType, memType, devId, std::move(deleter))),
+        true);
+}
+
+/**
+ * @brief allocate a CPU 2D frame of shape {height, width, channels} with a
+ *   kFrameAlignment (64B) aligned base and every row padded to a multiple of
+ *   pitchAlign bytes, so row starts stay aligned for vector loads. Use
+ *   simdPitch() to pick the tightest alignment a kernel needs, or 1 for
+ *   tightly packed rows. Kernels must walk rows by getPlane(0).pitchInBytes.
+ *   e.g. Create2DFrame(848, 480, 1, DataType::kUint16, FrameType::kDepth)
+ *        -> pitch 1728 (848 * 2 padded to 64)
+ */
+inline Frame2DGuard
+Create2DFrame(
+    uint32_t width, uint32_t height, uint32_t channels, DataType dataType, FrameType frameType,
+    uint32_t pitchAlign = kFrameAlignment)
+{
+    Shape shape{3, {static_cast<int32_t>(height), static_cast<int32_t>(width), static_cast<int32_t>(channels)}};
+    Frame2DPlane plane = Frame2DPlaneFromShape(shape, dataType, pitchAlign);
+    size_t bytes = static_cast<size_t>(plane.pitchInBytes) * height;
+    void* data = AlignedAlloc(bytes);
+    DS3D_FAILED_RETURN(data, Frame2DGuard(), "allocate 2D frame of %zu bytes failed", bytes);
+    return Frame2DGuard(
+        NewAbiRef<abi2DFrame>(new Frame2DImpl(
+            data, bytes, shape, dataType, frameType, &plane, 1, MemType::kCpu, 0, AlignedFree)),
+        true);
+}
+
+// rectangle in pixels of plane 0 of a 2D frame
+struct FrameRoi {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+/**
+ * @brief create a region-of-interest view of a 2D frame without copying.
+ *   The view shares the parent buffer: base() and bytes() are the parent's,
+ *   every plane keeps its pitch and gets its offset, width and height moved
+ *   to the ROI, and shape dims {H, W} are set to the ROI size. The view holds
+ *   a reference of the parent, so the buffer stays alive as long as the view.
+ *   Subsampled planes (e.g. NV12 chroma) need the ROI aligned to their
+ *   subsampling factor. Consumers must address pixels through the plane
+ *   offset and pitch (e.g. FrameView), not from base() directly.
+ *   e.g. Roi2DFrame(depth, FrameRoi{212, 120, 424, 240}) -> central 424x240 of 848x480
+ */
+inline Frame2DGuard
+Roi2DFrame(const Frame2DGuard& parent, const FrameRoi& roi)
+{
+    DS3D_FAILED_RETURN(parent, Frame2DGuard(), "ROI of an empty frame");
+    const abi2DFrame* frame = parent.ptr();
+    uint32_t numPlanes = frame->planes();
+    DS3D_FAILED_RETURN(
+        numPlanes && numPlanes <= Frame2DImpl::kMaxPlanes, Frame2DGuard(), "ROI frame planes: %u unsupported",
+        numPlanes);
+    const Frame2DPlane& main = frame->getPlane(0);
+    DS3D_FAILED_RETURN(
+        roi.width && roi.height && roi.x + roi.width <= main.width && roi.y + roi.height <= main.height,
+        Frame2DGuard(), "ROI (%u, %u, %u, %u) out of frame %ux%u", roi.x, roi.y, roi.width, roi.height,
+        main.width, main.height);
+
+    Frame2DPlane planes[Frame2DImpl::kMaxPlanes];
+    for (uint32_t i = 0; i < numPlanes; ++i) {
+        const Frame2DPlane& p = frame->getPlane(i);
+        DS3D_FAILED_RETURN(p.width && p.height, Frame2DGuard(), "ROI of an empty plane: %u", i);
+        uint32_t sx = main.width / p.width;
+        uint32_t sy = main.height / p.height;
+        DS3D_FAILED_RETURN(
+            sx && sy && !(roi.x % sx) && !(roi.y % sy) && !(roi.width % sx) && !(roi.height % sy),
+            Frame2DGuard(), "ROI not aligned to the subsampling of plane: %u", i);
+        planes[i] = p;
+        planes[i].offset = p.offset + static_cast<size_t>(roi.y / sy) * p.pitchInBytes +
+                           static_cast<size_t>(roi.x / sx) * p.bytesPerPixel;
+        planes[i].width = roi.width / sx;
+        planes[i].height = roi.height / sy;
+    }
+
+    Shape shape = frame->shape();
+    if (shape.numDims >= 2) {
+        shape.d[0] = static_cast<int32_t>(roi.height);
+        shape.d[1] = static_cast<int32_t>(roi.width);
+    }
+    // the deleter owns a parent reference, released with the view
+    return Frame2DGuard(
+        NewAbiRef<abi2DFrame>(new Frame2DImpl(
+            frame->base(), frame->bytes(), shape, frame->dataType(), frame->frameType(), planes, numPlanes,
+            frame->memType(), frame->devId(), [keep = parent](void*) {})),
+        true);
+}
+
+// allocate a kFrameAlignment aligned CPU frame, e.g. Shape{2, {N, 3}} points
+inline FrameGuard
+CreateFrame(const Shape& shape, DataType dataType, FrameType frameType)
+{
+    size_t bytes = ShapeSize(shape) * dataTypeBytes(dataType);
+    void* data = AlignedAlloc(bytes);
+    DS3D_FAILED_RETURN(data, FrameGuard(), "allocate frame of %zu bytes failed", bytes);
+    return WrapFrame(data, bytes, shape, dataType, frameType, MemType::kCpu, 0, AlignedFree);
+}
 
 }  // namespace ds3d
 
-#endif  // _DS3D_COMMON_HPP_FRAME__HPP
\ No newline at end of file
+#endif  // _DS3D_COMMON_HPP_FRAME__HPP
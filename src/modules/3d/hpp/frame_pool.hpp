@@ -0,0 +1,235 @@
+#ifndef DS3D_COMMON_HPP_FRAME_POOL_HPP
+#define DS3D_COMMON_HPP_FRAME_POOL_HPP
+
+#include "3d/common/abi_frame.h"
+#include "3d/common/common.h"
+#include "3d/common/func_utils.h"
+
+#include "frame.hpp"
+#include "obj.hpp"
+#include "pinned_memory.hpp"
+
+#include <chrono>
+#include <vector>
+
+/**
+ * @file FramePool recycles fixed-shape CPU frames between pipeline stages
+ */
+
+namespace ds3d {
+
+struct FramePoolStats {
+    uint64_t hits = 0;       // served by a recycled frame
+    uint64_t misses = 0;     // a new buffer had to be allocated
+    uint64_t waits = 0;      // pool exhausted, acquire had to wait
+    uint64_t timeouts = 0;   // pool exhausted, acquire returned an empty guard
+    uint32_t allocated = 0;  // frames owned by the pool
+    uint32_t available = 0;  // frames ready to be acquired
+};
+
+/**
+ * @brief FramePoolT pre-allocates frames of a single Shape/DataType/FrameType
+ *   and hands them out as GuardDataT<abiFrameT> (FrameGuard or Frame2DGuard).
+ *   When the last reference of a frame is destroyed, on any thread, the frame
+ *   goes back to the pool instead of freeing its buffer. The ref object is
+ *   part of the pool slot, so acquire and release do not touch the heap.
+ *   If all frames are in use, acquire allocates up to maxSize frames, then
+ *   waits up to waitMs for one to come back and returns an empty guard on
+ *   timeout. Outstanding frames keep the pool storage alive after the pool
+ *   object is destroyed. Buffers are kFrameAlignment aligned, 2D frames have
+ *   their rows padded to pitchAlign bytes (see Create2DFrame). Buffers come
+ *   from the heap or, for FrameMemory::kPinned, from locked huge pages.
+ *
+ *   For example:
+ *     Frame2DPool pool(Shape{3, {480, 640, 1}}, DataType::kUint16, FrameType::kDepth, 8);
+ *     Frame2DGuard depth = pool.acquire(100);
+ *     if (depth) { fill(depth->base()); datamap.setGuardData(kDepthFrame, depth); }
+ */
+template <class abiFrameT, _EnableIfBaseOf<abiFrame, abiFrameT> = true>
+class FramePoolT
+{
+    using FrameImplT = std::conditional_t<std::is_same<abiFrameT, abi2DFrame>::value, Frame2DImpl, FrameImpl>;
+    class State;
+
+    // pool slot, the frame ref handed out to users
+    class Slot : public abiRefT<abiFrameT>
+    {
+        public:
+            Slot(void* buf, size_t bytes, const Shape& shape, DataType dataType, FrameType frameType,
+                 const Frame2DPlane& plane, FrameMemory memory)
+                : _buf(buf, FrameMemoryFree(memory)),
+                  _frame(makeFrame(buf, bytes, shape, dataType, frameType, plane, frameMemType(memory)))
+            {
+            }
+            ~Slot() override = default;
+            abiFrameT* data() const final { return const_cast<FrameImplT*>(&_frame); }
+            abiRefObj* refCopy_i() const final
+            {
+                _refCount.fetch_add(1, std::memory_order_relaxed);
+                return const_cast<Slot*>(this);
+            }
+            void destroy() final
+            {
+                if (_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    // might free this slot if the pool is gone, nothing is touched afterwards
+                    ShrdPtr<State> state = std::move(_state);
+                    state->recycle(this);
+                }
+            }
+
+        private:
+            static FrameImplT makeFrame(
+                void* buf, size_t bytes, const Shape& shape, DataType dataType, FrameType frameType,
+                const Frame2DPlane& plane, MemType memType)
+            {
+                if constexpr (std::is_same<FrameImplT, Frame2DImpl>::value) {
+                    return Frame2DImpl(buf, bytes, shape, dataType, frameType, &plane, 1, memType);
+                } else {
+                    return FrameImpl(buf, bytes, shape, dataType, frameType, memType);
+                }
+            }
+
+            friend class State;
+            std::unique_ptr<void, void (*)(void*)> _buf;
+            FrameImplT _frame;
+            mutable std::atomic<uint32_t> _refCount{0};
+            ShrdPtr<State> _state;
+            DS3D_DISABLE_CLASS_COPY(Slot);
+    };
+
+    class State : public std::enable_shared_from_this<State>
+    {
+        public:
+            State(const Shape& shape, DataType dataType, FrameType frameType, uint32_t maxSize, uint32_t pitchAlign,
+                  FrameMemory memory)
+                : _shape(shape), _dataType(dataType), _frameType(frameType), _maxSize(maxSize), _memory(memory)
+            {
+                if constexpr (std::is_same<abiFrameT, abi2DFrame>::value) {
+                    _plane = Frame2DPlaneFromShape(shape, dataType, pitchAlign);
+                    _bytes = static_cast<size_t>(_plane.pitchInBytes) * _plane.height;
+                } else {
+                    _bytes = ShapeSize(shape) * dataTypeBytes(dataType);
+                }
+            }
+
+            // preallocated frames count as neither hit nor miss
+            void reserve(uint32_t size)
+            {
+                LockMutex locker(_mutex);
+                while (_slots.size() < size) {
+                    _free.push_back(newSlot());
+                }
+            }
+
+            GuardDataT<abiFrameT> acquire(uint32_t waitMs)
+            {
+                LockMutex locker(_mutex);
+                Slot* slot = nullptr;
+                if (!_free.empty()) {
+                    ++_stats.hits;
+                } else if (_slots.size() < _maxSize) {
+                    ++_stats.misses;
+                    _free.push_back(newSlot());
+                } else {
+                    ++_stats.waits;
+                    if (!_cond.wait_for(locker, std::chrono::milliseconds(waitMs), [this]() {
+                            return !_free.empty();
+                        })) {
+                        ++_stats.timeouts;
+                        return GuardDataT<abiFrameT>();
+                    }
+                }
+                slot = _free.back();
+                _free.pop_back();
+                locker.unlock();
+
+                DS_ASSERT(!slot->_refCount.load(std::memory_order_relaxed));
+                slot->_refCount.store(1, std::memory_order_relaxed);
+                slot->_state = this->shared_from_this();
+                return GuardDataT<abiFrameT>(slot, true);
+            }
+
+            void recycle(Slot* slot)
+            {
+                {
+                    LockMutex locker(_mutex);
+                    _free.push_back(slot);
+                }
+                _cond.notify_one();
+            }
+
+            FramePoolStats stats() const
+            {
+                LockMutex locker(_mutex);
+                FramePoolStats s = _stats;
+                s.allocated = static_cast<uint32_t>(_slots.size());
+                s.available = static_cast<uint32_t>(_free.size());
+                return s;
+            }
+
+            size_t frameBytes() const { return _bytes; }
+            FrameMemory memory() const { return _memory; }
+            // a frame layout the pool can serve
+            bool matches(const Shape& shape, DataType dataType, FrameType frameType) const
+            {
+                return _shape == shape && _dataType == dataType && _frameType == frameType;
+            }
+
+        private:
+            Slot* newSlot()
+            {
+                void* buf = FrameMemoryAlloc(_memory, _bytes);
+                DS3D_THROW_ERROR(buf, ErrCode::kMem, "frame pool allocation failed");
+                _slots.emplace_back(new Slot(buf, _bytes, _shape, _dataType, _frameType, _plane, _memory));
+                return _slots.back().get();
+            }
+
+            Shape _shape;
+            DataType _dataType;
+            FrameType _frameType;
+            uint32_t _maxSize;
+            FrameMemory _memory;
+            Frame2DPlane _plane{};
+            size_t _bytes = 0;
+            mutable std::mutex _mutex;
+            std::condition_variable _cond;
+            std::vector<std::unique_ptr<Slot>> _slots;
+            std::vector<Slot*> _free;
+            FramePoolStats _stats;
+    };
+
+    public:
+        // size frames are allocated upfront, maxSize (>= size) caps the growth.
+        // pitchAlign only applies to 2D frames. FrameMemory::kPinned frames are
+        // MemType::kCpuPinned, see PinnedAlloc.
+        FramePoolT(
+            const Shape& shape, DataType dataType, FrameType frameType, uint32_t size,
+            uint32_t maxSize = 0, uint32_t pitchAlign = kFrameAlignment, FrameMemory memory = FrameMemory::kCpu)
+            : _state(std::make_shared<State>(
+                  shape, dataType, frameType, std::max(size, maxSize), pitchAlign, memory))
+        {
+            DS_ASSERT(ShapeSize(shape));
+            _state->reserve(size);
+        }
+        ~FramePoolT() = default;
+
+        GuardDataT<abiFrameT> acquire(uint32_t waitMs = 0) { return _state->acquire(waitMs); }
+        FramePoolStats stats() const { return _state->stats(); }
+        size_t frameBytes() const { return _state->frameBytes(); }
+        FrameMemory memory() const { return _state->memory(); }
+        bool matches(const Shape& shape, DataType dataType, FrameType frameType) const
+        {
+            return _state->matches(shape, dataType, frameType);
+        }
+
+    private:
+        ShrdPtr<State> _state;
+        DS3D_DISABLE_CLASS_COPY(FramePoolT);
+};
+
+using FramePool = FramePoolT<abiFrame>;
+using Frame2DPool = FramePoolT<abi2DFrame>;
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_FRAME_POOL_HPP
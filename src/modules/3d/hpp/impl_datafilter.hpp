@@ -0,0 +1,218 @@
+#ifndef DS3D_COMMON_HPP_IMPL_DATAFILTER_HPP
+#define DS3D_COMMON_HPP_IMPL_DATAFILTER_HPP
+
+#include "3d/common/abi_dataprocess.h"
+#include "3d/common/common.h"
+#include "3d/common/config.h"
+#include "3d/common/func_utils.h"
+
+#include "datamap.hpp"
+#include "frame_pool.hpp"
+#include "obj.hpp"
+#include "overlay_datamap.hpp"
+#include "thread_pool.hpp"
+#include "yaml_config.hpp"
+
+#include <atomic>
+#include <memory>
+
+/**
+ * @file BaseImplDataFilter is the common base of the CPU abiDataFilter implementations (nvds3dfilter custom-libs)
+ */
+
+namespace ds3d { namespace impl {
+
+/**
+ * @brief BaseImplDataFilter implements the abiDataFilter bookkeeping: state,
+ *   user data, error callback, caps and the component config parsing.
+ *   Derived filters implement startImpl/processImpl/stopImpl only.
+ *   Filters are synchronous, processImpl runs on the caller thread and the
+ *   output/consumed callbacks are invoked as soon as it returns. The output
+ *   is expected to be an overlay of the input (see newOutput), so a filter
+ *   only pays for the keys it adds or replaces.
+ *   The config_body keys common to all filters are parsed here as well:
+ *     threads: 0         # 0 uses the shared ThreadPool, 1 the filter thread only, N a pool of its own
+ *     mem_type: cpu      # cpu or pinned output frames, see acquireFrame
+ *     mem_pool_size: 8   # output frames in flight, the default is given by the derived filter
+ *   The shared ThreadPool runs one job at a time, a filter finding it busy
+ *   runs its kernels on its own thread. Filters processing concurrently,
+ *   e.g. the pipelines of two cameras, need threads: N to get pools of their own.
+ *
+ *   For example, a custom-lib exports:
+ *     DS3D_EXTERN_C_BEGIN
+ *     DS3D_EXPORT_API abiRefDataFilter* createFooFilter()
+ *     {
+ *         return NewAbiRef<abiDataFilter>(new FooFilter);
+ *     }
+ *     DS3D_EXTERN_C_END
+ */
+class BaseImplDataFilter : public abiDataFilter {
+public:
+    explicit BaseImplDataFilter(uint32_t defaultPoolSize = 8) : _defaultPoolSize(defaultPoolSize) {}
+    ~BaseImplDataFilter() override = default;
+
+    void setUserData_i(const abiRefAny* userdata) override
+    {
+        _userData = userdata ? GuardDataT<void>(*userdata) : GuardDataT<void>();
+    }
+    const abiRefAny* getUserData_i() const override { return _userData.abiRef(); }
+    void setErrorCallback_i(const abiErrorCB& cb) override { _errCb = GuardCB<abiErrorCB>(cb); }
+    State state_i() const override { return _state.load(std::memory_order_acquire); }
+
+    ErrCode start_i(const char* configStr, uint32_t strLen, const char* path) override
+    {
+        DS3D_FAILED_RETURN(configStr, ErrCode::kParam, "datafilter config must not be null");
+        DS3D_FAILED_RETURN(state_i() != State::kRunning, ErrCode::kState, "datafilter is already running");
+        _state.store(State::kStarting, std::memory_order_release);
+        std::string content(configStr, strLen);
+        ErrCode code = config::CatchConfigCall(config::parseComponentConfig, content, path ? path : "", _config);
+        if (isGood(code)) {
+            code = config::CatchYamlCall([this]() {
+                YAML::Node body = _config.configBody.empty() ? YAML::Node() : YAML::Load(_config.configBody);
+                DS3D_ERROR_RETURN(parseResourceConfig(body), "datafilter: %s config failed", _config.name.c_str());
+                return startImpl(body);
+            });
+        }
+        if (!isGood(code)) {
+            _state.store(State::kNone, std::memory_order_release);
+            emitError(code, "datafilter start failed");
+            return code;
+        }
+        _state.store(State::kRunning, std::memory_order_release);
+        return ErrCode::kGood;
+    }
+
+    ErrCode stop_i() override
+    {
+        State s = state_i();
+        if (s != State::kRunning && s != State::kStarting) {
+            return ErrCode::kGood;
+        }
+        _state.store(State::kStopped, std::memory_order_release);
+        ErrCode code = stopImpl();
+        _ownPool.reset();
+        return code;
+    }
+
+    const char* getCaps_i(CapsPort p) const override
+    {
+        const std::string& caps = (p == CapsPort::kInput ? _config.gstInCaps : _config.gstOutCaps);
+        return caps.empty() ? kDefaultDs3dCaps : caps.c_str();
+    }
+
+    ErrCode flush_i() override { return ErrCode::kGood; }
+
+    // a failed frame is still delivered: outputDataCb receives the unchanged
+    // input with the error code, which is returned as well, so the host
+    // decides whether to stop the pipeline
+    ErrCode process_i(
+        const abiRefDataMap* inputData, const abiOnDataCB* outputDataCb,
+        const abiOnDataCB* dataConsumedCb) override
+    {
+        DS3D_FAILED_RETURN(inputData, ErrCode::kParam, "datafilter input must not be null");
+        DS3D_FAILED_RETURN(
+            state_i() == State::kRunning, ErrCode::kState, "datafilter: %s is not running",
+            _config.name.c_str());
+        GuardDataMap input(*inputData);
+        GuardDataMap output;
+        ErrCode code = safeProcess(input, output);
+        if (!isGood(code)) {
+            emitError(code, "datafilter process failed");
+        }
+        if (outputDataCb) {
+            const_cast<abiOnDataCB*>(outputDataCb)
+                ->notify(code, (isGood(code) && output) ? output.abiRef() : input.abiRef());
+        }
+        if (dataConsumedCb) {
+            const_cast<abiOnDataCB*>(dataConsumedCb)->notify(ErrCode::kGood, input.abiRef());
+        }
+        return code;
+    }
+
+protected:
+    // body is the parsed config_body, null if the component has none
+    virtual ErrCode startImpl(const YAML::Node& body) = 0;
+    // output is empty on entry, leave it empty (or set it to input) to bypass
+    virtual ErrCode processImpl(const GuardDataMap& input, GuardDataMap& output) = 0;
+    virtual ErrCode stopImpl() { return ErrCode::kGood; }
+
+    // output datamap reading through to input, only new keys are stored
+    static GuardDataMap newOutput(const GuardDataMap& input) { return CreateOverlayDataMap(input); }
+
+    void emitError(ErrCode code, const char* msg)
+    {
+        if (_errCb) {
+            _errCb(code, msg);
+        }
+    }
+
+    const config::ComponentConfig& config() const { return _config; }
+
+    // pool for the kernels of processImpl, nullptr runs them on the filter
+    // thread, see ThreadPool::parallelFor(pool, ...)
+    ThreadPool* threadPool() const
+    {
+        if (_ownPool) {
+            return _ownPool.get();
+        }
+        return _threads == 1 ? nullptr : &ThreadPool::shared();
+    }
+
+    // an output frame from pool, which is (re)created with mem_pool_size and
+    // mem_type whenever the frame layout changes, e.g. with the depth
+    // resolution. Frames still in flight keep the old pool alive.
+    // Empty if the pool stays exhausted for kAcquireWaitMs.
+    template <class abiFrameT>
+    GuardDataT<abiFrameT> acquireFrame(
+        std::unique_ptr<FramePoolT<abiFrameT>>& pool, const Shape& shape, DataType dataType, FrameType frameType)
+    {
+        if (!pool || !pool->matches(shape, dataType, frameType)) {
+            pool = std::make_unique<FramePoolT<abiFrameT>>(
+                shape, dataType, frameType, _poolSize, 0, kFrameAlignment, _memory);
+        }
+        return pool->acquire(kAcquireWaitMs);
+    }
+
+private:
+    static constexpr uint32_t kAcquireWaitMs = 100;
+
+    ErrCode parseResourceConfig(const YAML::Node& body)
+    {
+        _threads = 0;
+        _poolSize = _defaultPoolSize;
+        _memory = FrameMemory::kCpu;
+        if (body) {
+            _threads = body["threads"].as<uint32_t>(_threads);
+            _poolSize = body["mem_pool_size"].as<uint32_t>(_poolSize);
+            std::string memType = body["mem_type"].as<std::string>("cpu");
+            DS3D_FAILED_RETURN(
+                frameMemoryFromString(memType, _memory), ErrCode::kConfig, "unsupported mem_type: %s",
+                memType.c_str());
+        }
+        DS3D_FAILED_RETURN(_poolSize, ErrCode::kConfig, "mem_pool_size must not be 0");
+        _ownPool.reset(_threads > 1 ? new ThreadPool(_threads) : nullptr);
+        return ErrCode::kGood;
+    }
+
+    ErrCode safeProcess(const GuardDataMap& input, GuardDataMap& output)
+    {
+        DS3D_TRY { return processImpl(input, output); }
+        DS3D_CATCH_ERROR(Exception, ErrCode::kUnknown, "datafilter: %s process error", _config.name.c_str())
+        DS3D_CATCH_ERROR(std::exception, ErrCode::kUnknown, "datafilter: %s process failed", _config.name.c_str())
+        DS3D_CATCH_ANY(ErrCode::kUnknown, "datafilter: %s process failed", _config.name.c_str())
+    }
+
+    std::atomic<State> _state{State::kNone};
+    config::ComponentConfig _config;
+    GuardDataT<void> _userData;
+    GuardCB<abiErrorCB> _errCb;
+    const uint32_t _defaultPoolSize;
+    uint32_t _threads = 0;
+    uint32_t _poolSize = 0;
+    FrameMemory _memory = FrameMemory::kCpu;
+    std::unique_ptr<ThreadPool> _ownPool;
+};
+
+}}  // namespace ds3d::impl
+
+#endif  // DS3D_COMMON_HPP_IMPL_DATAFILTER_HPP
@@ -59,7 +59,9 @@ template <class From, class To, _Convertible<From*, To*> = true> To* pointerCast
     return static_cast<To*>(a);
 }
 
-template <class From, class To, _EnableIfBaseOf<From, To> = true> To* pointerCast(From* a)
+template <class From, class To,
+          std::enable_if_t<std::is_base_of<From, To>::value && !std::is_same<From, To>::value, bool> = true>
+To* pointerCast(From* a)
 {
     return dynamic_cast<To*>(a);
 }
@@ -69,10 +71,42 @@ template <class From, class To, std::enable_if_t<std::is_void<From>::value, bool
     return static_cast<To*>(a);
 }
 
-template <class From, class To> class abiRefCast : public abiRefT<To>
+/**
+ * @brief Intrusive reference count (ABI v2). refCopy_i() hands out this same
+ *   object with one more count and destroy() drops one count, the last one
+ *   deletes it. Copying a reference is a single atomic increment with no heap
+ *   allocation. The abiRefObj interface is unchanged, so callers which only
+ *   know the v1 copy model keep working. Objects derived from RefCountObj must
+ *   always be heap allocated.
+ */
+template <class abiRefBase, _EnableIfBaseOf<abiRefObj, abiRefBase> = true> class RefCountObj : public abiRefBase
+{
+    mutable std::atomic<uint32_t> _refCount{1};
+
+    protected:
+        RefCountObj() = default;
+
+    public:
+        ~RefCountObj() override = default;
+        void destroy() final
+        {
+            if (_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+        abiRefObj* refCopy_i() const final
+        {
+            _refCount.fetch_add(1, std::memory_order_relaxed);
+            return const_cast<RefCountObj*>(this);
+        }
+        uint32_t refCount() const { return _refCount.load(std::memory_order_relaxed); }
+
+        DS3D_DISABLE_CLASS_COPY(RefCountObj);
+};
+
+template <class From, class To> class abiRefCast : public RefCountObj<abiRefT<To>>
 {
     abiRefT<From>* _from = nullptr;
-    abiRefCast() = default;
 
     public:
         abiRefCast(const abiRefT<From>& from) { _from = from.refCopy(); }
@@ -91,19 +125,8 @@ template <class From, class To> class abiRefCast : public abiRefT<To>
                 _from = nullptr;
             }
         }
-        ~abiRefCast() { reset(); }
-        void destroy() final
-        {
-            reset();
-            delete this;
-        }
+        ~abiRefCast() override { reset(); }
         To* data() const final { return pointerCast<From, To>(_from->data()); }
-        abiRefObj* refCopy_i() const final
-        {
-            auto newptr = new abiRefCast();
-            newptr->_from = _from->refCopy();
-            return newptr;
-        }
         DS3D_DISABLE_CLASS_COPY(abiRefCast);
 };
 
@@ -128,16 +151,37 @@ template <class Tp> class SharedRefObj : public abiRefT<Tp>
         DS3D_REF_COPY_DESTROY_IMPL(SharedRefObj)
 };
 
+// v2 counterpart of SharedRefObj, ref copies share this object by refcount.
+// Unlike SharedRefObj it must not live on the stack.
+template <class Tp> class IntrusiveRefObj : public RefCountObj<abiRefT<Tp>>
+{
+    ShrdPtr<Tp> _ptr;
+
+    public:
+        IntrusiveRefObj(ShrdPtr<Tp>&& v) : _ptr(std::move(v)) { DS_ASSERT(_ptr); }
+        template <class Ty, _PtrConvertible<Ty, Tp> = true>
+        IntrusiveRefObj(ShrdPtr<Ty>&& v)
+        {
+            DS_ASSERT(v);
+            Tp* d = pointerCast<Ty, Tp>(v.get());
+            _ptr = ShrdPtr<Tp>(std::move(v), d);
+        }
+        IntrusiveRefObj(Tp* v, std::function<void(Tp*)> f) : _ptr(v, (f ? std::move(f) : [](Tp*) {})) {}
+        ~IntrusiveRefObj() override = default;
+
+        Tp* data() const final { return _ptr.get(); }
+};
+
 template <class Tp> abiRefT<Tp>* NewAbiRef(Tp* rawAbiObj)
 {
-    return new SharedRefObj<Tp>(rawAbiObj, &DeleteTFunc<Tp>);
+    return new IntrusiveRefObj<Tp>(rawAbiObj, &DeleteTFunc<Tp>);
 }
 
 using RefDataMapObj = SharedRefObj<abiRefDataMap>;
 
-template <class From, class To = From> inline SharedRefObj<To>* PtrToAbiRef(ShrdPtr<From>&& p)
+template <class From, class To = From> inline IntrusiveRefObj<To>* PtrToAbiRef(ShrdPtr<From>&& p)
 {
-    return new SharedRefObj<To>(std::move(p));
+    return new IntrusiveRefObj<To>(std::move(p));
 }
 
 template <class From, class To = From> inline ShrdPtr<To> AbiRefToPtr(const abiRefT<From>& p)
@@ -176,6 +220,43 @@ template <typename... Args> class CBObjT : public abiCallBackT<Args...>
         cbType _f;
 };
 
+// v2 counterpart of CBObjT with an intrusive refcount, must be heap allocated.
+template <typename... Args> class RefCBObjT : public RefCountObj<abiCallBackT<Args...>>
+{
+    public:
+        using cbType = std::function<void(Args...)>;
+        bool isValid() const { return bool(_f); }
+        RefCBObjT(cbType&& f) : _f(std::move(f)) {}
+        ~RefCBObjT() override = default;
+        void notify(Args... args) final
+        {
+            if (_f)
+                _f(args...);
+        }
+    private:
+        cbType _f;
+};
+
+// v2 callback storing the callable F inline, no std::function type erasure.
+// F is usually a lambda, notify() is one virtual call into it.
+template <typename F, typename... Args> class FnCBObjT : public RefCountObj<abiCallBackT<Args...>>
+{
+    public:
+        template <typename Fn>
+        explicit FnCBObjT(Fn&& f) : _f(std::forward<Fn>(f)) {}
+        ~FnCBObjT() override = default;
+        bool isValid() const
+        {
+            if constexpr (std::is_constructible<bool, const F&>::value) {
+                return bool(_f);
+            }
+            return true;
+        }
+        void notify(Args... args) final { _f(args...); }
+    private:
+        F _f;
+};
+
 /**
  * @brief Guard to wrapper all abiRefObj& data.
  *        It is safe to use the Guard to access any kind of abiRefObj data.
@@ -218,7 +299,9 @@ template <typename ref, _EnableIfBaseOf<abiRefObj, ref> = true> class GuardRef
         // copy from another GuardRef
         GuardRef& operator=(const GuardRef& o)
         {
-            _abiRef = o._abiRef ? static_cast<ref*>(o._abiRef->refCopy_i()) : nullptr;
+            if (this != &o) {
+                reset(o._abiRef ? static_cast<ref*>(o._abiRef->refCopy_i()) : nullptr);
+            }
             return *this;
         }
         // release this abiRef. user need to take owership of the released abiRef and destroy after use.
@@ -263,16 +346,22 @@ template <typename abiCB> class GuardCB : public GuardRef<abiCB>
         GuardCB(abiCB* cb, bool takeowner = true) : _GuardCBBase(cb, takeowner) {}
         GuardCB(nullptr_t) {}
         GuardCB(const GuardCB& o) : _GuardCBBase(o) {}
+        GuardCB& operator=(const GuardCB& o) = default;
         ~GuardCB() override = default;
 
         template <typename... Args, typename F>
-        void setFn(F f)
+        void setFn(F&& f)
         {
-            auto obj = std::make_unique<CBObjT<Args...>>(std::move(f));
-            if (obj && obj->isValid()) {
-                this->reset(obj.release());
-            } else {
+            if constexpr (std::is_null_pointer_v<std::decay_t<F>>) {
                 this->reset();
+            } else {
+                using FnObj = FnCBObjT<std::decay_t<F>, Args...>;
+                std::unique_ptr<FnObj> obj(new FnObj(std::forward<F>(f)));
+                if (obj && obj->isValid()) {
+                    this->reset(obj.release());
+                } else {
+                    this->reset();
+                }
             }
         }
 
@@ -308,6 +397,7 @@ template <class Tp> class GuardDataT : public GuardRef<abiRefT<Tp>>
         GuardDataT(const abiRefT<Tp>& rf) : GuardRef<abiRefT<Tp>>(rf) {}
         GuardDataT(abiRefT<Tp>* refPtr, bool takeOwner) : GuardRef<abiRefT<Tp>>(refPtr, takeOwner) {}
         GuardDataT(const GuardDataT& o):  GuardRef<abiRefT<Tp>>(o) {}
+        GuardDataT& operator=(const GuardDataT& o) = default;
         ~GuardDataT() override = default;
 
         // convert from a derived reference
@@ -0,0 +1,424 @@
+#ifndef DS3D_COMMON_HPP_OUTLIER_REMOVAL_HPP
+#define DS3D_COMMON_HPP_OUTLIER_REMOVAL_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/point_window.h"
+
+#include "frame.hpp"
+#include "point_grid.hpp"
+#include "thread_pool.hpp"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+/**
+ * @file statistical and radius outlier removal of kPointXYZ (and kPointCoordUV) frames
+ */
+
+namespace ds3d {
+
+enum class OutlierMethod : int {
+    kStatistical,  // mean distance to the k nearest neighbors above mean + stdRatio * stddev of the cloud
+    kRadius,  // less than minNeighbors neighbors within radius
+};
+
+struct OutlierRemovalParams {
+    OutlierMethod method = OutlierMethod::kStatistical;
+    // neighbor search radius in meters, also the grid cell size. kStatistical
+    // counts neighbors farther than radius at radius, so keep it above the
+    // k-th neighbor distance of inliers
+    float radius = 0.015f;
+    uint32_t meanK = 8;  // kStatistical, up to kOutlierMaxK
+    float stdRatio = 1.0f;  // kStatistical
+    uint32_t minNeighbors = 4;  // kRadius
+    // organized clouds, the candidates are the (2 * window + 1)^2 - 1 pixels around a point
+    uint32_t window = 2;
+};
+
+constexpr uint32_t kOutlierMaxK = 64;
+constexpr uint32_t kOutlierMaxWindow = 7;
+
+/**
+ * @brief OutlierRemoval drops flying pixels and other sparse points from a
+ *   point cloud, with the color coordinates of the surviving points kept in
+ *   sync. filter() takes neighbors from a PointGrid of cell size radius,
+ *   scores are computed in parallel cell by cell, every query of a cell
+ *   scanning the same gathered neighborhood. filterOrganized() takes them
+ *   from the pixel window around every point of a cloud still ordered like
+ *   its depth image, a few candidates per point instead of a 3D search.
+ *   Survivors keep their input order, invalid points, (0, 0, 0) or
+ *   non-finite, are dropped. compactRows() drops the same rows of other per
+ *   point frames of the cloud, e.g. kPointNormal. Storage is kept between
+ *   frames.
+ *   Not thread-safe, use one OutlierRemoval per stream.
+ */
+class OutlierRemoval {
+public:
+    explicit OutlierRemoval(const OutlierRemovalParams& params = OutlierRemovalParams()) : _params(params) {}
+
+    const OutlierRemovalParams& params() const { return _params; }
+
+    // colorCoord may be empty, outCoord is only set when it is not
+    ErrCode filter(
+        const FrameGuard& points, const FrameGuard& colorCoord, FrameGuard& outPoints, FrameGuard& outCoord,
+        ThreadPool* pool = nullptr)
+    {
+        const float *xyz = nullptr, *uv = nullptr;
+        size_t num = 0;
+        DS3D_ERROR_RETURN(source(points, colorCoord, xyz, uv, num), "outlier removal input invalid");
+
+        _grid.build(xyz, num, _params.radius, pool);
+        _keep.assign(num, 0);
+        if (_params.method == OutlierMethod::kStatistical) {
+            scoreStatistical(pool);
+        } else {
+            keepRadius(pool);
+        }
+        return compact(xyz, uv, num, _grid.size(), outPoints, outCoord, pool);
+    }
+
+    // points must be ordered like their depth image, point y * width + x is pixel (x, y) as depth2point outputs
+    ErrCode filterOrganized(
+        const FrameGuard& points, uint32_t width, uint32_t height, const FrameGuard& colorCoord, FrameGuard& outPoints,
+        FrameGuard& outCoord, ThreadPool* pool = nullptr)
+    {
+        DS3D_FAILED_RETURN(
+            _params.window >= 1 && _params.window <= kOutlierMaxWindow, ErrCode::kParam,
+            "outlier window must be 1 to %u", kOutlierMaxWindow);
+        const float *xyz = nullptr, *uv = nullptr;
+        size_t num = 0;
+        DS3D_ERROR_RETURN(source(points, colorCoord, xyz, uv, num), "outlier removal input invalid");
+        DS3D_FAILED_RETURN(
+            num == static_cast<size_t>(width) * height, ErrCode::kParam, "kPointXYZ of %zu points is not organized as %ux%u",
+            num, width, height);
+
+        const size_t valid = toPlanar(xyz, width, height, pool);
+        const WindowQuery q = windowQuery(width);
+        const uint32_t w = _params.window, stride = width + 2 * w;
+        const float inf = std::numeric_limits<float>::infinity();
+        auto center = [w, stride](size_t row) { return (row + w) * stride + w; };
+        _keep.assign(num, 0);
+        if (_params.method == OutlierMethod::kStatistical) {
+            _score.resize(num);
+            ThreadPool::parallelFor(pool, height, kRowGrain, [&](size_t r0, size_t r1) {
+                for (size_t row = r0; row < r1; ++row) {
+                    const size_t i = center(row);
+                    float* score = _score.data() + row * width;
+                    WindowMeanDistance(q, i, i + width, _params.meanK, _params.radius, score);
+                    for (uint32_t c = 0; c < width; ++c) {
+                        score[c] = _x[i + c] != inf ? score[c] : std::numeric_limits<float>::quiet_NaN();
+                    }
+                }
+            });
+            const float threshold = scoreThreshold(num, pool);
+            ThreadPool::parallelFor(pool, num, kStatsChunk, [&](size_t i0, size_t i1) {
+                for (size_t i = i0; i < i1; ++i) {
+                    _keep[i] = _score[i] <= threshold;
+                }
+            });
+        } else {
+            ThreadPool::parallelFor(pool, height, kRowGrain, [&](size_t r0, size_t r1) {
+                std::vector<uint32_t> count(width);
+                for (size_t row = r0; row < r1; ++row) {
+                    const size_t i = center(row);
+                    WindowNeighbors(q, i, i + width, count.data());
+                    for (uint32_t c = 0; c < width; ++c) {
+                        _keep[row * width + c] = _x[i + c] != inf && count[c] >= _params.minNeighbors;
+                    }
+                }
+            });
+        }
+        return compact(xyz, uv, num, valid, outPoints, outCoord, pool);
+    }
+
+    // valid points dropped as outliers by the last filter() or filterOrganized()
+    size_t lastRemoved() const { return _lastRemoved; }
+
+    // keeps the rows of the last filter() or filterOrganized() survivors in a CPU fp32 N x 3 frame of
+    // the same cloud, e.g. kPointNormal
+    ErrCode compactRows(const FrameGuard& rows, FrameType type, FrameGuard& out, ThreadPool* pool = nullptr) const
+    {
+        DS3D_FAILED_RETURN(!_offsets.empty(), ErrCode::kState, "no filtered points to compact rows of");
+        const size_t num = _keep.size();
+        FrameView<const float, 3> src(rows);
+        DS3D_FAILED_RETURN(
+            src && src.width() == num, ErrCode::kParam, "per point frame must be CPU fp32 %zu x 3 like the filtered points",
+            num);
+        const uint32_t numTiles = static_cast<uint32_t>(_offsets.size() - 1);
+        out = CreateFrame(Shape{2, {static_cast<int32_t>(_offsets[numTiles]), 3}}, DataType::kFp32, type);
+        DS3D_FAILED_RETURN(out, ErrCode::kMem, "create inlier rows failed");
+        const float* in = num ? src.rowPtr(0) : nullptr;
+        float* dst = static_cast<float*>(out->base());
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t t0, size_t t1) {
+            for (size_t t = t0; t < t1; ++t) {
+                size_t o = _offsets[t];
+                for (size_t i = num * t / numTiles, end = num * (t + 1) / numTiles; i < end; ++i) {
+                    if (_keep[i]) {
+                        std::copy(in + i * 3, in + i * 3 + 3, dst + o * 3);
+                        ++o;
+                    }
+                }
+            }
+        });
+        return ErrCode::kGood;
+    }
+
+private:
+    // buckets per query tile, neighbor bricks are mostly in the same tile
+    static constexpr size_t kBucketGrain = 4096;
+    // scores per statistics chunk
+    static constexpr size_t kStatsChunk = 4096;
+    // below this, a compaction tile costs more to schedule than it saves
+    static constexpr size_t kMinTilePoints = 16384;
+    // rows per organized tile
+    static constexpr size_t kRowGrain = 16;
+
+    ErrCode source(
+        const FrameGuard& points, const FrameGuard& colorCoord, const float*& xyz, const float*& uv, size_t& num) const
+    {
+        DS3D_FAILED_RETURN(_params.radius > 0.0f, ErrCode::kParam, "outlier radius must be positive");
+        DS3D_FAILED_RETURN(
+            _params.meanK >= 1 && _params.meanK <= kOutlierMaxK, ErrCode::kParam, "outlier mean k must be 1 to %u",
+            kOutlierMaxK);
+        FrameView<const float, 3> src(points);
+        DS3D_FAILED_RETURN(src, ErrCode::kParam, "kPointXYZ frame must be CPU fp32 N x 3");
+        num = src.width();
+        xyz = num ? src.rowPtr(0) : nullptr;
+        uv = nullptr;
+        if (colorCoord) {
+            FrameView<const float, 2> uvView(colorCoord);
+            DS3D_FAILED_RETURN(
+                uvView && uvView.width() == num, ErrCode::kParam, "kPointCoordUV frame must be CPU fp32 %zu x 2", num);
+            uv = num ? uvView.rowPtr(0) : nullptr;
+        }
+        return ErrCode::kGood;
+    }
+
+    // copies the points of _keep to the output frames in input order, per tile counts give the output offsets
+    ErrCode compact(
+        const float* xyz, const float* uv, size_t num, size_t valid, FrameGuard& outPoints, FrameGuard& outCoord,
+        ThreadPool* pool)
+    {
+        uint32_t numTiles = 1;
+        if (pool) {
+            numTiles = static_cast<uint32_t>(std::min<size_t>(pool->size(), std::max<size_t>(num / kMinTilePoints, 1)));
+        }
+        auto tileBegin = [num, numTiles](size_t t) { return num * t / numTiles; };
+        _offsets.assign(numTiles + 1, 0);
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t t0, size_t t1) {
+            for (size_t t = t0; t < t1; ++t) {
+                size_t count = 0;
+                for (size_t i = tileBegin(t), end = tileBegin(t + 1); i < end; ++i) {
+                    count += _keep[i];
+                }
+                _offsets[t + 1] = count;
+            }
+        });
+        for (uint32_t t = 0; t < numTiles; ++t) {
+            _offsets[t + 1] += _offsets[t];
+        }
+        _lastRemoved = valid - _offsets[numTiles];
+
+        int32_t outNum = static_cast<int32_t>(_offsets[numTiles]);
+        outPoints = CreateFrame(Shape{2, {outNum, 3}}, DataType::kFp32, FrameType::kPointXYZ);
+        DS3D_FAILED_RETURN(outPoints, ErrCode::kMem, "create inlier points failed");
+        float* dstXYZ = static_cast<float*>(outPoints->base());
+        float* dstUV = nullptr;
+        if (uv) {
+            outCoord = CreateFrame(Shape{2, {outNum, 2}}, DataType::kFp32, FrameType::kPointCoordUV);
+            DS3D_FAILED_RETURN(outCoord, ErrCode::kMem, "create inlier color coord failed");
+            dstUV = static_cast<float*>(outCoord->base());
+        }
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t t0, size_t t1) {
+            for (size_t t = t0; t < t1; ++t) {
+                size_t o = _offsets[t];
+                for (size_t i = tileBegin(t), end = tileBegin(t + 1); i < end; ++i) {
+                    if (!_keep[i]) {
+                        continue;
+                    }
+                    dstXYZ[o * 3] = xyz[i * 3];
+                    dstXYZ[o * 3 + 1] = xyz[i * 3 + 1];
+                    dstXYZ[o * 3 + 2] = xyz[i * 3 + 2];
+                    if (dstUV) {
+                        dstUV[o * 2] = uv[i * 2];
+                        dstUV[o * 2 + 1] = uv[i * 2 + 1];
+                    }
+                    ++o;
+                }
+            }
+        });
+        return ErrCode::kGood;
+    }
+
+    // mean + stdRatio * stddev of the scores of valid points, NaN scores are skipped. Summed in
+    // fixed chunks so the threshold does not depend on the pool
+    float scoreThreshold(size_t num, ThreadPool* pool) const
+    {
+        const size_t numChunks = (num + kStatsChunk - 1) / kStatsChunk;
+        std::vector<double> sums(numChunks * 3, 0.0);
+        ThreadPool::parallelFor(pool, numChunks, 1, [&](size_t c0, size_t c1) {
+            for (size_t c = c0; c < c1; ++c) {
+                double s = 0.0, s2 = 0.0, n = 0.0;
+                for (size_t i = c * kStatsChunk, end = std::min(num, i + kStatsChunk); i < end; ++i) {
+                    if (std::isnan(_score[i])) {
+                        continue;
+                    }
+                    s += _score[i];
+                    s2 += static_cast<double>(_score[i]) * _score[i];
+                    n += 1.0;
+                }
+                sums[c * 3] = s;
+                sums[c * 3 + 1] = s2;
+                sums[c * 3 + 2] = n;
+            }
+        });
+        double s = 0.0, s2 = 0.0, n = 0.0;
+        for (size_t c = 0; c < numChunks; ++c) {
+            s += sums[c * 3];
+            s2 += sums[c * 3 + 1];
+            n += sums[c * 3 + 2];
+        }
+        const double mean = n > 0.0 ? s / n : 0.0;
+        const double var = n > 1.0 ? std::max(0.0, (s2 - s * mean) / (n - 1.0)) : 0.0;
+        return static_cast<float>(mean + _params.stdRatio * std::sqrt(var));
+    }
+
+    void scoreStatistical(ThreadPool* pool)
+    {
+        const size_t valid = _grid.size();
+        const uint32_t k = _params.meanK;
+        const float radius = _params.radius, radius2 = radius * radius;
+        _score.resize(valid);
+        ThreadPool::parallelFor(pool, _grid.numBuckets(), kBucketGrain, [&](size_t b0, size_t b1) {
+            GridCell cell;
+            float best[kOutlierMaxK];  // squared distances, ascending
+            _grid.forEachCell(b0, b1, cell, [&](const GridCell& c) {
+                for (uint32_t t = 0; t < c.size(); ++t) {
+                    uint32_t n = 0;
+                    c.query(t, radius2, [&](uint32_t, float d2) {
+                        if (n == k && d2 >= best[k - 1]) {
+                            return true;
+                        }
+                        uint32_t s = n < k ? n++ : k - 1;
+                        for (; s > 0 && best[s - 1] > d2; --s) {
+                            best[s] = best[s - 1];
+                        }
+                        best[s] = d2;
+                        return true;
+                    });
+                    float sum = static_cast<float>(k - n) * radius;
+                    for (uint32_t s = 0; s < n; ++s) {
+                        sum += std::sqrt(best[s]);
+                    }
+                    _score[c.position(t)] = sum / static_cast<float>(k);
+                }
+            });
+        });
+
+        const float threshold = scoreThreshold(valid, pool);
+        ThreadPool::parallelFor(pool, valid, kStatsChunk, [&](size_t i0, size_t i1) {
+            for (size_t i = i0; i < i1; ++i) {
+                _keep[_grid.index(i)] = _score[i] <= threshold;
+            }
+        });
+    }
+
+    void keepRadius(ThreadPool* pool)
+    {
+        const uint32_t minNeighbors = _params.minNeighbors;
+        const float radius2 = _params.radius * _params.radius;
+        ThreadPool::parallelFor(pool, _grid.numBuckets(), kBucketGrain, [&](size_t b0, size_t b1) {
+            GridCell cell;
+            _grid.forEachCell(b0, b1, cell, [&](const GridCell& c) {
+                for (uint32_t t = 0; t < c.size(); ++t) {
+                    uint32_t n = 0;
+                    if (minNeighbors) {
+                        c.query(t, radius2, [&](uint32_t, float) { return ++n < minNeighbors; });
+                    }
+                    _keep[_grid.index(c.position(t))] = n >= minNeighbors;
+                }
+            });
+        });
+    }
+
+    // planar rows padded by window rows and columns on every side, invalid points and the padding
+    // are at infinity so they are never within radius. Returns the valid points
+    size_t toPlanar(const float* xyz, uint32_t width, uint32_t height, ThreadPool* pool)
+    {
+        const uint32_t pad = _params.window, stride = width + 2 * pad;
+        const float inf = std::numeric_limits<float>::infinity();
+        _x.assign(static_cast<size_t>(stride) * (height + 2 * pad), inf);
+        _y.assign(_x.size(), inf);
+        _z.assign(_x.size(), inf);
+        _rowValid.resize(height);
+        ThreadPool::parallelFor(pool, height, kRowGrain, [&](size_t r0, size_t r1) {
+            for (size_t row = r0; row < r1; ++row) {
+                const size_t i = (row + pad) * stride + pad;
+                float *x = _x.data() + i, *y = _y.data() + i, *z = _z.data() + i;
+                uint32_t count = 0;
+                const float* p = xyz + row * width * 3;
+                for (uint32_t c = 0; c < width; ++c, p += 3) {
+                    const bool zero = p[0] == 0.0f && p[1] == 0.0f && p[2] == 0.0f;
+                    if (zero || !std::isfinite(p[0]) || !std::isfinite(p[1]) || !std::isfinite(p[2])) {
+                        continue;
+                    }
+                    x[c] = p[0];
+                    y[c] = p[1];
+                    z[c] = p[2];
+                    ++count;
+                }
+                _rowValid[row] = count;
+            }
+        });
+        size_t valid = 0;
+        for (uint32_t count : _rowValid) {
+            valid += count;
+        }
+        return valid;
+    }
+
+    // window of the padded planar rows, nearest pixels first
+    WindowQuery windowQuery(uint32_t width)
+    {
+        const int32_t w = static_cast<int32_t>(_params.window);
+        const ptrdiff_t stride = width + 2 * w;
+        std::vector<std::pair<int32_t, int32_t>> window;
+        for (int32_t dy = -w; dy <= w; ++dy) {
+            for (int32_t dx = -w; dx <= w; ++dx) {
+                if (dx || dy) {
+                    window.emplace_back(dx, dy);
+                }
+            }
+        }
+        std::stable_sort(window.begin(), window.end(), [](const auto& a, const auto& b) {
+            return a.first * a.first + a.second * a.second < b.first * b.first + b.second * b.second;
+        });
+        _window.clear();
+        for (const auto& [dx, dy] : window) {
+            _window.push_back(dy * stride + dx);
+        }
+        WindowQuery q;
+        q.x = _x.data();
+        q.y = _y.data();
+        q.z = _z.data();
+        q.offsets = _window.data();
+        q.numOffsets = static_cast<uint32_t>(_window.size());
+        q.radius2 = _params.radius * _params.radius;
+        return q;
+    }
+
+    OutlierRemovalParams _params;
+    PointGrid _grid;
+    std::vector<float> _score;  // grid order, input order for organized clouds
+    std::vector<uint8_t> _keep;  // input order
+    std::vector<size_t> _offsets;  // per compaction tile output offsets
+    std::vector<float> _x, _y, _z;  // organized clouds, padded planar rows
+    std::vector<uint32_t> _rowValid;  // organized clouds, valid points per row
+    std::vector<ptrdiff_t> _window;  // organized clouds, window offsets in the planar rows
+    size_t _lastRemoved = 0;
+};
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_OUTLIER_REMOVAL_HPP
@@ -0,0 +1,244 @@
+#ifndef DS3D_COMMON_HPP_OVERLAY_DATAMAP_HPP
+#define DS3D_COMMON_HPP_OVERLAY_DATAMAP_HPP
+
+#include "3d/common/abi_obj.h"
+#include "3d/common/common.h"
+#include "3d/common/func_utils.h"
+
+#include "datamap.hpp"
+#include "flat_datamap.hpp"
+
+#include <vector>
+
+/**
+ * @file OverlayDataMap is a copy-on-write abiDataMapV2 layered on top of a parent datamap
+ */
+
+namespace ds3d {
+
+/**
+ * @brief OverlayDataMap references a parent datamap and stores only the keys
+ *   it adds, overrides or removes. Reads which miss the local keys fall
+ *   through to the parent, so a filter which only adds kPointXYZ does not
+ *   have to copy depth, color, intrinsics... into its output. Chained
+ *   filters stack overlays, each stage costs only its own keys.
+ *   The parent is treated as read-only, writes never reach it: a removed
+ *   parent key is hidden by a local tombstone and clear_i() hides the whole
+ *   parent. The parent is expected not to change once it has been overlaid.
+ *
+ *   For example, in abiDataFilter::process_i:
+ *     GuardDataMap input(*inputData);
+ *     GuardDataMap output = CreateOverlayDataMap(input);
+ *     output.setGuardData(kPointXYZ, points);
+ *     output.getGuardData(kDepthFrame, depth); // served by input
+ *   The pipeline frames are legacy DeepStream datamaps, an overlay of those
+ *   is writable but can never be frozen. A FlatDataMap parent which is
+ *   frozen is the case MakeWritableDataMap is for.
+ */
+class OverlayDataMap : public abiDataMapV2 {
+public:
+    explicit OverlayDataMap(const GuardDataMap& parent, uint32_t capacity = FlatDataMap::kDefaultCapacity)
+        : _parent(parent), _parentV2(parent ? parent.mapV2() : nullptr), _local(capacity)
+    {
+    }
+    ~OverlayDataMap() override = default;
+
+    // abiDataMap string-keyed interface
+    ErrCode setBuf_i(const char* key, TIdType tid, abiRefAny* data) override
+    {
+        DS3D_FAILED_RETURN(key, ErrCode::kParam, "datamap key must not be null");
+        return setBufKey_i(DataKey(key), tid, data);
+    }
+    ErrCode getBuf_i(const char* key, TIdType tid, const abiRefAny*& data) const override
+    {
+        DS3D_FAILED_RETURN(key, ErrCode::kParam, "datamap key must not be null");
+        return getBufKey_i(DataKey(key), tid, data);
+    }
+    ErrCode removeBuf_i(const char* key) override
+    {
+        DS3D_FAILED_RETURN(key, ErrCode::kParam, "datamap key must not be null");
+        return removeBufKey_i(DataKey(key));
+    }
+    bool has_i(const char* key) const override { return key && hasKey_i(DataKey(key)); }
+
+    ErrCode clear_i() override
+    {
+        DS3D_FAILED_RETURN(!frozen_i(), ErrCode::kState, "datamap is frozen, clear failed");
+        _local.clear_i();
+        _removed.clear();
+        _hideParent = true;
+        return ErrCode::kGood;
+    }
+
+    // abiDataMapV2 hashed-key interface
+    ErrCode setBufKey_i(const DataKey& key, TIdType tid, abiRefAny* data) override
+    {
+        ErrCode code = _local.setBufKey_i(key, tid, data);
+        if (isGood(code)) {
+            unhide(key);
+        }
+        return code;
+    }
+
+    ErrCode setValueKey_i(const DataKey& key, TIdType tid, const void* value, uint32_t bytes) override
+    {
+        ErrCode code = _local.setValueKey_i(key, tid, value, bytes);
+        if (isGood(code)) {
+            unhide(key);
+        }
+        return code;
+    }
+
+    ErrCode getBufKey_i(const DataKey& key, TIdType tid, const abiRefAny*& data) const override
+    {
+        if (_local.hasKey_i(key)) {
+            return _local.getBufKey_i(key, tid, data);
+        }
+        if (hidden(key)) {
+            return ErrCode::kNotFound;
+        }
+        return parentGet(key, tid, data);
+    }
+
+    ErrCode removeBufKey_i(const DataKey& key) override
+    {
+        DS3D_FAILED_RETURN(!frozen_i(), ErrCode::kState, "datamap is frozen, remove key: %s failed", key.name);
+        ErrCode code = _local.removeBufKey_i(key);
+        if (!hidden(key) && parentHas(key)) {
+            _removed.push_back(Tombstone{key.hash, KeyTable::intern(key)});
+            return ErrCode::kGood;
+        }
+        return code;
+    }
+
+    bool hasKey_i(const DataKey& key) const override
+    {
+        if (_local.hasKey_i(key)) {
+            return true;
+        }
+        return !hidden(key) && parentHas(key);
+    }
+
+    ErrCode getBufKeys_i(DataKeyQuery* queries, uint32_t num) const override
+    {
+        ErrCode code = _local.getBufKeys_i(queries, num);
+        if (!isGood(code)) {
+            return code;
+        }
+        for (uint32_t i = 0; i < num; ++i) {
+            DataKeyQuery& q = queries[i];
+            if (q.code != ErrCode::kNotFound || hidden(*q.key)) {
+                continue;
+            }
+            q.data = nullptr;
+            q.code = parentGet(*q.key, q.tid, q.data);
+        }
+        return ErrCode::kGood;
+    }
+
+
+    ErrCode enumerate_i(abiEnumEntryCB* cb) const override
+    {
+        ErrCode code = _local.enumerate_i(cb);
+        if (!isGood(code) || _hideParent || !_parent) {
+            return code;
+        }
+        return _parent.forEach([this, cb](const DataMapEntry& entry) {
+            DataKey key(entry.key);
+            if (_local.hasKey_i(key) || hidden(key)) {
+                return;
+            }
+            DataMapEntry e = entry;
+            cb->notify(&e);
+        });
+    }
+
+    // reads fall through to the parent, so the overlay is only read-only once
+    // the parent is. The parent is never frozen from here, it is not ours,
+    // and a legacy parent (any DeepStream frame) fails with kState.
+    ErrCode freeze_i() override
+    {
+        DS3D_FAILED_RETURN(parentFrozen(), ErrCode::kState, "overlay datamap parent is not frozen, freeze failed");
+        return _local.freeze_i();
+    }
+    bool frozen_i() const override { return _local.frozen_i() && parentFrozen(); }
+
+    // number of keys stored by this layer, the parent keys are not counted
+    uint32_t localSize() const { return _local.size(); }
+    const GuardDataMap& parent() const { return _parent; }
+
+private:
+    struct Tombstone {
+        uint64_t hash;
+        const char* name;  // interned
+    };
+
+    // a legacy parent can not be frozen
+    bool parentFrozen() const { return _hideParent || !_parent || (_parentV2 && _parentV2->frozen_i()); }
+
+    bool hidden(const DataKey& key) const
+    {
+        if (_hideParent || !_parent) {
+            return true;
+        }
+        for (const auto& t : _removed) {
+            if (t.hash == key.hash && (t.name == key.name || !strcmp(t.name, key.name))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void unhide(const DataKey& key)
+    {
+        for (auto it = _removed.begin(); it != _removed.end(); ++it) {
+            if (it->hash == key.hash && !strcmp(it->name, key.name)) {
+                _removed.erase(it);
+                return;
+            }
+        }
+    }
+
+    bool parentHas(const DataKey& key) const
+    {
+        if (!_parent) {
+            return false;
+        }
+        return _parentV2 ? _parentV2->hasKey_i(key) : _parent.ptr()->has_i(key.name);
+    }
+
+    ErrCode parentGet(const DataKey& key, TIdType tid, const abiRefAny*& data) const
+    {
+        DS_ASSERT(_parent);
+        return _parentV2 ? _parentV2->getBufKey_i(key, tid, data)
+                         : _parent.ptr()->getBuf_i(key.name, tid, data);
+    }
+
+    GuardDataMap _parent;
+    abiDataMapV2* _parentV2 = nullptr;
+    FlatDataMap _local;
+    std::vector<Tombstone> _removed;
+    bool _hideParent = false;
+};
+
+// create a datamap which reads through to parent and keeps its own changes locally
+inline GuardDataMap
+CreateOverlayDataMap(const GuardDataMap& parent, uint32_t capacity = FlatDataMap::kDefaultCapacity)
+{
+    return GuardDataMap(NewAbiRef<abiDataMap>(new OverlayDataMap(parent, capacity)), true);
+}
+
+// return map itself while it is writable, otherwise a new overlay on top of it
+// which takes the late writes, e.g. a filter adding keys to a frozen frame.
+inline GuardDataMap
+MakeWritableDataMap(const GuardDataMap& map)
+{
+    if (!map.frozen()) {
+        return map;
+    }
+    return CreateOverlayDataMap(map);
+}
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_OVERLAY_DATAMAP_HPP
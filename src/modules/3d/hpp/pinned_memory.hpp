@@ -0,0 +1,161 @@
+#ifndef DS3D_COMMON_HPP_PINNED_MEMORY_HPP
+#define DS3D_COMMON_HPP_PINNED_MEMORY_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/func_utils.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+
+/**
+ * @file CPU pinned frame memory (MemType::kCpuPinned) backed by huge pages and mlock
+ */
+
+namespace ds3d {
+
+// memory behind the frames of a FramePool, e.g. `mem_type: pinned` in a config_body
+enum class FrameMemory : int {
+    kCpu = 0,     // AlignedAlloc, MemType::kCpu
+    kPinned = 1,  // PinnedAlloc, MemType::kCpuPinned
+};
+
+inline bool
+frameMemoryFromString(const std::string& str, FrameMemory& memory)
+{
+    if (str == "cpu") {
+        memory = FrameMemory::kCpu;
+    } else if (str == "pinned") {
+        memory = FrameMemory::kPinned;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline MemType
+frameMemType(FrameMemory memory)
+{
+    return memory == FrameMemory::kPinned ? MemType::kCpuPinned : MemType::kCpu;
+}
+
+constexpr size_t kHugePageBytes = 2 * 1024 * 1024;
+
+// bytes currently held by PinnedAlloc, by backing. A buffer which could be
+// neither locked nor mapped on huge pages shows up in pageable only.
+struct PinnedMemoryStats {
+    std::atomic<uint64_t> hugeTlb{0};      // MAP_HUGETLB, reserved huge pages
+    std::atomic<uint64_t> transparent{0};  // MADV_HUGEPAGE hint on regular pages
+    std::atomic<uint64_t> locked{0};       // mlock'd, no page faults after allocation
+    std::atomic<uint64_t> pageable{0};     // mlock failed, e.g. RLIMIT_MEMLOCK
+
+    static PinnedMemoryStats& instance()
+    {
+        static PinnedMemoryStats stats;
+        return stats;
+    }
+};
+
+namespace detail {
+
+// stored in front of every PinnedAlloc buffer, one kFrameAlignment block
+struct alignas(kFrameAlignment) PinnedHeader {
+    size_t mapBytes = 0;
+    bool hugeTlb = false;
+    bool locked = false;
+};
+
+inline void
+pinnedAccount(const PinnedHeader& h, bool add)
+{
+    PinnedMemoryStats& stats = PinnedMemoryStats::instance();
+    uint64_t bytes = h.mapBytes;
+    auto update = [add, bytes](std::atomic<uint64_t>& v) {
+        add ? v.fetch_add(bytes, std::memory_order_relaxed) : v.fetch_sub(bytes, std::memory_order_relaxed);
+    };
+    update(h.hugeTlb ? stats.hugeTlb : stats.transparent);
+    update(h.locked ? stats.locked : stats.pageable);
+}
+
+}  // namespace detail
+
+/**
+ * @brief allocate page-resident CPU memory for frames shared by several threads.
+ *   Buffers of at least one huge page are first mapped with MAP_HUGETLB
+ *   (needs reserved pages, /proc/sys/vm/nr_hugepages). Otherwise regular
+ *   pages are mapped with a transparent huge page hint. The mapping is
+ *   mlock'd, which also faults every page in, so the pipeline does not pay
+ *   first-touch page faults. If mlock is not permitted (RLIMIT_MEMLOCK) the
+ *   pages are touched once and stay pageable. The result is kFrameAlignment
+ *   aligned, release it with PinnedFree. See PinnedMemoryStats for the outcome.
+ */
+inline void*
+PinnedAlloc(size_t bytes)
+{
+    DS3D_FAILED_RETURN(bytes, nullptr, "pinned allocation of 0 bytes");
+    size_t total = bytes + sizeof(detail::PinnedHeader);
+    detail::PinnedHeader header;
+    void* map = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (total >= kHugePageBytes) {
+        header.mapBytes = alignUp(total, kHugePageBytes);
+        map = mmap(nullptr, header.mapBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        header.hugeTlb = (map != MAP_FAILED);
+    }
+#endif
+    if (map == MAP_FAILED) {
+        header.mapBytes = alignUp(total, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+        map = mmap(nullptr, header.mapBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        DS3D_FAILED_RETURN(map != MAP_FAILED, nullptr, "mmap %zu bytes failed, errno: %d", header.mapBytes, errno);
+#ifdef MADV_HUGEPAGE
+        if (header.mapBytes >= kHugePageBytes) {
+            madvise(map, header.mapBytes, MADV_HUGEPAGE);
+        }
+#endif
+    }
+    header.locked = !mlock(map, header.mapBytes);
+    if (!header.locked) {
+        LOG_DEBUG("mlock %zu bytes failed, errno: %d. pinned memory stays pageable", header.mapBytes, errno);
+        size_t page = header.hugeTlb ? kHugePageBytes : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        for (size_t i = 0; i < header.mapBytes; i += page) {
+            static_cast<volatile uint8_t*>(map)[i] = 0;
+        }
+    }
+    detail::pinnedAccount(header, true);
+    auto* h = new (map) detail::PinnedHeader(header);
+    return h + 1;
+}
+
+inline void
+PinnedFree(void* ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    auto* h = static_cast<detail::PinnedHeader*>(ptr) - 1;
+    detail::PinnedHeader header = *h;
+    detail::pinnedAccount(header, false);
+    if (header.locked) {
+        munlock(h, header.mapBytes);
+    }
+    munmap(h, header.mapBytes);
+}
+
+// allocator and deleter of a FrameMemory, buffers are kFrameAlignment aligned
+inline void*
+FrameMemoryAlloc(FrameMemory memory, size_t bytes)
+{
+    return memory == FrameMemory::kPinned ? PinnedAlloc(bytes) : AlignedAlloc(bytes);
+}
+
+using FrameMemoryFreeF = void (*)(void*);
+inline FrameMemoryFreeF
+FrameMemoryFree(FrameMemory memory)
+{
+    return memory == FrameMemory::kPinned ? &PinnedFree : &AlignedFree;
+}
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_PINNED_MEMORY_HPP
@@ -0,0 +1,197 @@
+#ifndef DS3D_COMMON_HPP_POINT_CROP_HPP
+#define DS3D_COMMON_HPP_POINT_CROP_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/point_crop.h"
+
+#include "frame.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * @file box, range and view frustum crop of kPointXYZ (and kPointCoordUV) frames
+ */
+
+namespace ds3d {
+
+// regions in the camera frame of the points: x right, y down, z forward. Enabled regions are intersected.
+struct PointCropParams {
+    bool box = false;
+    float boxMin[3] = {0.0f, 0.0f, 0.0f};
+    float boxMax[3] = {0.0f, 0.0f, 0.0f};
+    bool range = false;  // distance to the camera
+    float minRange = 0.0f;
+    float maxRange = 0.0f;
+    bool frustum = false;  // camera at the origin looking along +z, like the render near/far/fov
+    float near = 0.01f;
+    float far = 10.0f;
+    float fov = 40.0f;  // vertical, in degrees
+    float aspect = 16.0f / 9.0f;  // width / height
+};
+
+/**
+ * @brief PointCrop keeps the points of a cloud inside a box, a distance
+ *   range and a view frustum, and their color coordinates with them, in
+ *   input order. Invalid points, (0, 0, 0) or non-finite, are dropped.
+ *   Tiles are classified in parallel into 16 point masks, then compacted
+ *   at their offsets. When every point is kept the input frames are
+ *   returned as is. Masks are kept between frames, compactRows() applies
+ *   them to other per point frames of the same cloud, e.g. kPointNormal.
+ *   Not thread-safe, use one PointCrop per stream.
+ */
+class PointCrop {
+public:
+    explicit PointCrop(const PointCropParams& params = PointCropParams()) : _params(params) {}
+
+    const PointCropParams& params() const { return _params; }
+
+    // colorCoord may be empty, outCoord is only set when it is not
+    ErrCode crop(
+        const FrameGuard& points, const FrameGuard& colorCoord, FrameGuard& outPoints, FrameGuard& outCoord,
+        ThreadPool* pool = nullptr)
+    {
+        CropBounds bounds;
+        DS3D_ERROR_RETURN(makeBounds(bounds), "invalid crop region");
+        FrameView<const float, 3> src(points);
+        DS3D_FAILED_RETURN(src, ErrCode::kParam, "kPointXYZ frame must be CPU fp32 N x 3");
+        const size_t num = src.width();
+        const float* xyz = num ? src.rowPtr(0) : nullptr;
+        const float* uv = nullptr;
+        if (colorCoord) {
+            FrameView<const float, 2> uvView(colorCoord);
+            DS3D_FAILED_RETURN(
+                uvView && uvView.width() == num, ErrCode::kParam, "kPointCoordUV frame must be CPU fp32 %zu x 2", num);
+            uv = num ? uvView.rowPtr(0) : nullptr;
+        }
+
+        // tiles of whole mask words
+        const size_t numWords = (num + kCropWordPoints - 1) / kCropWordPoints;
+        uint32_t numTiles = 1;
+        if (pool) {
+            numTiles = static_cast<uint32_t>(std::min<size_t>(pool->size(), std::max<size_t>(num / kMinTilePoints, 1)));
+        }
+        auto tileBegin = [num, numWords, numTiles](size_t t) {
+            return std::min(num, numWords * t / numTiles * kCropWordPoints);
+        };
+        _masks.resize(numWords);
+        _num = num;
+        _offsets.assign(numTiles + 1, 0);
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t t0, size_t t1) {
+            for (size_t t = t0; t < t1; ++t) {
+                _offsets[t + 1] = CropClassify(xyz, tileBegin(t), tileBegin(t + 1), bounds, _masks.data());
+            }
+        });
+        for (uint32_t t = 0; t < numTiles; ++t) {
+            _offsets[t + 1] += _offsets[t];
+        }
+        const size_t kept = _offsets[numTiles];
+        _lastRemoved = num - kept;
+        if (kept == num) {
+            outPoints = points;
+            outCoord = colorCoord;
+            return ErrCode::kGood;
+        }
+
+        int32_t outNum = static_cast<int32_t>(kept);
+        outPoints = CreateFrame(Shape{2, {outNum, 3}}, DataType::kFp32, FrameType::kPointXYZ);
+        DS3D_FAILED_RETURN(outPoints, ErrCode::kMem, "create cropped points failed");
+        float* dstXYZ = static_cast<float*>(outPoints->base());
+        float* dstUV = nullptr;
+        if (uv) {
+            outCoord = CreateFrame(Shape{2, {outNum, 2}}, DataType::kFp32, FrameType::kPointCoordUV);
+            DS3D_FAILED_RETURN(outCoord, ErrCode::kMem, "create cropped color coord failed");
+            dstUV = static_cast<float*>(outCoord->base());
+        }
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t t0, size_t t1) {
+            for (size_t t = t0; t < t1; ++t) {
+                CropCompact(
+                    xyz, uv, _masks.data(), tileBegin(t), tileBegin(t + 1), dstXYZ + _offsets[t] * 3,
+                    dstUV ? dstUV + _offsets[t] * 2 : nullptr);
+            }
+        });
+        return ErrCode::kGood;
+    }
+
+    // points dropped by the last crop(), invalid ones included
+    size_t lastRemoved() const { return _lastRemoved; }
+
+    // keeps the rows of the last crop() points in a CPU fp32 N x 3 frame of the same cloud, e.g.
+    // kPointNormal. rows is returned as is when every point was kept
+    ErrCode compactRows(const FrameGuard& rows, FrameType type, FrameGuard& out, ThreadPool* pool = nullptr) const
+    {
+        DS3D_FAILED_RETURN(!_offsets.empty(), ErrCode::kState, "no cropped points to compact rows of");
+        FrameView<const float, 3> src(rows);
+        DS3D_FAILED_RETURN(
+            src && src.width() == _num, ErrCode::kParam,
+            "per point frame must be CPU fp32 %zu x 3 like the cropped points", _num);
+        const size_t kept = _num - _lastRemoved;
+        if (kept == _num) {
+            out = rows;
+            return ErrCode::kGood;
+        }
+        out = CreateFrame(Shape{2, {static_cast<int32_t>(kept), 3}}, DataType::kFp32, type);
+        DS3D_FAILED_RETURN(out, ErrCode::kMem, "create cropped rows failed");
+        const float* in = src.rowPtr(0);
+        float* dst = static_cast<float*>(out->base());
+        const size_t numWords = _masks.size();
+        const uint32_t numTiles = static_cast<uint32_t>(_offsets.size() - 1);
+        auto tileBegin = [this, numWords, numTiles](size_t t) {
+            return std::min(_num, numWords * t / numTiles * kCropWordPoints);
+        };
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t t0, size_t t1) {
+            for (size_t t = t0; t < t1; ++t) {
+                CropCompact(in, nullptr, _masks.data(), tileBegin(t), tileBegin(t + 1), dst + _offsets[t] * 3, nullptr);
+            }
+        });
+        return ErrCode::kGood;
+    }
+
+    // kernel bounds of the enabled regions, fails on an invalid region
+    ErrCode makeBounds(CropBounds& b) const
+    {
+        const PointCropParams& p = _params;
+        if (p.box) {
+            for (int a = 0; a < 3; ++a) {
+                DS3D_FAILED_RETURN(p.boxMin[a] <= p.boxMax[a], ErrCode::kParam, "crop box min must not exceed max");
+                b.lo[a] = p.boxMin[a];
+                b.hi[a] = p.boxMax[a];
+            }
+        }
+        if (p.range) {
+            DS3D_FAILED_RETURN(
+                p.minRange >= 0.0f && p.minRange <= p.maxRange, ErrCode::kParam, "crop range must be 0 <= min <= max");
+            b.minDist2 = std::max(b.minDist2, p.minRange * p.minRange);
+            b.maxDist2 = std::min(b.maxDist2, p.maxRange * p.maxRange);
+        }
+        if (p.frustum) {
+            DS3D_FAILED_RETURN(
+                p.near >= 0.0f && p.near < p.far, ErrCode::kParam, "crop frustum must be 0 <= near < far");
+            DS3D_FAILED_RETURN(
+                p.fov > 0.0f && p.fov < 180.0f && p.aspect > 0.0f, ErrCode::kParam,
+                "crop frustum fov must be in (0, 180) and aspect positive");
+            b.lo[2] = std::max(b.lo[2], p.near);
+            b.hi[2] = std::min(b.hi[2], p.far);
+            b.slopeY = std::tan(p.fov * 0.5f * static_cast<float>(M_PI) / 180.0f);
+            b.slopeX = b.slopeY * p.aspect;
+            b.slack = 0.0f;
+        }
+        return ErrCode::kGood;
+    }
+
+private:
+    // below this, a tile costs more to schedule than it saves
+    static constexpr size_t kMinTilePoints = 32768;
+
+    PointCropParams _params;
+    std::vector<uint16_t> _masks;
+    std::vector<size_t> _offsets;  // per tile output offsets of the last crop()
+    size_t _num = 0;  // points of the last crop()
+    size_t _lastRemoved = 0;
+};
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_POINT_CROP_HPP
@@ -0,0 +1,259 @@
+#ifndef DS3D_COMMON_HPP_POINT_FRAME_HPP
+#define DS3D_COMMON_HPP_POINT_FRAME_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/half.h"
+#include "3d/common/point_codec.h"
+#include "3d/common/point_layout.h"
+
+#include "datamap.hpp"
+#include "frame.hpp"
+
+/**
+ * @file interleaved (kPointXYZ), planar (kPointXYZPlanar) and compact (kPointXYZCompact) point cloud frames
+ */
+
+namespace ds3d {
+
+/**
+ * @brief planar point clouds are 2D frames of 3 rows (X, Y, Z) of N floats,
+ *   shape {3, N, 1}, FrameType::kPointXYZPlanar. Every row starts on a
+ *   kFrameAlignment boundary, so kernels can run a full vector width over
+ *   one coordinate. FrameView<float> row(0..2) gives the X, Y, Z spans.
+ *   A Frame2DPool of Shape{3, {3, N, 1}} hands out the same layout.
+ *   A datamap carries one layout of its cloud, kPointXYZ, kPointXYZPlanar
+ *   or kPointXYZCompact: the SetPointXYZ* functions remove the others.
+ */
+inline Frame2DGuard
+CreatePointXYZPlanarFrame(uint32_t numPoints)
+{
+    return Create2DFrame(numPoints, 3, 1, DataType::kFp32, FrameType::kPointXYZPlanar);
+}
+
+// N x 3 interleaved -> 3 x N planar, into a frame of the same number of points, e.g. from a Frame2DPool
+inline ErrCode
+ToPointXYZPlanar(const FrameGuard& points, Frame2DGuard& planar)
+{
+    FrameView<const float, 3> src(points);
+    DS3D_FAILED_RETURN(src, ErrCode::kParam, "kPointXYZ frame must be CPU fp32 N x 3");
+    FrameView<float> dst(planar);
+    DS3D_FAILED_RETURN(
+        dst && dst.height() == 3 && dst.width() == src.width(), ErrCode::kParam,
+        "kPointXYZPlanar frame must be CPU fp32 3 x %u", src.width());
+    PointXYZToPlanar(src.rowPtr(0), dst.rowPtr(0), dst.rowPtr(1), dst.rowPtr(2), src.width());
+    return ErrCode::kGood;
+}
+
+// N x 3 interleaved -> 3 x N planar
+inline Frame2DGuard
+ToPointXYZPlanar(const FrameGuard& points)
+{
+    FrameView<const float, 3> src(points);
+    DS3D_FAILED_RETURN(src, Frame2DGuard(), "kPointXYZ frame must be CPU fp32 N x 3");
+    DS3D_FAILED_RETURN(src.width(), Frame2DGuard(), "kPointXYZ frame is empty");
+    Frame2DGuard planar = CreatePointXYZPlanarFrame(src.width());
+    DS3D_FAILED_RETURN(planar, Frame2DGuard(), "create planar points failed");
+    DS3D_FAILED_RETURN(isGood(ToPointXYZPlanar(points, planar)), Frame2DGuard(), "transpose points failed");
+    return planar;
+}
+
+// 3 x N planar -> N x 3 interleaved, for consumers which need kPointXYZ
+inline FrameGuard
+ToPointXYZ(const Frame2DGuard& planar)
+{
+    FrameView<const float> src(planar);
+    DS3D_FAILED_RETURN(src && src.height() == 3, FrameGuard(), "kPointXYZPlanar frame must be CPU fp32 3 x N");
+    uint32_t num = src.width();
+    DS3D_FAILED_RETURN(num, FrameGuard(), "kPointXYZPlanar frame is empty");
+    FrameGuard points = CreateFrame(Shape{2, {static_cast<int32_t>(num), 3}}, DataType::kFp32, FrameType::kPointXYZ);
+    DS3D_FAILED_RETURN(points, FrameGuard(), "create interleaved points failed");
+    PlanarToPointXYZ(src.rowPtr(0), src.rowPtr(1), src.rowPtr(2), static_cast<float*>(points->base()), num);
+    return points;
+}
+
+/**
+ * @brief compact point clouds halve the bytes of kPointXYZ through queues and
+ *   dumps. They are N x 3 FrameType::kPointXYZ frames of either
+ *   DataType::kFp16, or DataType::kInt16 quantized per frame with the
+ *   kPointQuantParam stored next to them (step = axis range / 65534, e.g.
+ *   0.15 mm for a 10 m range). Use SetPointXYZCompact to publish them and
+ *   GetPointXYZ to read fp32 points back whatever the stored layout.
+ *   The conversions either allocate the frame or write into one of the
+ *   same number of points, e.g. from a FramePool.
+ */
+inline ErrCode
+ToPointXYZHalf(const FrameGuard& points, FrameGuard& half)
+{
+    FrameView<const float, 3> src(points);
+    DS3D_FAILED_RETURN(src, ErrCode::kParam, "kPointXYZ frame must be CPU fp32 N x 3");
+    FrameView<Half, 3> dst(half);
+    DS3D_FAILED_RETURN(
+        dst && dst.width() == src.width(), ErrCode::kParam, "fp16 points frame must be CPU %u x 3", src.width());
+    FloatToHalf(src.rowPtr(0), dst.rowPtr(0), src.row(0).size());
+    return ErrCode::kGood;
+}
+
+inline FrameGuard
+ToPointXYZHalf(const FrameGuard& points)
+{
+    FrameView<const float, 3> src(points);
+    DS3D_FAILED_RETURN(src && src.width(), FrameGuard(), "kPointXYZ frame must be CPU fp32 N x 3");
+    FrameGuard half = CreateFrame(points->shape(), DataType::kFp16, FrameType::kPointXYZ);
+    DS3D_FAILED_RETURN(half, FrameGuard(), "create fp16 points failed");
+    DS3D_FAILED_RETURN(isGood(ToPointXYZHalf(points, half)), FrameGuard(), "convert points to fp16 failed");
+    return half;
+}
+
+// quantize to int16 with the bounds of this frame, param receives the decoding parameters
+inline ErrCode
+ToPointXYZQuant(const FrameGuard& points, FrameGuard& quant, PointQuantParam& param)
+{
+    FrameView<const float, 3> src(points);
+    DS3D_FAILED_RETURN(src, ErrCode::kParam, "kPointXYZ frame must be CPU fp32 N x 3");
+    FrameView<int16_t, 3> dst(quant);
+    DS3D_FAILED_RETURN(
+        dst && dst.width() == src.width(), ErrCode::kParam, "int16 points frame must be CPU %u x 3", src.width());
+    vec3f minV, maxV;
+    PointXYZBounds(src.rowPtr(0), src.width(), minV, maxV);
+    param = PointQuantParamFromBounds(minV, maxV);
+    QuantizePointXYZ(src.rowPtr(0), dst.rowPtr(0), src.width(), param);
+    return ErrCode::kGood;
+}
+
+inline FrameGuard
+ToPointXYZQuant(const FrameGuard& points, PointQuantParam& param)
+{
+    FrameView<const float, 3> src(points);
+    DS3D_FAILED_RETURN(src && src.width(), FrameGuard(), "kPointXYZ frame must be CPU fp32 N x 3");
+    FrameGuard quant = CreateFrame(points->shape(), DataType::kInt16, FrameType::kPointXYZ);
+    DS3D_FAILED_RETURN(quant, FrameGuard(), "create int16 points failed");
+    DS3D_FAILED_RETURN(isGood(ToPointXYZQuant(points, quant, param)), FrameGuard(), "quantize points failed");
+    return quant;
+}
+
+// decode a compact frame to fp32 N x 3, param is required for int16 frames only
+inline FrameGuard
+FromPointXYZCompact(const FrameGuard& compact, const PointQuantParam* param)
+{
+    DS3D_FAILED_RETURN(compact, FrameGuard(), "compact points frame is empty");
+    FrameGuard points = CreateFrame(compact->shape(), DataType::kFp32, FrameType::kPointXYZ);
+    DS3D_FAILED_RETURN(points, FrameGuard(), "create fp32 points failed");
+    float* dst = static_cast<float*>(points->base());
+    if (compact->dataType() == DataType::kFp16) {
+        FrameView<const Half, 3> src(compact);
+        DS3D_FAILED_RETURN(src && src.width(), FrameGuard(), "fp16 points must be CPU N x 3");
+        HalfToFloat(src.rowPtr(0), dst, src.row(0).size());
+        return points;
+    }
+    FrameView<const int16_t, 3> src(compact);
+    DS3D_FAILED_RETURN(src && src.width(), FrameGuard(), "compact points must be CPU fp16 or int16 N x 3");
+    DS3D_FAILED_RETURN(param, FrameGuard(), "int16 points need kPointQuantParam");
+    DequantizePointXYZ(src.rowPtr(0), dst, src.width(), *param);
+    return points;
+}
+
+namespace detail {
+
+template <typename K>
+inline ErrCode
+removePointLayout(GuardDataMap& datamap, const Key<K>& key)
+{
+    if (!datamap.hasData(key.name)) {
+        return ErrCode::kGood;
+    }
+    DS3D_ERROR_RETURN(datamap.removeData(key), "remove stale %s failed", key.name);
+    return ErrCode::kGood;
+}
+
+}  // namespace detail
+
+// publish fp32 N x 3 points as kPointXYZ, e.g. after a filter rewrote the
+// cloud. kPointXYZPlanar, kPointXYZCompact and kPointQuantParam are removed.
+inline ErrCode
+SetPointXYZ(GuardDataMap& datamap, const FrameGuard& points)
+{
+    DS3D_ERROR_RETURN(datamap.setGuardData(kPointXYZ, points), "set kPointXYZ failed");
+    DS3D_ERROR_RETURN(detail::removePointLayout(datamap, kPointXYZPlanar), "remove kPointXYZPlanar failed");
+    DS3D_ERROR_RETURN(detail::removePointLayout(datamap, kPointXYZCompact), "remove kPointXYZCompact failed");
+    return detail::removePointLayout(datamap, kPointQuantParam);
+}
+
+// publish a planar cloud as kPointXYZPlanar, the other layouts are removed
+inline ErrCode
+SetPointXYZPlanar(GuardDataMap& datamap, const Frame2DGuard& planar)
+{
+    DS3D_ERROR_RETURN(datamap.setGuardData(kPointXYZPlanar, planar), "set kPointXYZPlanar failed");
+    DS3D_ERROR_RETURN(detail::removePointLayout(datamap, kPointXYZ), "remove kPointXYZ failed");
+    DS3D_ERROR_RETURN(detail::removePointLayout(datamap, kPointXYZCompact), "remove kPointXYZCompact failed");
+    return detail::removePointLayout(datamap, kPointQuantParam);
+}
+
+// publish a compact cloud as kPointXYZCompact, param is required for kInt16
+// frames. The other layouts are removed.
+inline ErrCode
+SetPointXYZCompact(GuardDataMap& datamap, const FrameGuard& compact, const PointQuantParam* param)
+{
+    DS3D_FAILED_RETURN(compact, ErrCode::kParam, "compact points frame is empty");
+    if (compact->dataType() == DataType::kInt16) {
+        DS3D_FAILED_RETURN(param, ErrCode::kParam, "int16 points need kPointQuantParam");
+        DS3D_ERROR_RETURN(datamap.setData(kPointQuantParam, *param), "set kPointQuantParam failed");
+    } else {
+        DS3D_FAILED_RETURN(
+            compact->dataType() == DataType::kFp16, ErrCode::kParam, "compact points support kFp16 and kInt16 only");
+        DS3D_ERROR_RETURN(detail::removePointLayout(datamap, kPointQuantParam), "remove kPointQuantParam failed");
+    }
+    DS3D_ERROR_RETURN(datamap.setGuardData(kPointXYZCompact, compact), "set kPointXYZCompact failed");
+    DS3D_ERROR_RETURN(detail::removePointLayout(datamap, kPointXYZ), "remove kPointXYZ failed");
+    return detail::removePointLayout(datamap, kPointXYZPlanar);
+}
+
+// convert fp32 points to dataType kFp16 or kInt16 and publish them as kPointXYZCompact
+inline ErrCode
+SetPointXYZCompact(GuardDataMap& datamap, const FrameGuard& points, DataType dataType)
+{
+    FrameGuard compact;
+    PointQuantParam param;
+    if (dataType == DataType::kFp16) {
+        compact = ToPointXYZHalf(points);
+    } else {
+        DS3D_FAILED_RETURN(
+            dataType == DataType::kInt16, ErrCode::kParam, "compact points support kFp16 and kInt16 only");
+        compact = ToPointXYZQuant(points, param);
+    }
+    DS3D_FAILED_RETURN(compact, ErrCode::kParam, "convert points failed");
+    return SetPointXYZCompact(datamap, compact, &param);
+}
+
+// kPointXYZ of the datamap. If it is missing, it is converted from
+// kPointXYZPlanar or decoded from kPointXYZCompact, whichever is present.
+inline FrameGuard
+GetPointXYZ(const GuardDataMap& datamap)
+{
+    auto [points, planar, compact, param] =
+        datamap.fetch(kPointXYZ, kPointXYZPlanar, kPointXYZCompact, kPointQuantParam);
+    if (points) {
+        return points;
+    }
+    if (planar) {
+        return ToPointXYZ(planar);
+    }
+    if (compact) {
+        return FromPointXYZCompact(compact, param ? &*param : nullptr);
+    }
+    return FrameGuard();
+}
+
+// kPointXYZPlanar of the datamap, converted from kPointXYZ if that is the only layout present
+inline Frame2DGuard
+GetPointXYZPlanar(const GuardDataMap& datamap)
+{
+    auto [planar, points] = datamap.fetch(kPointXYZPlanar, kPointXYZ);
+    if (planar || !points) {
+        return planar;
+    }
+    return ToPointXYZPlanar(points);
+}
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_POINT_FRAME_HPP
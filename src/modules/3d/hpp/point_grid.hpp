@@ -0,0 +1,347 @@
+#ifndef DS3D_COMMON_HPP_POINT_GRID_HPP
+#define DS3D_COMMON_HPP_POINT_GRID_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/point_grid.h"
+#include "3d/common/voxel_hash.h"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <vector>
+
+/**
+ * @file uniform grid index of point clouds for fixed radius neighbor queries
+ */
+
+namespace ds3d {
+
+class PointGrid;
+
+/**
+ * @brief GridCell is the neighborhood of one grid cell: its own points
+ *   first, then the points of the 26 cells around it, gathered once into
+ *   contiguous arrays which every query of the cell scans with full vectors.
+ *   One GridCell per thread is reused for all the cells it visits.
+ */
+class GridCell {
+public:
+    // points of the cell itself
+    uint32_t size() const { return _size; }
+    // grid position of point t of the cell
+    uint32_t position(uint32_t t) const { return _pos[t]; }
+
+    /**
+     * @brief calls f(j, d2) for the grid points j within sqrt(radius2) of
+     *   point t of the cell, d2 their squared distance, the point itself
+     *   excluded, until f returns false. radius must not exceed the cell size.
+     */
+    template <typename F>
+    void query(uint32_t t, float radius2, F&& f) const
+    {
+        GridQuery q;
+        q.p[0] = _x[t];
+        q.p[1] = _y[t];
+        q.p[2] = _z[t];
+        q.radius2 = radius2;
+        q.self = t;
+        uint32_t hits[kQueryBlock];
+        float hitD2[kQueryBlock];
+        for (uint32_t j = 0; j < _padded; j += kQueryBlock) {
+            uint32_t n = GridScan(_x.data(), _y.data(), _z.data(), j, std::min(_padded, j + kQueryBlock), q, hits, hitD2);
+            for (uint32_t h = 0; h < n; ++h) {
+                if (!f(_pos[hits[h]], hitD2[h])) {
+                    return;
+                }
+            }
+        }
+    }
+
+private:
+    friend class PointGrid;
+    static constexpr uint32_t kQueryBlock = 64;  // candidates per GridScan, a multiple of 8
+
+    void clear() { _num = _size = _padded = 0; }
+
+    // room for num more points and the padding
+    void reserve(uint32_t num)
+    {
+        if (_x.size() < _num + num + 7) {
+            size_t cap = std::max<size_t>(_x.size() * 2, _num + num + 7);
+            _x.resize(cap);
+            _y.resize(cap);
+            _z.resize(cap);
+            _pos.resize(cap);
+        }
+    }
+
+    // pad to whole vectors with points out of any radius
+    void pad()
+    {
+        reserve(0);
+        _padded = (_num + 7) & ~7u;
+        for (uint32_t j = _num; j < _padded; ++j) {
+            _x[j] = _y[j] = _z[j] = std::numeric_limits<float>::infinity();
+            _pos[j] = 0;
+        }
+    }
+
+    std::vector<float> _x, _y, _z;
+    std::vector<uint32_t> _pos;
+    uint32_t _num = 0;  // own and neighbor points
+    uint32_t _size = 0;  // own points
+    uint32_t _padded = 0;
+};
+
+/**
+ * @brief PointGrid indexes the valid points of a cloud in a uniform grid of
+ *   cubic cells (VoxelKey), hashed into a power of 2 number of buckets. A
+ *   counting sort stores the points of every bucket contiguously as x, y, z
+ *   arrays, neighborhoods are then gathered cell by cell into a GridCell.
+ *   Colliding cells share a bucket and are told apart by their key. Invalid
+ *   points, (0, 0, 0) or non-finite, are not indexed.
+ *   build() histograms and scatters tiles of the cloud in parallel, in a
+ *   deterministic order, and keeps its storage between frames.
+ *   Not thread-safe to build, cells may be visited concurrently.
+ */
+class PointGrid {
+public:
+    // indexed (valid) points, positions in the sorted order
+    size_t size() const { return _size; }
+    // buckets of the last build, cells are visited by bucket ranges
+    size_t numBuckets() const { return _start.empty() ? 0 : _start.size() - 1; }
+    float cellSize() const { return _cellSize; }
+    // index in the source cloud of sorted position i
+    uint32_t index(size_t i) const { return _index[i]; }
+
+    void build(const float* xyz, size_t num, float cellSize, ThreadPool* pool = nullptr)
+    {
+        _cellSize = cellSize;
+        _invCell = 1.0f / cellSize;
+        uint32_t numTiles = 1;
+        if (pool) {
+            numTiles = static_cast<uint32_t>(std::min<size_t>(pool->size(), std::max<size_t>(num / kMinTilePoints, 1)));
+        }
+        size_t numBuckets = size_t(64) << kBrickBits;
+        while (numBuckets < num) {
+            numBuckets <<= 1;
+        }
+        _bucketShift = 64 - static_cast<uint32_t>(__builtin_ctzll(numBuckets));
+        _bucketOf.resize(num);
+        _cellKey.resize(num);
+        _hist.resize(numTiles * numBuckets);
+        _start.resize(numBuckets + 1);
+
+        // cell, bucket and per tile bucket histogram of every point
+        auto tileBegin = [num, numTiles](size_t t) { return num * t / numTiles; };
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t t0, size_t t1) {
+            for (size_t t = t0; t < t1; ++t) {
+                uint32_t* hist = _hist.data() + t * numBuckets;
+                std::fill(hist, hist + numBuckets, 0u);
+                for (size_t i = tileBegin(t), end = tileBegin(t + 1); i < end; ++i) {
+                    uint64_t key;
+                    if (!VoxelKey(xyz + i * 3, _invCell, key)) {
+                        _bucketOf[i] = kNoBucket;
+                        continue;
+                    }
+                    uint32_t b = bucket(key);
+                    _cellKey[i] = key;
+                    _bucketOf[i] = b;
+                    ++hist[b];
+                }
+            }
+        });
+
+        // bucket starts, per tile counts become the scatter cursors of their tile
+        std::vector<size_t> chunkBase(numTiles + 1, 0);
+        auto chunkBegin = [numBuckets, numTiles](size_t c) { return numBuckets * c / numTiles; };
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t c0, size_t c1) {
+            for (size_t c = c0; c < c1; ++c) {
+                size_t sum = 0;
+                for (size_t t = 0; t < numTiles; ++t) {
+                    const uint32_t* hist = _hist.data() + t * numBuckets;
+                    for (size_t b = chunkBegin(c), end = chunkBegin(c + 1); b < end; ++b) {
+                        sum += hist[b];
+                    }
+                }
+                chunkBase[c + 1] = sum;
+            }
+        });
+        for (uint32_t c = 0; c < numTiles; ++c) {
+            chunkBase[c + 1] += chunkBase[c];
+        }
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t c0, size_t c1) {
+            for (size_t c = c0; c < c1; ++c) {
+                uint32_t pos = static_cast<uint32_t>(chunkBase[c]);
+                for (size_t b = chunkBegin(c), end = chunkBegin(c + 1); b < end; ++b) {
+                    _start[b] = pos;
+                    for (size_t t = 0; t < numTiles; ++t) {
+                        uint32_t& h = _hist[t * numBuckets + b];
+                        uint32_t count = h;
+                        h = pos;
+                        pos += count;
+                    }
+                }
+            }
+        });
+        _size = chunkBase[numTiles];
+        _start[numBuckets] = static_cast<uint32_t>(_size);
+
+        // scatter, every tile keeps the order of its points within a bucket
+        _x.resize(_size);
+        _y.resize(_size);
+        _z.resize(_size);
+        _index.resize(_size);
+        _key.resize(_size);
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t t0, size_t t1) {
+            for (size_t t = t0; t < t1; ++t) {
+                uint32_t* cursor = _hist.data() + t * numBuckets;
+                for (size_t i = tileBegin(t), end = tileBegin(t + 1); i < end; ++i) {
+                    uint32_t b = _bucketOf[i];
+                    if (b == kNoBucket) {
+                        continue;
+                    }
+                    uint32_t pos = cursor[b]++;
+                    _x[pos] = xyz[i * 3];
+                    _y[pos] = xyz[i * 3 + 1];
+                    _z[pos] = xyz[i * 3 + 2];
+                    _index[pos] = static_cast<uint32_t>(i);
+                    _key[pos] = _cellKey[i];
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief calls f(const GridCell&) for every cell of the buckets [b0, b1),
+     *   cell is the scratch the neighborhoods are gathered into. Cells of
+     *   disjoint bucket ranges have disjoint grid positions, so ranges may be
+     *   visited concurrently with one scratch each.
+     */
+    template <typename F>
+    void forEachCell(size_t b0, size_t b1, GridCell& cell, F&& f) const
+    {
+        std::vector<uint64_t> keys;
+        for (size_t b = b0; b < b1; ++b) {
+            const uint32_t begin = _start[b], end = _start[b + 1];
+            if (begin == end) {
+                continue;
+            }
+            // buckets mostly hold a single cell, colliding cells are visited one after the other
+            bool single = true;
+            for (uint32_t j = begin + 1; j < end && single; ++j) {
+                single = _key[j] == _key[begin];
+            }
+            if (single) {
+                gather(_key[begin], static_cast<uint32_t>(b), cell);
+                f(static_cast<const GridCell&>(cell));
+                continue;
+            }
+            keys.assign(_key.begin() + begin, _key.begin() + end);
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            for (uint64_t key : keys) {
+                gather(key, static_cast<uint32_t>(b), cell);
+                f(static_cast<const GridCell&>(cell));
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t kNoBucket = ~0u;
+    static constexpr uint32_t kBrickBits = 6;
+    // key offsets of the 9 rows of 3 cells around a cell, its own row first as it holds the closest points
+    static constexpr std::array<int64_t, 9> kRowOffsets = []() {
+        constexpr int64_t kAxisStep = int64_t(1) << 21;
+        std::array<int64_t, 9> offsets{};
+        size_t n = 1;
+        for (int64_t dz = -1; dz <= 1; ++dz) {
+            for (int64_t dy = -1; dy <= 1; ++dy) {
+                if (dy || dz) {
+                    offsets[n++] = dy * kAxisStep + dz * kAxisStep * kAxisStep;
+                }
+            }
+        }
+        return offsets;
+    }();
+    // below this, a tile costs more to merge than it saves
+    static constexpr size_t kMinTilePoints = 16384;
+
+    /**
+     * @brief cells are grouped in bricks of 4x4x4, the brick is hashed and
+     *   the 64 cells of a brick take consecutive buckets. Neighbor cells then
+     *   mostly sit next to each other in the sorted arrays, so queries in grid
+     *   order stay in cache. The axes of a surface are linear in the key, the
+     *   brick is mixed before taking the top bits or its bricks collide in rows.
+     */
+    uint32_t bucket(uint64_t key) const
+    {
+        constexpr uint64_t kLocal = 3ull | (3ull << 21) | (3ull << 42);
+        uint64_t local = (key & 3) | ((key >> 19) & 0xc) | ((key >> 38) & 0x30);
+        uint64_t brick = key & ~kLocal;
+        brick ^= brick >> 29;
+        brick *= 0xbf58476d1ce4e5b9ull;
+        brick ^= brick >> 32;
+        brick *= 0x94d049bb133111ebull;
+        return static_cast<uint32_t>(((brick >> (_bucketShift + kBrickBits)) << kBrickBits) | local);
+    }
+
+    // copies the points of cell key, then the other points of the 27 cells around it, into cell
+    void gather(uint64_t key, uint32_t b, GridCell& cell) const
+    {
+        cell.clear();
+        copyRange(_start[b], _start[b + 1], key, 0, ~key, cell);
+        cell._size = cell._num;
+        for (int64_t offset : kRowOffsets) {
+            // the cells x - 1, x, x + 1 of a row, axes are 21 bit fields of the key and a wrapped axis
+            // only yields points out of range
+            const uint64_t first = key + static_cast<uint64_t>(offset - 1);
+            const uint32_t rb[3] = {bucket(first), bucket(first + 1), bucket(first + 2)};
+            // cells of one brick are consecutive buckets, copy them as one range of keys
+            for (uint32_t c = 0; c < 3;) {
+                uint32_t last = c;
+                while (last + 1 < 3 && rb[last + 1] == rb[last] + 1) {
+                    ++last;
+                }
+                copyRange(_start[rb[c]], _start[rb[last] + 1], first + c, last - c, key, cell);
+                c = last + 1;
+            }
+        }
+        cell.pad();
+    }
+
+    // appends the points of [begin, end) with a key in [key, key + span] other than skip, without branches
+    void copyRange(uint32_t begin, uint32_t end, uint64_t key, uint64_t span, uint64_t skip, GridCell& cell) const
+    {
+        cell.reserve(end - begin);
+        uint32_t n = cell._num;
+        float *x = cell._x.data(), *y = cell._y.data(), *z = cell._z.data();
+        uint32_t* pos = cell._pos.data();
+        for (uint32_t j = begin; j < end; ++j) {
+            x[n] = _x[j];
+            y[n] = _y[j];
+            z[n] = _z[j];
+            pos[n] = j;
+            n += (_key[j] - key <= span) & (_key[j] != skip);
+        }
+        cell._num = n;
+    }
+
+    float _cellSize = 0.0f;
+    float _invCell = 0.0f;
+    size_t _size = 0;
+    uint32_t _bucketShift = 64;
+    std::vector<uint32_t> _bucketOf;  // per source point
+    std::vector<uint64_t> _cellKey;  // per source point
+    std::vector<uint32_t> _hist;  // numTiles x numBuckets
+    std::vector<uint32_t> _start;  // numBuckets + 1
+    std::vector<float> _x, _y, _z;  // sorted
+    std::vector<uint32_t> _index;  // sorted
+    std::vector<uint64_t> _key;  // sorted
+};
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_POINT_GRID_HPP
@@ -0,0 +1,108 @@
+#ifndef DS3D_COMMON_HPP_POINT_NORMALS_HPP
+#define DS3D_COMMON_HPP_POINT_NORMALS_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/point_layout.h"
+#include "3d/common/point_normals.h"
+
+#include "frame.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+/**
+ * @file kPointNormal of organized kPointXYZ frames
+ */
+
+namespace ds3d {
+
+/**
+ * @brief OrganizedNormals estimates the normals of a cloud ordered like its
+ *   depth image (point y * width + x is pixel (x, y), as depth2point
+ *   outputs) from pixel neighbors instead of a 3D neighbor search, see
+ *   OrganizedNormalsRow. The cloud is first transposed to planar rows, then
+ *   tiles of rows are computed in parallel and interleaved back to N x 3.
+ *   Points within step of the image border get (0, 0, 0). The planar
+ *   and scratch storage is kept between frames.
+ *   Not thread-safe, use one OrganizedNormals per stream.
+ */
+class OrganizedNormals {
+public:
+    explicit OrganizedNormals(const OrganizedNormalParams& params = OrganizedNormalParams()) : _params(params) {}
+
+    const OrganizedNormalParams& params() const { return _params; }
+
+    // normals must be a CPU fp32 N x 3 frame, e.g. from a FramePool
+    ErrCode estimate(
+        const FrameGuard& points, uint32_t width, uint32_t height, FrameGuard& normals, ThreadPool* pool = nullptr)
+    {
+        DS3D_FAILED_RETURN(_params.step >= 1, ErrCode::kParam, "normal step must be at least 1");
+        FrameView<const float, 3> src(points);
+        DS3D_FAILED_RETURN(src, ErrCode::kParam, "kPointXYZ frame must be CPU fp32 N x 3");
+        const size_t num = static_cast<size_t>(width) * height;
+        DS3D_FAILED_RETURN(
+            src.width() == num, ErrCode::kParam, "kPointXYZ of %u points is not organized as %ux%u", src.width(),
+            width, height);
+        FrameView<float, 3> dst(normals);
+        DS3D_FAILED_RETURN(dst && dst.width() == num, ErrCode::kParam, "normal frame must be CPU fp32 %zu x 3", num);
+        if (!num) {
+            return ErrCode::kGood;
+        }
+        const float* xyz = src.rowPtr(0);
+        float* out = dst.rowPtr(0);
+
+        uint32_t numTiles = 1;
+        if (pool) {
+            numTiles = std::min<uint32_t>(static_cast<uint32_t>(pool->size()), std::max<uint32_t>(height / kMinTileRows, 1));
+        }
+        auto tileRow = [height, numTiles](size_t t) { return static_cast<uint32_t>(height * t / numTiles); };
+        _x.resize(num);
+        _y.resize(num);
+        _z.resize(num);
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t t0, size_t t1) {
+            const size_t begin = tileRow(t0) * size_t(width), end = tileRow(t1) * size_t(width);
+            PointXYZToPlanar(xyz + begin * 3, _x.data() + begin, _y.data() + begin, _z.data() + begin, end - begin);
+        });
+
+        const uint32_t step = _params.step;
+        // one normal row per tile, a parallelFor call owns the row of its first tile
+        _scratch.resize(static_cast<size_t>(numTiles) * width * 3);
+        ThreadPool::parallelFor(pool, numTiles, 1, [&](size_t t0, size_t t1) {
+            float *nx = _scratch.data() + t0 * width * 3, *ny = nx + width, *nz = ny + width;
+            if (2 * step < width) {
+                for (float* n : {nx, ny, nz}) {
+                    std::fill(n, n + step, 0.0f);
+                    std::fill(n + width - step, n + width, 0.0f);
+                }
+            }
+            for (uint32_t row = tileRow(t0), end = tileRow(t1); row < end; ++row) {
+                float* dstRow = out + size_t(row) * width * 3;
+                if (row < step || row + step >= height || 2 * step >= width) {
+                    memset(dstRow, 0, width * 3 * sizeof(float));
+                    continue;
+                }
+                const size_t offset = size_t(row) * width;
+                OrganizedNormalsRow(
+                    _x.data() + offset, _y.data() + offset, _z.data() + offset, step, width - step, width, _params,
+                    nx, ny, nz);
+                // border columns are not written by OrganizedNormalsRow, they stay 0
+                PlanarToPointXYZ(nx, ny, nz, dstRow, width);
+            }
+        });
+        return ErrCode::kGood;
+    }
+
+private:
+    // below this, a tile costs more to schedule than it saves
+    static constexpr uint32_t kMinTileRows = 32;
+
+    OrganizedNormalParams _params;
+    std::vector<float> _x, _y, _z;
+    std::vector<float> _scratch;  // per tile normal rows
+};
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_POINT_NORMALS_HPP
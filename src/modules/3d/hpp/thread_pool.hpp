@@ -0,0 +1,191 @@
+#ifndef DS3D_COMMON_HPP_THREAD_POOL_HPP
+#define DS3D_COMMON_HPP_THREAD_POOL_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/func_utils.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @file fixed size worker pool splitting CPU kernels into tiles (e.g. rows of a frame)
+ */
+
+namespace ds3d {
+
+/**
+ * @brief ThreadPool runs parallelFor jobs on size() - 1 workers plus the
+ *   calling thread. parallelFor blocks until every tile is done. One job
+ *   runs at a time: a parallelFor issued while the pool is busy (from another
+ *   filter thread, or nested inside a tile) runs inline on its caller
+ *   instead of waiting. Tiles are claimed dynamically, so uneven tiles
+ *   balance out.
+ *
+ *   For example, converting a frame in tiles of 16 rows:
+ *     ThreadPool::shared().parallelFor(height, 16, [&](size_t y0, size_t y1) {
+ *         for (size_t y = y0; y < y1; ++y) { convertRow(y); }
+ *     });
+ *   Kernels taking an optional pool use ThreadPool::parallelFor(pool, ...).
+ */
+class ThreadPool {
+public:
+    // threads = 0 uses all hardware threads
+    explicit ThreadPool(uint32_t threads = 0)
+    {
+        if (!threads) {
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        _workers.reserve(threads - 1);
+        for (uint32_t i = 1; i < threads; ++i) {
+            _workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _cond.notify_all();
+        for (auto& t : _workers) {
+            t.join();
+        }
+    }
+
+    // threads taking part in a job, the caller included
+    uint32_t size() const { return static_cast<uint32_t>(_workers.size()) + 1; }
+
+    // process-wide pool shared by filters which do not configure their own
+    static ThreadPool& shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    // parallelFor on pool, or f(0, num) on the calling thread when pool is null
+    // (e.g. a filter configured with threads: 1)
+    template <typename F>
+    static void parallelFor(ThreadPool* pool, size_t num, size_t grain, F&& f)
+    {
+        if (pool) {
+            pool->parallelFor(num, grain, std::forward<F>(f));
+        } else if (num) {
+            f(size_t(0), num);
+        }
+    }
+
+    // calls f(begin, end) on tiles of at most grain items covering [0, num)
+    template <typename F>
+    void parallelFor(size_t num, size_t grain, F&& f)
+    {
+        if (!num) {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+        if (_workers.empty() || num <= grain || _busy.exchange(true, std::memory_order_acquire)) {
+            f(size_t(0), num);
+            return;
+        }
+        Job job;
+        job.num = num;
+        job.grain = grain;
+        job.tiles = (num + grain - 1) / grain;
+        job.ctx = &f;
+        job.run = [](void* ctx, size_t b, size_t e) { (*static_cast<std::remove_reference_t<F>*>(ctx))(b, e); };
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _job = &job;
+            ++_generation;
+        }
+        _cond.notify_all();
+        runTiles(job);
+        std::unique_lock<std::mutex> lock(_mutex);
+        // no worker may pick the job up after this point
+        _job = nullptr;
+        _doneCond.wait(lock, [&job]() { return !job.users && job.done == job.tiles; });
+        _busy.store(false, std::memory_order_release);
+        if (job.error) {
+            std::rethrow_exception(job.error);
+        }
+    }
+
+private:
+    struct Job {
+        size_t num = 0;
+        size_t grain = 1;
+        size_t tiles = 0;
+        void* ctx = nullptr;
+        void (*run)(void*, size_t, size_t) = nullptr;
+        std::atomic<size_t> next{0};
+        size_t done = 0;    // guarded by _mutex
+        uint32_t users = 0; // workers inside runTiles, guarded by _mutex
+        std::exception_ptr error;
+    };
+
+    void runTiles(Job& job)
+    {
+        size_t finished = 0;
+        std::exception_ptr error;
+        for (size_t t = job.next.fetch_add(1, std::memory_order_relaxed); t < job.tiles;
+             t = job.next.fetch_add(1, std::memory_order_relaxed)) {
+            size_t begin = t * job.grain;
+            if (!error) {
+                try {
+                    job.run(job.ctx, begin, std::min(begin + job.grain, job.num));
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+            }
+            ++finished;
+        }
+        std::unique_lock<std::mutex> lock(_mutex);
+        job.done += finished;
+        if (error && !job.error) {
+            job.error = error;
+        }
+    }
+
+    void workerLoop()
+    {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;) {
+            _cond.wait(lock, [this, &seen]() { return _quit || _generation != seen; });
+            if (_quit) {
+                return;
+            }
+            seen = _generation;
+            Job* job = _job;
+            if (!job) {
+                continue;  // the job finished before this worker woke up
+            }
+            ++job->users;
+            lock.unlock();
+            runTiles(*job);
+            lock.lock();
+            --job->users;
+            _doneCond.notify_all();
+        }
+    }
+
+    std::vector<std::thread> _workers;
+    std::atomic<bool> _busy{false};  // one parallelFor at a time
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::condition_variable _doneCond;
+    Job* _job = nullptr;
+    uint64_t _generation = 0;
+    bool _quit = false;
+
+    DS3D_DISABLE_CLASS_COPY(ThreadPool);
+};
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_THREAD_POOL_HPP
@@ -0,0 +1,209 @@
+#ifndef DS3D_COMMON_HPP_VOXEL_GRID_HPP
+#define DS3D_COMMON_HPP_VOXEL_GRID_HPP
+
+#include "3d/common/common.h"
+#include "3d/common/voxel_hash.h"
+
+#include "frame.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @file voxel grid downsampling of kPointXYZ (and kPointCoordUV) frames
+ */
+
+namespace ds3d {
+
+/**
+ * @brief VoxelGrid replaces the points of every occupied voxel by their
+ *   centroid, and their color coordinates by the mean coordinate.
+ *   Invalid points, (0, 0, 0) or non-finite, are dropped. Points are
+ *   accumulated per tile into private VoxelHash tables, whose cells are
+ *   bucketed by hash partition and then reduced in parallel per partition.
+ *   If the voxels exceed maxPoints, the voxel size is doubled from the
+ *   accumulated sums until they fit, so the output never exceeds the budget
+ *   (down to 8 voxels around the origin, where only the fullest voxels are
+ *   kept). Tables are kept between frames.
+ *   Not thread-safe, use one VoxelGrid per stream.
+ */
+class VoxelGrid {
+public:
+    // maxPoints 0 means no budget
+    explicit VoxelGrid(float voxelSize, uint32_t maxPoints = 0) : _voxelSize(voxelSize), _maxPoints(maxPoints) {}
+
+    float voxelSize() const { return _voxelSize; }
+    // voxel size of the last downsample, a power of 2 multiple of voxelSize() if the budget was hit
+    float lastVoxelSize() const { return _lastVoxelSize; }
+
+    // colorCoord may be empty, outCoord is only set when it is not
+    ErrCode downsample(
+        const FrameGuard& points, const FrameGuard& colorCoord, FrameGuard& outPoints, FrameGuard& outCoord,
+        ThreadPool* pool = nullptr)
+    {
+        DS3D_FAILED_RETURN(_voxelSize > 0.0f, ErrCode::kParam, "voxel size must be positive");
+        FrameView<const float, 3> src(points);
+        DS3D_FAILED_RETURN(src, ErrCode::kParam, "kPointXYZ frame must be CPU fp32 N x 3");
+        const size_t num = src.width();
+        const float* xyz = num ? src.rowPtr(0) : nullptr;
+        const float* uv = nullptr;
+        if (colorCoord) {
+            FrameView<const float, 2> uvView(colorCoord);
+            DS3D_FAILED_RETURN(
+                uvView && uvView.width() == num, ErrCode::kParam, "kPointCoordUV frame must be CPU fp32 %zu x 2", num);
+            uv = num ? uvView.rowPtr(0) : nullptr;
+        }
+
+        // accumulate
+        uint32_t numTiles = 1;
+        if (pool) {
+            numTiles = static_cast<uint32_t>(std::min<size_t>(pool->size(), std::max<size_t>(num / kMinTilePoints, 1)));
+        }
+        if (_tiles.size() < numTiles) {
+            _tiles.resize(numTiles);
+        }
+        const float invVoxel = 1.0f / _voxelSize;
+        auto accumulate = [&](size_t t0, size_t t1) {
+            for (size_t t = t0; t < t1; ++t) {
+                VoxelHash& hash = _tiles[t];
+                hash.clear();
+                // neighbor points of organized clouds mostly share a voxel, sum runs before touching the hash
+                VoxelCell run;
+                size_t end = num * (t + 1) / numTiles;
+                for (size_t i = num * t / numTiles; i < end; ++i) {
+                    uint64_t key;
+                    const float* p = xyz + i * 3;
+                    if (!VoxelKey(p, invVoxel, key)) {
+                        continue;
+                    }
+                    if (key != run.key) {
+                        if (run.count) {
+                            hash.merge(run);
+                        }
+                        run = VoxelCell();
+                        run.key = key;
+                    }
+                    run.sum[0] += p[0];
+                    run.sum[1] += p[1];
+                    run.sum[2] += p[2];
+                    if (uv) {
+                        run.sumUV[0] += uv[i * 2];
+                        run.sumUV[1] += uv[i * 2 + 1];
+                    }
+                    ++run.count;
+                }
+                if (run.count) {
+                    hash.merge(run);
+                }
+                if (numTiles > 1) {
+                    // bucket the cells by partition once, so the reduce reads each cell once
+                    std::vector<VoxelCell>* buckets = &_buckets[t * numTiles];
+                    for (uint32_t p = 0; p < numTiles; ++p) {
+                        buckets[p].clear();
+                    }
+                    hash.forEach([&](const VoxelCell& c) { buckets[VoxelPartition(c.key, numTiles)].push_back(c); });
+                }
+            }
+        };
+        if (numTiles > 1 && _buckets.size() < static_cast<size_t>(numTiles) * numTiles) {
+            _buckets.resize(static_cast<size_t>(numTiles) * numTiles);
+        }
+        ThreadPool::parallelFor(pool, numTiles, 1, accumulate);
+
+        // reduce, partition p owns the keys with VoxelPartition(key) == p
+        std::vector<VoxelHash*> parts;
+        if (numTiles == 1) {
+            parts.push_back(&_tiles[0]);
+        } else {
+            if (_parts.size() < numTiles) {
+                _parts.resize(numTiles);
+            }
+            auto reduce = [&](size_t p0, size_t p1) {
+                for (size_t p = p0; p < p1; ++p) {
+                    size_t expected = 0;  // voxels shared by tiles make it an upper bound
+                    for (uint32_t t = 0; t < numTiles; ++t) {
+                        expected += _buckets[t * numTiles + p].size();
+                    }
+                    VoxelHash& part = _parts[p];
+                    part.clear();
+                    part.reserve(expected);
+                    for (uint32_t t = 0; t < numTiles; ++t) {
+                        for (const VoxelCell& c : _buckets[t * numTiles + p]) {
+                            part.merge(c);
+                        }
+                    }
+                }
+            };
+            ThreadPool::parallelFor(pool, numTiles, 1, reduce);
+            for (uint32_t p = 0; p < numTiles; ++p) {
+                parts.push_back(&_parts[p]);
+            }
+        }
+
+        // budget
+        size_t total = 0;
+        for (VoxelHash* part : parts) {
+            total += part->size();
+        }
+        _lastVoxelSize = _voxelSize;
+        if (_maxPoints && total > _maxPoints) {
+            for (size_t p = 1; p < parts.size(); ++p) {
+                parts[p]->forEach([&](const VoxelCell& c) { parts[0]->merge(c); });
+            }
+            parts.resize(1);
+            for (uint32_t i = 0; i < kVoxelMaxCoarsen && parts[0]->size() > _maxPoints; ++i) {
+                parts[0]->coarsen();
+                _lastVoxelSize *= 2.0f;
+            }
+            parts[0]->truncate(_maxPoints);  // budget below the voxels straddling the origin
+            total = parts[0]->size();
+        }
+
+        // centroids
+        int32_t outNum = static_cast<int32_t>(total);
+        outPoints = CreateFrame(Shape{2, {outNum, 3}}, DataType::kFp32, FrameType::kPointXYZ);
+        DS3D_FAILED_RETURN(outPoints, ErrCode::kMem, "create voxel points failed");
+        float* dstXYZ = static_cast<float*>(outPoints->base());
+        float* dstUV = nullptr;
+        if (uv) {
+            outCoord = CreateFrame(Shape{2, {outNum, 2}}, DataType::kFp32, FrameType::kPointCoordUV);
+            DS3D_FAILED_RETURN(outCoord, ErrCode::kMem, "create voxel color coord failed");
+            dstUV = static_cast<float*>(outCoord->base());
+        }
+        std::vector<size_t> offsets(parts.size() + 1, 0);
+        for (size_t p = 0; p < parts.size(); ++p) {
+            offsets[p + 1] = offsets[p] + parts[p]->size();
+        }
+        auto write = [&](size_t p0, size_t p1) {
+            for (size_t p = p0; p < p1; ++p) {
+                size_t i = offsets[p];
+                parts[p]->forEach([&](const VoxelCell& c) {
+                    float inv = 1.0f / static_cast<float>(c.count);
+                    for (int k = 0; k < 3; ++k) {
+                        dstXYZ[i * 3 + k] = c.sum[k] * inv;
+                    }
+                    if (dstUV) {
+                        dstUV[i * 2] = c.sumUV[0] * inv;
+                        dstUV[i * 2 + 1] = c.sumUV[1] * inv;
+                    }
+                    ++i;
+                });
+            }
+        };
+        ThreadPool::parallelFor(pool, static_cast<uint32_t>(parts.size()), 1, write);
+        return ErrCode::kGood;
+    }
+
+private:
+    // below this, a tile costs more to reduce than it saves
+    static constexpr size_t kMinTilePoints = 16384;
+
+    float _voxelSize = 0.0f;
+    uint32_t _maxPoints = 0;
+    float _lastVoxelSize = 0.0f;
+    std::vector<VoxelHash> _tiles;
+    std::vector<VoxelHash> _parts;
+    std::vector<std::vector<VoxelCell>> _buckets;  // numTiles x numTiles, tile major
+};
+
+}  // namespace ds3d
+
+#endif  // DS3D_COMMON_HPP_VOXEL_GRID_HPP
@@ -0,0 +1,126 @@
+#include "3d/hpp/flat_datamap.hpp"
+#include "3d/hpp/frame.hpp"
+#include "test_utils.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+/**
+ * @file GuardDataMap::fetch against the hasData + getGuardData/getData sequence
+ *   it replaced in appsinkBufferProbe, on a legacy and on a flat datamap.
+ *   Prints the time and the heap allocations per probe of the 5 keys.
+ */
+
+using namespace ds3d;
+
+static size_t gAllocCount = 0;
+
+void*
+operator new(size_t bytes)
+{
+    ++gAllocCount;
+    void* p = malloc(bytes);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void
+operator delete(void* p) noexcept
+{
+    free(p);
+}
+void
+operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+static void
+fill(GuardDataMap& map)
+{
+    FrameGuard points = CreateFrame(Shape{2, {1024, 3}}, DataType::kFp32, FrameType::kPointXYZ);
+    FrameGuard uv = CreateFrame(Shape{2, {1024, 2}}, DataType::kFp32, FrameType::kPointCoordUV);
+    IntrinsicsParam intrinsics;
+    intrinsics.fx = 1.0f;
+    map.setGuardData(kPointXYZ, points);
+    map.setGuardData(kPointCoordUV, uv);
+    map.setData(kDepthIntrinsics, intrinsics);
+    map.setData(kColorIntrinsics, intrinsics);
+    map.setData(kDepth2ColorExtrinsics, ExtrinsicsParam{});
+    map.setData(kDepthScaleUnit, DepthScale{});
+    map.setData(kTimeStamp, TimeStamp{});
+}
+
+static float
+probeGetData(GuardDataMap& map)
+{
+    float acc = 0.0f;
+    FrameGuard points, uv;
+    IntrinsicsParam depthIntrinsics, colorIntrinsics;
+    ExtrinsicsParam d2c;
+    if (map.hasData(kPointXYZ.name) && isGood(map.getGuardData(kPointXYZ, points))) {
+        acc += points->bytes();
+    }
+    if (map.hasData(kPointCoordUV.name) && isGood(map.getGuardData(kPointCoordUV, uv))) {
+        acc += uv->bytes();
+    }
+    if (map.hasData(kDepthIntrinsics.name) && isGood(map.getData(kDepthIntrinsics, depthIntrinsics))) {
+        acc += depthIntrinsics.fx;
+    }
+    if (map.hasData(kColorIntrinsics.name) && isGood(map.getData(kColorIntrinsics, colorIntrinsics))) {
+        acc += colorIntrinsics.fx;
+    }
+    if (map.hasData(kDepth2ColorExtrinsics.name) && isGood(map.getData(kDepth2ColorExtrinsics, d2c))) {
+        acc += d2c.translation.x;
+    }
+    return acc;
+}
+
+static float
+probeFetch(GuardDataMap& map)
+{
+    float acc = 0.0f;
+    auto [points, uv, depthIntrinsics, colorIntrinsics, d2c] =
+        map.fetch(kPointXYZ, kPointCoordUV, kDepthIntrinsics, kColorIntrinsics, kDepth2ColorExtrinsics);
+    acc += points ? points->bytes() : 0;
+    acc += uv ? uv->bytes() : 0;
+    acc += depthIntrinsics ? depthIntrinsics->fx : 0.0f;
+    acc += colorIntrinsics ? colorIntrinsics->fx : 0.0f;
+    acc += d2c ? d2c->translation.x : 0.0f;
+    return acc;
+}
+
+template <class F>
+static void
+run(const char* name, GuardDataMap& map, F probe)
+{
+    constexpr int kWarmup = 1000;
+    constexpr int kIterations = 200000;
+    volatile float sink = 0.0f;
+    for (int i = 0; i < kWarmup; ++i) {
+        sink = sink + probe(map);
+    }
+    size_t allocs = gAllocCount;
+    double start = test::nowNs();
+    for (int i = 0; i < kIterations; ++i) {
+        sink = sink + probe(map);
+    }
+    double ns = (test::nowNs() - start) / kIterations;
+    printf("%-28s %8.1f ns/probe %6.2f allocs/probe\n", name, ns, double(gAllocCount - allocs) / kIterations);
+}
+
+int
+main()
+{
+    GuardDataMap legacy = test::CreateLegacyDataMap();
+    GuardDataMap flat = CreateFlatDataMap();
+    fill(legacy);
+    fill(flat);
+    run("legacy map, hasData+get", legacy, probeGetData);
+    run("legacy map, fetch", legacy, probeFetch);
+    run("flat map, hasData+get", flat, probeGetData);
+    run("flat map, fetch", flat, probeFetch);
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include "3d/common/depth_kernels.h"
+#include "test_utils.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/**
+ * @file AVX2 / AVX-512 / NEON depth <-> meters kernels against the scalar loops
+ */
+
+using namespace ds3d;
+
+namespace {
+
+using ToMetersFn = size_t (*)(const uint16_t*, float*, uint8_t*, size_t, float, const DepthRange&);
+using ToDepthFn = size_t (*)(const float*, uint16_t*, size_t, float);
+
+struct Kernel {
+    const char* name;
+    ToMetersFn toMeters;
+    ToDepthFn toDepth;
+};
+
+// the vector kernels this CPU can run, each one is tested on its own
+// instead of only the widest one picked by DepthToMeters
+std::vector<Kernel>
+kernels()
+{
+    std::vector<Kernel> k;
+#if defined(DS3D_DEPTH_X86)
+    if (__builtin_cpu_supports("avx2")) {
+        k.push_back({"avx2", detail::depthToMetersAVX2, detail::metersToDepthAVX2});
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        k.push_back({"avx512", detail::depthToMetersAVX512, detail::metersToDepthAVX512});
+    }
+#elif defined(DS3D_DEPTH_NEON)
+    k.push_back({"neon", detail::depthToMetersNEON, detail::metersToDepthNEON});
+#endif
+    return k;
+}
+
+// every tail length of the 8 and 16 wide steps, and one frame row
+std::vector<size_t>
+sizes()
+{
+    std::vector<size_t> s = {848};
+    for (size_t num = 0; num < 40; ++num) {
+        s.push_back(num);
+    }
+    return s;
+}
+
+// raw depth with holes, the range boundaries, and the uint16 extremes
+std::vector<uint16_t>
+createDepth(size_t num, std::mt19937& rng)
+{
+    const uint16_t edges[] = {0, 1, 299, 300, 301, 3999, 4000, 4001, 65534, 65535};
+    std::vector<uint16_t> d(num);
+    for (size_t i = 0; i < num; ++i) {
+        d[i] = (i % 5 == 2) ? edges[rng() % 10] : static_cast<uint16_t>(rng() % 6000);
+    }
+    return d;
+}
+
+void
+testToMeters(const Kernel& k, std::mt19937& rng)
+{
+    const DepthRange ranges[] = {DepthRange{}, DepthRange{0.3f, 4.0f, false}, DepthRange{0.3f, 4.0f, true}};
+    const float guard = -7.0f;
+    for (size_t num : sizes()) {
+        std::vector<uint16_t> in = createDepth(num, rng);
+        for (const DepthRange& r : ranges) {
+            for (bool withMask : {true, false}) {
+                // 16 guard values after each output catch a store past num
+                std::vector<float> out(num + 16, guard), expect(num + 16, guard);
+                std::vector<uint8_t> mask(num + 16, 0x5a), expectMask(num + 16, 0x5a);
+                size_t i = k.toMeters(in.data(), out.data(), withMask ? mask.data() : nullptr, num, 0.001f, r);
+                DS3D_TEST_CHECK(i <= num);
+                detail::depthToMetersScalar(in.data(), out.data(), withMask ? mask.data() : nullptr, i, num, 0.001f, r);
+                detail::depthToMetersScalar(in.data(), expect.data(), withMask ? expectMask.data() : nullptr, 0, num, 0.001f, r);
+                DS3D_TEST_CHECK(!memcmp(out.data(), expect.data(), out.size() * sizeof(float)));
+                DS3D_TEST_CHECK(mask == expectMask);
+            }
+        }
+    }
+}
+
+// NaN, infinities, negative and out of range meters, and values halfway
+// between two raw steps which round to even
+std::vector<float>
+createMeters(size_t num, std::mt19937& rng)
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    const float edges[] = {std::numeric_limits<float>::quiet_NaN(), inf, -inf, -1.0f, -0.0004f, 0.0f, -0.0f, 0.0005f,
+                           0.0015f, 65.535f, 65.5354f, 65.5356f, 70.0f, 3e9f, 1e30f};
+    std::uniform_real_distribution<float> dist(0.0f, 8.0f);
+    std::vector<float> m(num);
+    for (size_t i = 0; i < num; ++i) {
+        m[i] = (i % 3 == 1) ? edges[rng() % 15] : dist(rng);
+        if (i % 7 == 4) {
+            m[i] = (static_cast<float>(rng() % 6000) + 0.5f) * 0.001f;
+        }
+    }
+    return m;
+}
+
+void
+testToDepth(const Kernel& k, std::mt19937& rng)
+{
+    const float invScale = 1.0f / 0.001f;
+    for (size_t num : sizes()) {
+        std::vector<float> in = createMeters(num, rng);
+        std::vector<uint16_t> out(num + 16, 0x5a5a), expect(num + 16, 0x5a5a);
+        size_t i = k.toDepth(in.data(), out.data(), num, invScale);
+        DS3D_TEST_CHECK(i <= num);
+        detail::metersToDepthScalar(in.data(), out.data(), i, num, invScale);
+        detail::metersToDepthScalar(in.data(), expect.data(), 0, num, invScale);
+        DS3D_TEST_CHECK(out == expect);
+    }
+}
+
+// the dispatching entry points, whatever kernel they pick
+void
+testPublic(std::mt19937& rng)
+{
+    const DepthRange range{0.3f, 4.0f, false};
+    std::vector<uint16_t> depth = createDepth(1001, rng);
+    std::vector<float> meters(depth.size()), expect(depth.size());
+    std::vector<uint8_t> mask(depth.size()), expectMask(depth.size());
+    DepthToMeters(depth.data(), meters.data(), mask.data(), depth.size(), 0.001f, range);
+    detail::depthToMetersScalar(depth.data(), expect.data(), expectMask.data(), 0, depth.size(), 0.001f, range);
+    DS3D_TEST_CHECK(meters == expect && mask == expectMask);
+
+    std::vector<float> in = createMeters(1001, rng);
+    std::vector<uint16_t> raw(in.size()), expectRaw(in.size());
+    MetersToDepth(in.data(), raw.data(), in.size(), 0.001f);
+    detail::metersToDepthScalar(in.data(), expectRaw.data(), 0, in.size(), 1.0f / 0.001f);
+    DS3D_TEST_CHECK(raw == expectRaw);
+}
+
+}  // namespace
+
+int
+main()
+{
+    std::mt19937 rng(17);
+    for (const Kernel& k : kernels()) {
+        printf("kernel: %s\n", k.name);
+        testToMeters(k, rng);
+        testToDepth(k, rng);
+    }
+    testPublic(rng);
+    return test::finish("test_depth_kernels");
+}
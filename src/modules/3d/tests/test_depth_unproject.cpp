@@ -0,0 +1,121 @@
+#include "3d/common/depth_unproject.h"
+#include "test_utils.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/**
+ * @file SSE / NEON UnprojectDepthRow against its scalar tail run one pixel at a time
+ */
+
+using namespace ds3d;
+
+namespace {
+
+struct Camera {
+    DepthRayLut lut;
+    ColorProjection proj;
+};
+
+// a 848x480 depth camera next to a 1280x720 color camera, slightly rotated
+// about y and placed 0.5 m in front so near depth falls behind it
+Camera
+createCamera()
+{
+    Camera cam;
+    IntrinsicsParam depth;
+    depth.width = 848;
+    depth.height = 480;
+    depth.centerX = 424.3f;
+    depth.centerY = 239.1f;
+    depth.fx = depth.fy = 421.7f;
+    BuildDepthRayLut(depth, cam.lut);
+
+    IntrinsicsParam color;
+    color.width = 1280;
+    color.height = 720;
+    color.centerX = 641.2f;
+    color.centerY = 359.8f;
+    color.fx = color.fy = 640.5f;
+    const float a = 0.05f;
+    ExtrinsicsParam ext;
+    ext.rotation[0] = vec3f{{std::cos(a), 0.0f, -std::sin(a)}};
+    ext.rotation[1] = vec3f{{0.0f, 1.0f, 0.0f}};
+    ext.rotation[2] = vec3f{{std::sin(a), 0.0f, std::cos(a)}};
+    ext.translation = vec3f{{0.015f, 0.002f, -0.5f}};
+    MakeColorProjection(color, ext, cam.proj);
+    return cam;
+}
+
+// raw depth with holes, skipping pixels which land within 5 cm of the color
+// camera plane where 1 / z makes the last bits of uv meaningless
+std::vector<uint16_t>
+createRow(const Camera& cam, float rayY, size_t width, std::mt19937& rng)
+{
+    std::vector<uint16_t> depth(width);
+    for (size_t x = 0; x < width; ++x) {
+        if (x % 6 == 1) {
+            continue;
+        }
+        float cz;
+        do {
+            depth[x] = static_cast<uint16_t>(rng() % 8000 + 1);
+            const float z = static_cast<float>(depth[x]) * 0.001f;
+            cz = (cam.lut.rayX[x] * cam.proj.r[2][0] + rayY * cam.proj.r[2][1] + cam.proj.r[2][2]) * z + cam.proj.t[2];
+        } while (std::fabs(cz) < 0.05f);
+    }
+    return depth;
+}
+
+void
+testRow(const Camera& cam, uint32_t y, size_t width, bool withUv, std::mt19937& rng)
+{
+    const float rayY = cam.lut.rayY[y];
+    std::vector<uint16_t> depth = createRow(cam, rayY, width, rng);
+    const float guard = -7.0f;
+    std::vector<float> xyz(width * 3 + 4, guard), uv(width * 2 + 4, guard);
+    std::vector<float> expectXyz(xyz.size(), guard), expectUv(uv.size(), guard);
+    const ColorProjection* proj = withUv ? &cam.proj : nullptr;
+    UnprojectDepthRow(
+        depth.data(), static_cast<uint32_t>(width), 0.001f, cam.lut.rayX.data(), rayY, xyz.data(),
+        withUv ? uv.data() : nullptr, proj);
+    // 1 pixel never reaches the vector loop
+    for (size_t x = 0; x < width; ++x) {
+        UnprojectDepthRow(
+            depth.data() + x, 1, 0.001f, cam.lut.rayX.data() + x, rayY, expectXyz.data() + x * 3,
+            withUv ? expectUv.data() + x * 2 : nullptr, proj);
+    }
+    // the same products in any order, so points match bit for bit
+    DS3D_TEST_CHECK(!memcmp(xyz.data(), expectXyz.data(), xyz.size() * sizeof(float)));
+    // the vector rotation sums in another order, or fused on NEON
+    for (size_t i = 0; i < uv.size(); ++i) {
+        const bool same = (uv[i] == 0.0f) == (expectUv[i] == 0.0f) && std::fabs(uv[i] - expectUv[i]) <= 1e-5f * (1.0f + std::fabs(expectUv[i]));
+        if (!same) {
+            fprintf(stderr, "width %zu uv[%zu]: %g, scalar %g\n", width, i, uv[i], expectUv[i]);
+        }
+        DS3D_TEST_CHECK(same);
+    }
+}
+
+}  // namespace
+
+int
+main()
+{
+    Camera cam = createCamera();
+    std::mt19937 rng(18);
+    // every tail length of the 4 pixel steps, and full rows
+    std::vector<size_t> widths = {848};
+    for (size_t width = 0; width < 20; ++width) {
+        widths.push_back(width);
+    }
+    for (uint32_t y : {0u, 239u, 479u}) {
+        for (size_t width : widths) {
+            testRow(cam, y, width, true, rng);
+            testRow(cam, y, width, false, rng);
+        }
+    }
+    return test::finish("test_depth_unproject");
+}
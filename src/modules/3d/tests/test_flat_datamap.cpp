@@ -0,0 +1,129 @@
+#include "3d/hpp/flat_datamap.hpp"
+#include "test_utils.h"
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @file FlatDataMap probe chains across removes, checked against std::map
+ */
+
+using namespace ds3d;
+
+namespace {
+
+// keys whose hashes are forced onto a few home slots, so every remove
+// shifts a chain, some of them wrapping around the end of the slot array
+struct Keys {
+    explicit Keys(uint32_t num, uint32_t capacity)
+    {
+        names.reserve(num);
+        for (uint32_t i = 0; i < num; ++i) {
+            names.push_back("key" + std::to_string(i));
+        }
+        for (uint32_t i = 0; i < num; ++i) {
+            Key<DepthScale> key(names[i].c_str());
+            key.hash = (i % 4) ? capacity - 1 - (i % 3) : i;
+            keys.push_back(key);
+        }
+    }
+    std::vector<std::string> names;
+    std::vector<Key<DepthScale>> keys;
+};
+
+void
+checkContents(GuardDataMap& map, const Keys& keys, const std::map<uint32_t, double>& model)
+{
+    for (uint32_t i = 0; i < keys.keys.size(); ++i) {
+        auto it = model.find(i);
+        DepthScale value;
+        ErrCode code = map.getData(keys.keys[i], value);
+        if (it == model.end()) {
+            DS3D_TEST_CHECK(code == ErrCode::kNotFound);
+            DS3D_TEST_CHECK(!map.hasData(keys.keys[i]));
+        } else {
+            DS3D_TEST_CHECK(isGood(code) && value.scaleUnit == it->second);
+            DS3D_TEST_CHECK(map.hasData(keys.keys[i]));
+        }
+    }
+}
+
+void
+testRandomRemoves()
+{
+    // 40 keys grow the 32 slots once, and go past the 16 inline value blocks
+    const uint32_t numKeys = 40;
+    for (uint32_t capacity : {32u, 64u}) {
+        Keys keys(numKeys, capacity);
+        GuardDataMap map = CreateFlatDataMap(capacity);
+        FlatDataMap* flat = static_cast<FlatDataMap*>(map.ptr());
+        std::map<uint32_t, double> model;
+        std::mt19937 rng(capacity);
+        for (uint32_t step = 0; step < 4000; ++step) {
+            const uint32_t i = rng() % numKeys;
+            if (rng() % 3) {
+                const double v = step + 0.5;
+                DS3D_TEST_CHECK(isGood(map.setData(keys.keys[i], DepthScale{v})));
+                model[i] = v;
+            } else {
+                ErrCode code = map.removeData(keys.keys[i]);
+                DS3D_TEST_CHECK(code == (model.erase(i) ? ErrCode::kGood : ErrCode::kNotFound));
+            }
+            DS3D_TEST_CHECK(flat->size() == model.size());
+            if (step % 97 == 0) {
+                checkContents(map, keys, model);
+            }
+        }
+        checkContents(map, keys, model);
+        for (auto it = model.begin(); it != model.end();) {
+            DS3D_TEST_CHECK(isGood(map.removeData(keys.keys[it->first])));
+            it = model.erase(it);
+            checkContents(map, keys, model);
+        }
+        DS3D_TEST_CHECK(flat->size() == 0);
+    }
+}
+
+// removing the head of a chain which wraps around slot 0 must pull the
+// wrapped entries back, and leave entries at their home slot alone
+void
+testWrappedChain()
+{
+    const uint32_t capacity = 32;
+    Keys keys(6, capacity);
+    std::vector<Key<DepthScale>> chain;
+    for (uint32_t i = 0; i < 4; ++i) {
+        Key<DepthScale> key(keys.names[i].c_str());
+        key.hash = capacity - 2;
+        chain.push_back(key);
+    }
+    Key<DepthScale> home(keys.names[4].c_str());
+    home.hash = 1;
+    GuardDataMap map = CreateFlatDataMap(capacity);
+    for (uint32_t i = 0; i < chain.size(); ++i) {
+        DS3D_TEST_CHECK(isGood(map.setData(chain[i], DepthScale{double(i)})));
+    }
+    // chain takes slots 30, 31, 0, 1, so home is displaced to 2
+    DS3D_TEST_CHECK(isGood(map.setData(home, DepthScale{9.0})));
+    for (uint32_t i = 0; i < chain.size(); ++i) {
+        DS3D_TEST_CHECK(isGood(map.removeData(chain[i])));
+        for (uint32_t j = i + 1; j < chain.size(); ++j) {
+            DepthScale value;
+            DS3D_TEST_CHECK(isGood(map.getData(chain[j], value)) && value.scaleUnit == j);
+        }
+        DepthScale value;
+        DS3D_TEST_CHECK(isGood(map.getData(home, value)) && value.scaleUnit == 9.0);
+    }
+}
+
+}  // namespace
+
+int
+main()
+{
+    testRandomRemoves();
+    testWrappedChain();
+    return test::finish("test_flat_datamap");
+}
@@ -0,0 +1,80 @@
+#include "3d/hpp/frame.hpp"
+#include "test_utils.h"
+
+/**
+ * @file FrameView over 2D frames and their ROIs
+ */
+
+using namespace ds3d;
+
+// every pixel holds a value of its coordinates, so a view can be checked against its parent
+static uint16_t
+pixelValue(uint32_t x, uint32_t y)
+{
+    return static_cast<uint16_t>(y * 853 + x);
+}
+
+static Frame2DGuard
+createDepth(uint32_t width, uint32_t height, uint32_t pitchAlign)
+{
+    Frame2DGuard depth = Create2DFrame(width, height, 1, DataType::kUint16, FrameType::kDepth, pitchAlign);
+    FrameView<uint16_t> view(depth);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            view.at(x, y) = pixelValue(x, y);
+        }
+    }
+    return depth;
+}
+
+static void
+checkRoi(const Frame2DGuard& depth, const FrameRoi& roi)
+{
+    Frame2DGuard frame = Roi2DFrame(depth, roi);
+    DS3D_TEST_CHECK(frame);
+    FrameView<const uint16_t> view(frame);
+    DS3D_TEST_CHECK(view.status() == ErrCode::kGood);
+    if (!view) {
+        return;
+    }
+    DS3D_TEST_CHECK(view.width() == roi.width && view.height() == roi.height);
+    DS3D_TEST_CHECK(view.at(0, 0) == pixelValue(roi.x, roi.y));
+    // the last pixel is the last pixel of the parent allocation
+    uint32_t lastX = roi.width - 1, lastY = roi.height - 1;
+    DS3D_TEST_CHECK(view.at(lastX, lastY) == pixelValue(roi.x + lastX, roi.y + lastY));
+}
+
+static void
+testRoiCorners(uint32_t pitchAlign)
+{
+    Frame2DGuard depth = createDepth(848, 480, pitchAlign);
+    DS3D_TEST_CHECK(depth);
+    checkRoi(depth, FrameRoi{100, 240, 424, 240});  // x > 0 on the bottom row
+    checkRoi(depth, FrameRoi{424, 240, 424, 240});  // bottom-right corner
+    checkRoi(depth, FrameRoi{0, 0, 848, 480});
+    checkRoi(depth, FrameRoi{847, 479, 1, 1});
+}
+
+static void
+testPlaneOutOfRange()
+{
+    std::vector<uint16_t> buf(64 * 8);
+    Shape shape{2, {8, 64}};
+    Frame2DPlane plane = Frame2DPlaneFromShape(shape, DataType::kUint16);
+    plane.offset = 2;  // the last row runs 1 pixel past the buffer
+    Frame2DGuard frame(
+        NewAbiRef<abi2DFrame>(new Frame2DImpl(
+            buf.data(), buf.size() * sizeof(uint16_t), shape, DataType::kUint16, FrameType::kDepth, &plane, 1)),
+        true);
+    FrameView<const uint16_t> view(frame);
+    DS3D_TEST_CHECK(view.status() == ErrCode::kOutOfRange);
+}
+
+int
+main()
+{
+    testRoiCorners(1);
+    testRoiCorners(kFrameAlignment);
+    testPlaneOutOfRange();
+    return test::finish("test_frame_view");
+}
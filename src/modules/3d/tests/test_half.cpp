@@ -0,0 +1,124 @@
+#include "3d/common/half.h"
+#include "test_utils.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/**
+ * @file FloatToHalf / HalfToFloat (F16C on x86, NEON on aarch64) against the scalar conversions
+ */
+
+using namespace ds3d;
+
+namespace {
+
+float
+fromBits(uint32_t bits)
+{
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+uint32_t
+toBits(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+bool
+isHalfNaN(uint16_t h)
+{
+    return (h & 0x7c00) == 0x7c00 && (h & 0x3ff);
+}
+
+// a NaN only has to stay a NaN, the vector units quiet signaling ones
+bool
+sameFloat(float a, float b)
+{
+    return (std::isnan(a) && std::isnan(b)) || !memcmp(&a, &b, sizeof(a));
+}
+
+void
+checkToHalf(const std::vector<float>& in)
+{
+    std::vector<Half> out(in.size());
+    FloatToHalf(in.data(), out.data(), in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+        uint16_t expect = detail::floatToHalfBits(in[i]);
+        bool same = out[i].bits == expect || (isHalfNaN(out[i].bits) && isHalfNaN(expect));
+        if (!same) {
+            fprintf(stderr, "float 0x%08x: half 0x%04x, scalar 0x%04x\n", toBits(in[i]), out[i].bits, expect);
+        }
+        DS3D_TEST_CHECK(same);
+    }
+}
+
+// every half value, in runs which are not a multiple of the vector width
+void
+testAllHalves()
+{
+    std::vector<Half> in(65536);
+    for (uint32_t i = 0; i < in.size(); ++i) {
+        in[i] = Half::fromBits(static_cast<uint16_t>(i));
+    }
+    std::vector<float> out(in.size());
+    for (size_t begin = 0, run = 1; begin < in.size(); begin += run, run = run % 29 + 1) {
+        run = std::min(run, in.size() - begin);
+        HalfToFloat(in.data() + begin, out.data() + begin, run);
+    }
+    for (uint32_t i = 0; i < in.size(); ++i) {
+        DS3D_TEST_CHECK(sameFloat(out[i], detail::halfBitsToFloat(static_cast<uint16_t>(i))));
+    }
+
+    // and back, every half is exact in float
+    checkToHalf(out);
+}
+
+// rounding edges: the float halfway between two halves, below and above it,
+// the subnormal and overflow boundaries, then random bit patterns
+void
+testFloats()
+{
+    std::vector<float> in;
+    for (uint32_t h = 0; h < 0x7bff; h += 37) {
+        float f = detail::halfBitsToFloat(static_cast<uint16_t>(h));
+        float next = detail::halfBitsToFloat(static_cast<uint16_t>(h + 1));
+        // exact in float, halves have 13 bits less mantissa
+        uint32_t halfway = toBits((f + next) * 0.5f);
+        for (uint32_t b : {toBits(f), toBits(f) + 1, halfway - 1, halfway, halfway + 1}) {
+            in.push_back(fromBits(b));
+            in.push_back(-fromBits(b));
+        }
+    }
+    for (float f : {65504.0f, 65519.99f, 65520.0f, 1e10f, 6.1035156e-05f, 5.9604645e-08f, 2.9802322e-08f, 2.98e-08f,
+                    std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN(), 0.0f, -0.0f}) {
+        in.push_back(f);
+        in.push_back(-f);
+    }
+    in.push_back(fromBits(0x7f800001u));  // signaling NaN
+    std::mt19937 rng(16);
+    for (int i = 0; i < 200000; ++i) {
+        in.push_back(fromBits(rng()));
+    }
+    // an odd count leaves a scalar tail
+    in.push_back(1.5f);
+    checkToHalf(in);
+}
+
+}  // namespace
+
+int
+main()
+{
+#if defined(DS3D_HALF_X86)
+    printf("F16C: %s\n", detail::cpuHasF16C() ? "yes" : "no, scalar only");
+#endif
+    testAllHalves();
+    testFloats();
+    return test::finish("test_half");
+}
@@ -0,0 +1,127 @@
+#include "3d/common/point_codec.h"
+#include "test_utils.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/**
+ * @file int16 point codec (SSE on x86, NEON on aarch64) against the scalar quantization
+ */
+
+using namespace ds3d;
+
+namespace {
+
+// N x 3 points inside the quantized range with a non-finite coordinate
+// every few points, and some landing exactly halfway between two codes
+std::vector<float>
+createPoints(size_t num, uint32_t seed, const PointQuantParam& param)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-32000.0f, 32000.0f);
+    std::vector<float> xyz(num * 3);
+    for (size_t i = 0; i < num * 3; ++i) {
+        const int c = static_cast<int>(i % 3);
+        float code = i % 5 == 1 ? static_cast<float>(static_cast<int>(rng() % 2001) - 1000) + 0.5f : dist(rng);
+        xyz[i] = code * param.scale.data[c] + param.offset.data[c];
+    }
+    const float bad[] = {std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(),
+                         -std::numeric_limits<float>::infinity()};
+    for (size_t i = 0; i < num; ++i) {
+        if (i % 7 == 3) {
+            xyz[i * 3 + (i % 3)] = bad[i % 3];
+        }
+    }
+    return xyz;
+}
+
+void
+testBounds(const std::vector<float>& xyz, size_t num)
+{
+    vec3f mn, mx;
+    PointXYZBounds(xyz.data(), num, mn, mx);
+    float emn[3], emx[3];
+    for (int c = 0; c < 3; ++c) {
+        emn[c] = std::numeric_limits<float>::max();
+        emx[c] = std::numeric_limits<float>::lowest();
+    }
+    detail::pointBoundsScalar(xyz.data(), num, emn, emx);
+    for (int c = 0; c < 3; ++c) {
+        DS3D_TEST_CHECK(mn.data[c] == emn[c] && mx.data[c] == emx[c]);
+    }
+}
+
+void
+testQuantize(const std::vector<float>& xyz, size_t num, const PointQuantParam& param)
+{
+    float inv[3], off[3];
+    for (int c = 0; c < 3; ++c) {
+        inv[c] = 1.0f / param.scale.data[c];
+        off[c] = param.offset.data[c];
+    }
+    // 3 guard codes after the points catch a store past the end
+    const int16_t guard = 0x5a5a;
+    std::vector<int16_t> q(num * 3 + 3, guard), expect(num * 3 + 3, guard);
+    QuantizePointXYZ(xyz.data(), q.data(), num, param);
+    detail::pointQuantizeScalar(xyz.data(), expect.data(), num, off, inv);
+    DS3D_TEST_CHECK(q == expect);
+
+    std::vector<float> back(num * 3 + 3, -7.0f);
+    DequantizePointXYZ(q.data(), back.data(), num, param);
+    for (size_t i = 0; i < num * 3; ++i) {
+        const int c = static_cast<int>(i % 3);
+        if (q[i] == kPointQuantInvalid) {
+            DS3D_TEST_CHECK(std::isnan(back[i]));
+            continue;
+        }
+        // the scalar tail may be contracted to a fused multiply-add
+        const float v = static_cast<float>(q[i]) * param.scale.data[c] + param.offset.data[c];
+        DS3D_TEST_CHECK(std::fabs(back[i] - v) <= 1e-6f * std::fabs(v) + 1e-7f);
+        // and the round trip is within half a step of the input
+        DS3D_TEST_CHECK(std::fabs(back[i] - xyz[i]) <= 0.5001f * param.scale.data[c] + 1e-6f);
+    }
+    for (size_t i = num * 3; i < back.size(); ++i) {
+        DS3D_TEST_CHECK(back[i] == -7.0f);
+    }
+}
+
+// inputs far outside the bounds saturate to +-32767, never to kPointQuantInvalid
+void
+testSaturate()
+{
+    PointQuantParam param;
+    param.scale = vec3f{{1e-3f, 1e-3f, 1e-3f}};
+    param.offset = vec3f{{0.0f, 0.0f, 0.0f}};
+    std::vector<float> xyz = {1e6f, -1e6f, 32.7675f, -32.7675f, -32.768f, 3e38f, -3e38f, 0.0f, -0.0f, 1.0f, -1.0f, 40.0f};
+    std::vector<int16_t> q(xyz.size()), expect(xyz.size());
+    QuantizePointXYZ(xyz.data(), q.data(), 4, param);
+    const float inv[3] = {1.0f / 1e-3f, 1.0f / 1e-3f, 1.0f / 1e-3f}, off[3] = {0.0f, 0.0f, 0.0f};
+    detail::pointQuantizeScalar(xyz.data(), expect.data(), 4, off, inv);
+    DS3D_TEST_CHECK(q == expect);
+    DS3D_TEST_CHECK(q[0] == 32767 && q[1] == -32767 && q[4] == -32767 && q[6] == -32767);
+}
+
+}  // namespace
+
+int
+main()
+{
+    // every tail length of the 4 point steps, and one long run
+    std::vector<size_t> sizes = {1001};
+    for (size_t num = 0; num < 14; ++num) {
+        sizes.push_back(num);
+    }
+    for (size_t num : sizes) {
+        PointQuantParam param = PointQuantParamFromBounds(vec3f{{-5.0f, -2.0f, 0.1f}}, vec3f{{5.0f, 3.0f, 4.0f}});
+        std::vector<float> xyz = createPoints(num, static_cast<uint32_t>(num), param);
+        testBounds(xyz, num);
+        testQuantize(xyz, num, param);
+    }
+    // no finite point at all leaves min > max
+    std::vector<float> nan(12, std::numeric_limits<float>::quiet_NaN());
+    testBounds(nan, 4);
+    testSaturate();
+    return test::finish("test_point_codec");
+}
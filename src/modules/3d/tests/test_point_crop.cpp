@@ -0,0 +1,214 @@
+#include "3d/common/point_crop.h"
+#include "test_utils.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/**
+ * @file AVX2 / AVX-512 crop classify and AVX-512 compaction against the scalar loops
+ */
+
+using namespace ds3d;
+
+namespace {
+
+using ClassifyFn = size_t (*)(const float*, size_t, const CropBounds&, uint16_t*, size_t&);
+
+struct Classifier {
+    const char* name;
+    ClassifyFn classify;
+};
+
+// the vector classifiers this CPU can run, each one is tested on its own
+// instead of only the widest one picked by CropClassify
+std::vector<Classifier>
+classifiers()
+{
+    std::vector<Classifier> k;
+#if defined(DS3D_DEPTH_X86)
+    if (__builtin_cpu_supports("avx2")) {
+        k.push_back({"avx2", detail::cropClassifyAVX2});
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        k.push_back({"avx512", detail::cropClassifyAVX512});
+    }
+#endif
+    return k;
+}
+
+bool
+hasCompactAVX512()
+{
+#if defined(DS3D_DEPTH_X86)
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+}
+
+// every tail length of the 8 and 16 point steps, and one long run
+std::vector<size_t>
+sizes()
+{
+    std::vector<size_t> s = {1001};
+    for (size_t num = 0; num < 50; ++num) {
+        s.push_back(num);
+    }
+    return s;
+}
+
+// the box, distance and frustum bounds the crop filter builds from its config
+CropBounds
+createBounds()
+{
+    CropBounds b;
+    b.lo[0] = -3.0f, b.lo[1] = -2.0f, b.lo[2] = 0.2f;
+    b.hi[0] = 3.0f, b.hi[1] = 2.5f, b.hi[2] = 4.5f;
+    b.minDist2 = 0.25f;
+    b.maxDist2 = 25.0f;
+    b.slopeX = 0.8f;
+    b.slopeY = 0.5f;
+    b.slack = 0.05f;
+    return b;
+}
+
+// points in and around the bounds, invalid (0, 0, 0), non-finite, and
+// exactly on the box faces and the distance limits
+std::vector<float>
+createPoints(size_t num, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> dist(-6.0f, 6.0f);
+    const float nan = std::numeric_limits<float>::quiet_NaN(), inf = std::numeric_limits<float>::infinity();
+    const float edges[] = {-3.0f, 3.0f, -2.0f, 2.5f, 0.2f, 4.5f, 0.0f, -0.0f, nan, inf, -inf};
+    std::vector<float> xyz(num * 3 + 4);
+    for (size_t i = 0; i < num * 3; ++i) {
+        xyz[i] = (i % 11 == 5) ? edges[rng() % 11] : dist(rng);
+        if (i % 3 == 2 && rng() % 2) {
+            xyz[i] = std::fabs(xyz[i]);  // mostly in front of the camera
+        }
+    }
+    for (size_t i = 0; i < num; i += 7) {
+        xyz[i * 3] = xyz[i * 3 + 1] = xyz[i * 3 + 2] = 0.0f;
+    }
+    // on the min distance, on the far box face, and on both max distance and the x face
+    const float limits[3][3] = {{0.0f, 0.0f, 0.5f}, {0.0f, 0.0f, 4.5f}, {3.0f, 0.0f, 4.0f}};
+    for (size_t i = 3; i < num; i += 13) {
+        memcpy(&xyz[i * 3], limits[i % 3], sizeof(limits[0]));
+    }
+    return xyz;
+}
+
+void
+testClassify(const Classifier& k, std::mt19937& rng)
+{
+    const CropBounds bounds[] = {CropBounds{}, createBounds()};
+    for (size_t num : sizes()) {
+        std::vector<float> xyz = createPoints(num, rng);
+        const size_t words = (num + kCropWordPoints - 1) / kCropWordPoints;
+        for (const CropBounds& b : bounds) {
+            // one guard word after the masks catches a store past the last
+            std::vector<uint16_t> masks(words + 1, 0x5a5a), expect(words + 1, 0x5a5a);
+            size_t kept = 0;
+            size_t i = k.classify(xyz.data(), num, b, masks.data(), kept);
+            DS3D_TEST_CHECK(i <= num && i % kCropWordPoints == 0);
+            kept += detail::cropClassifyScalar(xyz.data(), i, num, b, masks.data());
+            DS3D_TEST_CHECK(kept == detail::cropClassifyScalar(xyz.data(), 0, num, b, expect.data()));
+            DS3D_TEST_CHECK(masks == expect);
+        }
+    }
+}
+
+// whole, empty and random words, all points kept or dropped at once included
+std::vector<uint16_t>
+createMasks(size_t num, std::mt19937& rng)
+{
+    std::vector<uint16_t> masks((num + kCropWordPoints - 1) / kCropWordPoints);
+    for (size_t w = 0; w < masks.size(); ++w) {
+        const uint16_t words[] = {0, 0xffff, 0x0001, 0x8000, static_cast<uint16_t>(rng())};
+        masks[w] = words[rng() % 5];
+    }
+    // bits past num are never set by classify
+    if (num % kCropWordPoints) {
+        masks.back() &= static_cast<uint16_t>((1u << (num % kCropWordPoints)) - 1);
+    }
+    return masks;
+}
+
+void
+testCompact(std::mt19937& rng)
+{
+#if defined(DS3D_DEPTH_X86)
+    const float guard = -7.0f;
+    for (size_t num : sizes()) {
+        std::vector<float> xyz(num * 3), uv(num * 2);
+        for (size_t i = 0; i < xyz.size(); ++i) {
+            xyz[i] = static_cast<float>(i);
+        }
+        for (size_t i = 0; i < uv.size(); ++i) {
+            uv[i] = -static_cast<float>(i);
+        }
+        std::vector<uint16_t> masks = createMasks(num, rng);
+        for (bool withUv : {true, false}) {
+            // 16 guard values after each output catch a store past the kept points
+            std::vector<float> out(num * 3 + 16, guard), outUV(num * 2 + 16, guard);
+            std::vector<float> expect(out.size(), guard), expectUV(outUV.size(), guard);
+            const float* inUV = withUv ? uv.data() : nullptr;
+            size_t n = 0;
+            size_t i = detail::cropCompactAVX512(xyz.data(), inUV, masks.data(), num, out.data(), outUV.data(), n);
+            DS3D_TEST_CHECK(i <= num && i % kCropWordPoints == 0);
+            n += detail::cropCompactScalar(
+                xyz.data(), inUV, masks.data(), i, num, out.data() + n * 3, withUv ? outUV.data() + n * 2 : nullptr);
+            DS3D_TEST_CHECK(n == detail::cropCompactScalar(xyz.data(), inUV, masks.data(), 0, num, expect.data(), expectUV.data()));
+            DS3D_TEST_CHECK(!memcmp(out.data(), expect.data(), out.size() * sizeof(float)));
+            DS3D_TEST_CHECK(!memcmp(outUV.data(), expectUV.data(), outUV.size() * sizeof(float)));
+        }
+    }
+#else
+    (void)rng;
+#endif
+}
+
+// the dispatching entry points from a word aligned begin, whatever kernel they pick
+void
+testPublic(std::mt19937& rng)
+{
+    const size_t num = 1001, begin = 32;
+    const CropBounds b = createBounds();
+    std::vector<float> xyz = createPoints(num, rng), uv(num * 2);
+    for (size_t i = 0; i < uv.size(); ++i) {
+        uv[i] = static_cast<float>(i) * 0.5f;
+    }
+    const size_t words = (num + kCropWordPoints - 1) / kCropWordPoints;
+    std::vector<uint16_t> masks(words), expect(words);
+    size_t kept = CropClassify(xyz.data(), begin, num, b, masks.data());
+    DS3D_TEST_CHECK(kept == detail::cropClassifyScalar(xyz.data(), begin, num, b, expect.data()));
+    DS3D_TEST_CHECK(!memcmp(masks.data() + begin / kCropWordPoints, expect.data() + begin / kCropWordPoints,
+                            (words - begin / kCropWordPoints) * sizeof(uint16_t)));
+
+    std::vector<float> out(num * 3), outUV(num * 2), expectXYZ(num * 3), expectUV(num * 2);
+    size_t n = CropCompact(xyz.data(), uv.data(), masks.data(), begin, num, out.data(), outUV.data());
+    DS3D_TEST_CHECK(n == kept);
+    DS3D_TEST_CHECK(n == detail::cropCompactScalar(xyz.data(), uv.data(), expect.data(), begin, num, expectXYZ.data(), expectUV.data()));
+    DS3D_TEST_CHECK(!memcmp(out.data(), expectXYZ.data(), n * 3 * sizeof(float)));
+    DS3D_TEST_CHECK(!memcmp(outUV.data(), expectUV.data(), n * 2 * sizeof(float)));
+}
+
+}  // namespace
+
+int
+main()
+{
+    std::mt19937 rng(24);
+    for (const Classifier& k : classifiers()) {
+        printf("classify: %s\n", k.name);
+        testClassify(k, rng);
+    }
+    printf("compact: %s\n", hasCompactAVX512() ? "avx512" : "scalar only");
+    if (hasCompactAVX512()) {
+        testCompact(rng);
+    }
+    testPublic(rng);
+    return test::finish("test_point_crop");
+}
@@ -0,0 +1,141 @@
+#include "3d/hpp/flat_datamap.hpp"
+#include "3d/hpp/point_frame.hpp"
+#include "test_utils.h"
+
+#include <cstring>
+#include <vector>
+
+/**
+ * @file SIMD planar transpose against element by element copies, and the point layouts of a datamap
+ */
+
+using namespace ds3d;
+
+namespace {
+
+// distinct bit patterns per coordinate, NaN payloads included, so a lane
+// landing in the wrong place or a float conversion shows up in memcmp
+float
+coord(size_t i, int c)
+{
+    uint32_t bits = (i % 7 == 3) ? 0x7fc00000u + static_cast<uint32_t>(i * 3 + c) : 0x3f800000u + static_cast<uint32_t>(i * 3 + c);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+void
+testTranspose()
+{
+    // every tail length of the 4 point steps, and one long run
+    std::vector<size_t> sizes = {1029};
+    for (size_t num = 0; num < 37; ++num) {
+        sizes.push_back(num);
+    }
+    for (size_t num : sizes) {
+        const float guard = -7.0f;
+        std::vector<float> xyz(num * 3 + 4, guard), planar(num * 3 + 12, guard);
+        for (size_t i = 0; i < num; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                xyz[i * 3 + c] = coord(i, c);
+            }
+        }
+        // the planes are placed back to back with 4 guard floats after each
+        float *x = planar.data(), *y = x + num + 4, *z = y + num + 4;
+        PointXYZToPlanar(xyz.data(), x, y, z, num);
+        std::vector<float> expect(num);
+        const float* planes[3] = {x, y, z};
+        for (int c = 0; c < 3; ++c) {
+            for (size_t i = 0; i < num; ++i) {
+                expect[i] = coord(i, c);
+            }
+            DS3D_TEST_CHECK(!num || !memcmp(planes[c], expect.data(), num * sizeof(float)));
+            for (int g = 0; g < 4; ++g) {
+                DS3D_TEST_CHECK(planes[c][num + g] == guard);
+            }
+        }
+
+        std::vector<float> back(num * 3 + 4, guard);
+        PlanarToPointXYZ(x, y, z, back.data(), num);
+        DS3D_TEST_CHECK(!memcmp(back.data(), xyz.data(), xyz.size() * sizeof(float)));
+    }
+}
+
+FrameGuard
+createPoints(uint32_t num)
+{
+    FrameGuard points = CreateFrame(Shape{2, {static_cast<int32_t>(num), 3}}, DataType::kFp32, FrameType::kPointXYZ);
+    float* p = static_cast<float*>(points->base());
+    for (uint32_t i = 0; i < num * 3; ++i) {
+        p[i] = 0.25f * static_cast<float>(i % 97) - 3.0f;
+    }
+    return points;
+}
+
+void
+testPlanarFrame()
+{
+    FrameGuard points = createPoints(101);
+    Frame2DGuard planar = ToPointXYZPlanar(points);
+    DS3D_TEST_CHECK(planar);
+    const Shape& shape = planar->shape();
+    DS3D_TEST_CHECK(shape.numDims == 3 && shape.d[0] == 3 && shape.d[1] == 101 && shape.d[2] == 1);
+    DS3D_TEST_CHECK(planar->frameType() == FrameType::kPointXYZPlanar);
+    FrameView<const float> rows(planar);
+    for (uint32_t r = 0; r < 3; ++r) {
+        DS3D_TEST_CHECK(reinterpret_cast<uintptr_t>(rows.rowPtr(r)) % kFrameAlignment == 0);
+    }
+    FrameGuard back = ToPointXYZ(planar);
+    DS3D_TEST_CHECK(back && !memcmp(back->base(), points->base(), 101 * 3 * sizeof(float)));
+}
+
+bool
+hasOnly(GuardDataMap& map, const char* key)
+{
+    const char* layouts[] = {kPointXYZ.name, kPointXYZPlanar.name, kPointXYZCompact.name};
+    for (const char* layout : layouts) {
+        if (map.hasData(std::string(layout)) != (layout == key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// every SetPointXYZ* leaves one layout, and GetPointXYZ reads it back
+void
+testSetLayouts()
+{
+    FrameGuard points = createPoints(64);
+    GuardDataMap map = CreateFlatDataMap();
+
+    DS3D_TEST_CHECK(isGood(SetPointXYZCompact(map, points, DataType::kInt16)));
+    DS3D_TEST_CHECK(hasOnly(map, kPointXYZCompact.name) && map.hasData(std::string(kPointQuantParam.name)));
+
+    DS3D_TEST_CHECK(isGood(SetPointXYZPlanar(map, ToPointXYZPlanar(points))));
+    DS3D_TEST_CHECK(hasOnly(map, kPointXYZPlanar.name) && !map.hasData(std::string(kPointQuantParam.name)));
+    FrameGuard read = GetPointXYZ(map);
+    DS3D_TEST_CHECK(read && !memcmp(read->base(), points->base(), 64 * 3 * sizeof(float)));
+
+    DS3D_TEST_CHECK(isGood(SetPointXYZCompact(map, points, DataType::kFp16)));
+    DS3D_TEST_CHECK(hasOnly(map, kPointXYZCompact.name) && !map.hasData(std::string(kPointQuantParam.name)));
+
+    DS3D_TEST_CHECK(isGood(SetPointXYZ(map, points)));
+    DS3D_TEST_CHECK(hasOnly(map, kPointXYZ.name));
+    DS3D_TEST_CHECK(GetPointXYZ(map)->base() == points->base());
+
+    // int16 without its decoding parameters is refused
+    PointQuantParam param;
+    FrameGuard quant = ToPointXYZQuant(points, param);
+    DS3D_TEST_CHECK(!isGood(SetPointXYZCompact(map, quant, nullptr)));
+}
+
+}  // namespace
+
+int
+main()
+{
+    testTranspose();
+    testPlanarFrame();
+    testSetLayouts();
+    return test::finish("test_point_layout");
+}
@@ -0,0 +1,108 @@
+#ifndef _DS3D_TESTS_TEST_UTILS__H
+#define _DS3D_TESTS_TEST_UTILS__H
+
+#include "3d/hpp/datamap.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @file helpers shared by the 3d tests and benches
+ */
+
+// count a failed check and keep going, main() returns test::finish()
+#define DS3D_TEST_CHECK(cond)                                                        \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++ds3d::test::failures();                                                \
+        }                                                                            \
+    } while (0)
+
+namespace ds3d { namespace test {
+
+inline int&
+failures()
+{
+    static int count = 0;
+    return count;
+}
+
+// the result of main(), prints a summary line for ctest logs
+inline int
+finish(const char* name)
+{
+    printf("%s: %s\n", name, failures() ? "FAILED" : "passed");
+    return failures() ? 1 : 0;
+}
+
+inline double
+nowNs()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief string-keyed datamap without abiDataMapV2, stands in for the
+ *   datamaps DeepStream creates (NvDs3D_Find1stDataMap).
+ */
+class LegacyDataMap : public abiDataMap {
+public:
+    ~LegacyDataMap() override { clear_i(); }
+
+    ErrCode setBuf_i(const char* key, TIdType tid, abiRefAny* data) override
+    {
+        auto& entry = _map[key];
+        if (entry.second) {
+            entry.second->destroy();
+        }
+        entry = {tid, data};
+        return ErrCode::kGood;
+    }
+    ErrCode getBuf_i(const char* key, TIdType tid, const abiRefAny*& data) const override
+    {
+        auto it = _map.find(key);
+        if (it == _map.end()) {
+            return ErrCode::kNotFound;
+        }
+        if (it->second.first != tid) {
+            return ErrCode::kTypeId;
+        }
+        data = it->second.second;
+        return ErrCode::kGood;
+    }
+    ErrCode removeBuf_i(const char* key) override
+    {
+        auto it = _map.find(key);
+        if (it == _map.end()) {
+            return ErrCode::kNotFound;
+        }
+        it->second.second->destroy();
+        _map.erase(it);
+        return ErrCode::kGood;
+    }
+    bool has_i(const char* key) const override { return _map.count(key); }
+    ErrCode clear_i() override
+    {
+        for (auto& entry : _map) {
+            entry.second.second->destroy();
+        }
+        _map.clear();
+        return ErrCode::kGood;
+    }
+
+private:
+    std::unordered_map<std::string, std::pair<TIdType, abiRefAny*>> _map;
+};
+
+inline GuardDataMap
+CreateLegacyDataMap()
+{
+    return GuardDataMap(NewAbiRef<abiDataMap>(new LegacyDataMap), true);
+}
+
+}}  // namespace ds3d::test
+
+#endif  // _DS3D_TESTS_TEST_UTILS__H
@@ -128,15 +128,16 @@ static GstPadProbeReturn appsinkBufferProbe(GstPad *pad, GstPadProbeInfo *info,
     GuardDataMap dataMap(*refDataMap);
     DS_ASSERT(dataMap);
 
-    FrameGuard pointFrame;
-    if (dataMap.hasData(kPointXYZ))
+    // per-key payload of the frame reaching the sink, only built with DS3D_ENABLE_DEBUG set
+    LOG_DEBUG("appsink %s", dataMap.memoryReport().str().c_str());
+
+    // resolve all keys used by this probe in a single pass, missing keys are left empty
+    auto [pointFrame, planarFrame, compactFrame, colorCoord, depthIntrinsics, colorIntrinsics, d2cExtrinsics] =
+            dataMap.fetch(kPointXYZ, kPointXYZPlanar, kPointXYZCompact, kPointCoordUV, kDepthIntrinsics,
+                          kColorIntrinsics, kDepth2ColorExtrinsics);
+
+    if (pointFrame)
     {
-        DS3D_FAILED_RETURN(
-                isGood(dataMap.getGuardData (kPointXYZ, pointFrame)),
-                GST_PAD_PROBE_DROP,
-                "get pointXYZ frame failed."
-        );
-        DS_ASSERT(pointFrame);
         DS_ASSERT(pointFrame->dataType() == DataType::kFp32);
         DS_ASSERT(pointFrame->frameType() == FrameType::kPointXYZ);
         Shape pShape = pointFrame->shape();  // N x 3
@@ -144,16 +145,23 @@ static GstPadProbeReturn appsinkBufferProbe(GstPad *pad, GstPadProbeInfo *info,
         numPoints = (size_t) pShape.d[0];
         LOG_DEBUG("pointcloudXYZ frame is found, points num: %u", numPoints);
     }
+    else if (planarFrame)
+    {
+        Shape pShape = planarFrame->shape();  // 3 x N
+        DS_ASSERT(pShape.numDims >= 2 && pShape.d[0] == 3);  // PointXYZPlanar
+        numPoints = (size_t) pShape.d[1];
+        LOG_DEBUG("pointcloudXYZ planar frame is found, points num: %u", numPoints);
+    }
+    else if (compactFrame)
+    {
+        Shape pShape = compactFrame->shape();  // N x 3, fp16 or int16
+        DS_ASSERT(pShape.numDims == 2 && pShape.d[1] == 3);  // PointXYZCompact
+        numPoints = (size_t) pShape.d[0];
+        LOG_DEBUG("pointcloudXYZ compact frame is found, points num: %u", numPoints);
+    }
 
-    FrameGuard colorCoord;
-    if (dataMap.hasData(kPointCoordUV))
+    if (colorCoord)
     {
-        DS3D_FAILED_RETURN(
-                isGood(dataMap.getGuardData (kPointCoordUV, colorCoord)),
-                GST_PAD_PROBE_DROP,
-                "get PointCoordUV frame failed."
-        );
-        DS_ASSERT(colorCoord);
         DS_ASSERT(colorCoord->dataType() == DataType::kFp32);
         Shape cShape = colorCoord->shape();  // N x 2
         DS_ASSERT(cShape.numDims == 2 && cShape.d[1] == 2);  // PointColorCoord
@@ -161,42 +169,29 @@ static GstPadProbeReturn appsinkBufferProbe(GstPad *pad, GstPadProbeInfo *info,
         LOG_DEBUG("PointColorCoord frame is found,  points num: %u", numPoints);
     }
 
-    // get depth & color intrinsic parameters, and also get depth-to-color extrinsic parameters
-    IntrinsicsParam depthIntrinsics;
-    IntrinsicsParam colorIntrinsics;
-    ExtrinsicsParam d2cExtrinsics;  // rotation matrix is in the column-major order
-    if (dataMap.hasData(kDepthIntrinsics))
+    // depth & color intrinsic parameters, and depth-to-color extrinsic parameters
+    if (depthIntrinsics)
     {
-        DS3D_FAILED_RETURN(
-                isGood(dataMap.getData (kDepthIntrinsics, depthIntrinsics)),
-                GST_PAD_PROBE_DROP,
-                "get depth intrinsic parameters failed."
-        );
-        LOG_DEBUG("DepthIntrinsics parameters is found, fx: %.4f, fy: %.4f", depthIntrinsics.fx, depthIntrinsics.fy);
+        LOG_DEBUG("DepthIntrinsics parameters is found, fx: %.4f, fy: %.4f", depthIntrinsics->fx, depthIntrinsics->fy);
     }
-    if (dataMap.hasData(kColorIntrinsics))
+    if (colorIntrinsics)
     {
-        DS3D_FAILED_RETURN(
-                isGood(dataMap.getData (kColorIntrinsics, colorIntrinsics)),
-                GST_PAD_PROBE_DROP,
-                "get color intrinsic parameters failed."
-        );
-        LOG_DEBUG("ColorIntrinsics parameters is found, fx: %.4f, fy: %.4f", colorIntrinsics.fx, colorIntrinsics.fy);
+        LOG_DEBUG("ColorIntrinsics parameters is found, fx: %.4f, fy: %.4f", colorIntrinsics->fx, colorIntrinsics->fy);
     }
-    if (dataMap.hasData(kDepth2ColorExtrinsics))
+    if (d2cExtrinsics)  // rotation matrix is in the column-major order
     {
-        DS3D_FAILED_RETURN(
-                isGood(dataMap.getData (kDepth2ColorExtrinsics, d2cExtrinsics)),
-                GST_PAD_PROBE_DROP,
-                "get depth2color extrinsic parameters failed."
-        );
         LOG_DEBUG("depth2color extrinsic parameters is found, t:[%.3f, %.3f, %3.f]",
-                  d2cExtrinsics.translation.x, d2cExtrinsics.translation.y, d2cExtrinsics.translation.z
+                  d2cExtrinsics->translation.x, d2cExtrinsics->translation.y, d2cExtrinsics->translation.z
         );
     }
 
-    // dump depth data for debug
-    if (pointFrame && profiler.pointWriter.isOpen()) {
+    // dump depth data for debug, planar or compact points are converted to N x 3 fp32 for it only
+    if ((pointFrame || planarFrame || compactFrame) && profiler.pointWriter.isOpen()) {
+        if (!pointFrame)
+        {
+            pointFrame = GetPointXYZ(dataMap);
+            DS3D_FAILED_RETURN(pointFrame, GST_PAD_PROBE_DROP, "convert points for dump failed");
+        }
         DS_ASSERT(pointFrame->memType() != MemType::kGpuCuda);
         DS3D_FAILED_RETURN(
                 profiler.pointWriter.write((const uint8_t *) pointFrame->base(), pointFrame->bytes()),
@@ -6,6 +6,7 @@
 #include "dataloader.hpp"
 #include "datamap.hpp"
 #include "frame.hpp"
+#include "point_frame.hpp"
 #include "yaml_config.hpp"
 #include "profiling.hpp"
 